@@ -0,0 +1,91 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+*/
+
+#include "KiwiDspArena.h"
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/mman.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+namespace Kiwi
+{
+    DspArena::DspArena() noexcept :
+    m_memory(nullptr),
+    m_data(nullptr),
+    m_capacity(0)
+    {
+        ;
+    }
+    
+    DspArena::~DspArena()
+    {
+        if(m_memory)
+        {
+            delete [] m_memory;
+        }
+    }
+    
+    sample* DspArena::reserve(const ulong nsamples)
+    {
+        if(nsamples > m_capacity)
+        {
+            const ulong capacity = align(nsamples);
+            if(m_memory)
+            {
+                delete [] m_memory;
+            }
+            m_memory    = new char[capacity * sizeof(sample) + alignment - 1];
+            m_data      = (sample *)((uintptr_t(m_memory) + alignment - 1) & ~uintptr_t(alignment - 1));
+            m_capacity  = capacity;
+        }
+        return m_data;
+    }
+    
+    void DspArena::lock(void const* data, const size_t size) noexcept
+    {
+        if(data && size)
+        {
+#if defined(__linux__) || defined(__APPLE__)
+            mlock(data, size);
+#elif defined(_WIN32)
+            VirtualLock(const_cast<void*>(data), size);
+#endif
+        }
+    }
+    
+    void DspArena::unlock(void const* data, const size_t size) noexcept
+    {
+        if(data && size)
+        {
+#if defined(__linux__) || defined(__APPLE__)
+            munlock(data, size);
+#elif defined(_WIN32)
+            VirtualUnlock(const_cast<void*>(data), size);
+#endif
+        }
+    }
+}
+
+
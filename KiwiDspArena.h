@@ -0,0 +1,123 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+ */
+
+#ifndef __DEF_KIWI_DSP_ARENA__
+#define __DEF_KIWI_DSP_ARENA__
+
+#include "../KiwiDsp/KiwiDsp.h"
+
+namespace Kiwi
+{
+    // ================================================================================ //
+    //                                      DSP ARENA                                   //
+    // ================================================================================ //
+    
+    //! The memory of the sample matrices of a device.
+    /** The arena is a contiguous block of samples aligned on 64 bytes. It only grows so the memory is reused when the device restarts with the same or a smaller configuration. The regions are split with align() so each one starts on an aligned address.
+     */
+    class DspArena
+    {
+    private:
+        char*   m_memory;
+        sample* m_data;
+        ulong   m_capacity;
+    
+    public:
+        static const ulong alignment = 64;
+        
+        //! Constructor
+        /**
+         */
+        DspArena() noexcept;
+        
+        //! Destructor
+        /**
+         */
+        ~DspArena();
+        
+        //! Round a number of samples to the alignment.
+        /** This function rounds a number of samples up so that a region of this size keeps the next region aligned.
+         @param nsamples The number of samples.
+         @return The aligned number of samples.
+         */
+        static inline ulong align(const ulong nsamples) noexcept
+        {
+            const ulong step = alignment / sizeof(sample);
+            return (nsamples + step - 1) / step * step;
+        }
+        
+        //! Reserve the memory.
+        /** This function makes sure the arena can hold a number of samples. The memory is only reallocated if the arena has to grow, in that case the previous content is lost.
+         @param nsamples The number of samples.
+         @return The aligned memory.
+         */
+        sample* reserve(const ulong nsamples);
+        
+        //! Lock a memory region.
+        /** This function locks a memory region in the physical memory so the real-time threads can't page fault on it. It fails silently when the process is not allowed to lock memory.
+         @param data The memory region.
+         @param size The size of the region in bytes.
+         */
+        static void lock(void const* data, const size_t size) noexcept;
+        
+        //! Unlock a memory region.
+        /** This function unlocks a memory region locked with lock().
+         @param data The memory region.
+         @param size The size of the region in bytes.
+         */
+        static void unlock(void const* data, const size_t size) noexcept;
+        
+        //! Swap two arenas.
+        /** This function exchanges the memory of two arenas without copying it.
+         @param other The other arena.
+         */
+        inline void swap(DspArena& other) noexcept
+        {
+            std::swap(m_memory, other.m_memory);
+            std::swap(m_data, other.m_data);
+            std::swap(m_capacity, other.m_capacity);
+        }
+        
+        //! Retrieve the memory.
+        /** This function retrieves the aligned memory.
+         @return The aligned memory.
+         */
+        inline sample* data() const noexcept
+        {
+            return m_data;
+        }
+        
+        //! Retrieve the capacity.
+        /** This function retrieves the number of samples the arena can hold.
+         @return The capacity.
+         */
+        inline ulong getCapacity() const noexcept
+        {
+            return m_capacity;
+        }
+    };
+}
+
+#endif
+
+
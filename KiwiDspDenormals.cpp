@@ -0,0 +1,121 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+*/
+
+#include "KiwiDspDenormals.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define __KIWI_DENORMALS_X86__
+#include <xmmintrin.h>
+#elif (defined(__aarch64__) || defined(__arm__)) && defined(__GNUC__)
+#define __KIWI_DENORMALS_ARM__
+#endif
+
+namespace Kiwi
+{
+#if defined(__KIWI_DENORMALS_X86__)
+
+    // The FTZ (bit 15) and DAZ (bit 6) bits of the MXCSR register.
+    static const uintptr_t denormals_mask = 0x8040;
+    
+    static inline uintptr_t getMode() noexcept
+    {
+        return uintptr_t(_mm_getcsr());
+    }
+    
+    static inline void setMode(const uintptr_t mode) noexcept
+    {
+        _mm_setcsr((unsigned int)mode);
+    }
+
+#elif defined(__KIWI_DENORMALS_ARM__)
+
+    // The FZ bit (bit 24) of the FPCR or FPSCR register, on ARMv8 it also
+    // flushes the denormal inputs.
+    static const uintptr_t denormals_mask = uintptr_t(1) << 24;
+    
+    static inline uintptr_t getMode() noexcept
+    {
+        uintptr_t mode;
+#if defined(__aarch64__)
+        asm volatile("mrs %0, fpcr" : "=r"(mode));
+#else
+        asm volatile("vmrs %0, fpscr" : "=r"(mode));
+#endif
+        return mode;
+    }
+    
+    static inline void setMode(const uintptr_t mode) noexcept
+    {
+#if defined(__aarch64__)
+        asm volatile("msr fpcr, %0" : : "r"(mode));
+#else
+        asm volatile("vmsr fpscr, %0" : : "r"(mode));
+#endif
+    }
+
+#else
+
+    static const uintptr_t denormals_mask = 0;
+    
+    static inline uintptr_t getMode() noexcept
+    {
+        return 0;
+    }
+    
+    static inline void setMode(const uintptr_t) noexcept
+    {
+        ;
+    }
+
+#endif
+
+    DspDenormalsGuard::DspDenormalsGuard(const bool enable) noexcept :
+    m_mode(0),
+    m_enabled(false)
+    {
+        if(enable && denormals_mask)
+        {
+            m_mode = getMode();
+            if((m_mode & denormals_mask) != denormals_mask)
+            {
+                setMode(m_mode | denormals_mask);
+                m_enabled = true;
+            }
+        }
+    }
+    
+    DspDenormalsGuard::~DspDenormalsGuard()
+    {
+        if(m_enabled)
+        {
+            setMode(m_mode);
+        }
+    }
+    
+    bool DspDenormalsGuard::isSupported() noexcept
+    {
+        return denormals_mask != 0;
+    }
+}
+
+
@@ -0,0 +1,67 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+ */
+
+#ifndef __DEF_KIWI_DSP_DENORMALS__
+#define __DEF_KIWI_DSP_DENORMALS__
+
+#include "../KiwiDsp/KiwiDsp.h"
+
+namespace Kiwi
+{
+    // ================================================================================ //
+    //                                  DSP DENORMALS GUARD                             //
+    // ================================================================================ //
+    
+    //! The scoped protection against the denormal numbers.
+    /** The guard enables the flush-to-zero and denormals-are-zero modes of the floating-point unit of the current thread for its lifetime and restores the previous mode when it is destroyed. The denormal numbers appear when the signals of a feedback decay toward silence and are processed several times slower than the normal numbers by most of the processors. On x86 the guard sets the FTZ and DAZ bits of the MXCSR register, on ARM it sets the FZ bit of the FPCR or the FPSCR register, elsewhere it does nothing.
+     */
+    class DspDenormalsGuard
+    {
+    private:
+        uintptr_t   m_mode;
+        bool        m_enabled;
+    
+    public:
+    
+        //! Constructor
+        /** The function saves the mode of the floating-point unit then enables the flush of the denormals.
+         @param enable False to leave the mode of the floating-point unit unchanged.
+         */
+        DspDenormalsGuard(const bool enable = true) noexcept;
+        
+        //! Destructor
+        /** The function restores the mode of the floating-point unit.
+         */
+        ~DspDenormalsGuard();
+        
+        //! Retrieve if the guard is supported.
+        /** This function retrieves if the guard can change the mode of the floating-point unit on this architecture.
+         @return True if the guard is supported, otherwise false.
+         */
+        static bool isSupported() noexcept;
+    };
+}
+
+#endif
+
+
@@ -0,0 +1,52 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+ */
+
+#ifndef __DEF_KIWI_DSP_DEVICE_SETUP__
+#define __DEF_KIWI_DSP_DEVICE_SETUP__
+
+#include "../KiwiDsp/KiwiDsp.h"
+
+namespace Kiwi
+{
+    // ================================================================================ //
+    //                                  DSP DEVICE SETUP                                //
+    // ================================================================================ //
+    
+    //! The configuration of a device.
+    /** The setup gathers the parameters a device manager applies at once with applySetup(). An empty name or a null value leaves the parameter unchanged.
+     */
+    struct DspDeviceSetup
+    {
+        string  driver;
+        string  input;
+        string  output;
+        ulong   samplerate;
+        ulong   vectorsize;
+        
+        DspDeviceSetup() noexcept : samplerate(0), vectorsize(0) {}
+    };
+}
+
+#endif
+
+
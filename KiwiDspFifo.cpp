@@ -0,0 +1,152 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+*/
+
+#include "KiwiDspFifo.h"
+
+namespace Kiwi
+{
+    DspFifo::DspFifo() noexcept :
+    m_nchannels(0),
+    m_capacity(0),
+    m_read(0),
+    m_size(0)
+    {
+        ;
+    }
+    
+    DspFifo::~DspFifo()
+    {
+        ;
+    }
+    
+    void DspFifo::prepare(const ulong nchannels, const ulong capacity)
+    {
+        m_nchannels = nchannels;
+        m_capacity  = max(capacity, 1ul);
+        m_buffer.assign(m_nchannels * m_capacity, 0.f);
+        clear();
+    }
+    
+    void DspFifo::clear(const ulong latency) noexcept
+    {
+        m_read = 0;
+        m_size = min(latency, m_capacity);
+        fill(m_buffer.begin(), m_buffer.begin() + m_size * m_nchannels, 0.f);
+    }
+    
+    void DspFifo::write(const ulong nframes, float const* frames) noexcept
+    {
+        const ulong size = min(nframes, m_capacity - m_size);
+        ulong write = (m_read + m_size) % m_capacity;
+        // A fifo without channel only counts the frames.
+        for(ulong done = 0; m_nchannels && done < size;)
+        {
+            const ulong n = min(size - done, m_capacity - write);
+            memcpy(m_buffer.data() + write * m_nchannels, frames + done * m_nchannels, n * m_nchannels * sizeof(float));
+            done += n;
+            write = 0;
+        }
+        m_size += size;
+    }
+    
+    void DspFifo::write(const ulong nframes, float const* const* channels, const ulong offset) noexcept
+    {
+        const ulong size = min(nframes, m_capacity - m_size);
+        const ulong start = m_read + m_size;
+        for(ulong i = 0; i < m_nchannels; i++)
+        {
+            float const* src = channels[i] + offset;
+            for(ulong j = 0; j < size; j++)
+            {
+                m_buffer[((start + j) % m_capacity) * m_nchannels + i] = src[j];
+            }
+        }
+        m_size += size;
+    }
+    
+    ulong DspFifo::read(const ulong nframes, float* frames) noexcept
+    {
+        const ulong size = min(nframes, m_size);
+        for(ulong done = 0; m_nchannels && done < size;)
+        {
+            const ulong n = min(size - done, m_capacity - m_read);
+            memcpy(frames + done * m_nchannels, m_buffer.data() + m_read * m_nchannels, n * m_nchannels * sizeof(float));
+            done += n;
+            m_read = (m_read + n) % m_capacity;
+        }
+        m_size -= size;
+        fill(frames + size * m_nchannels, frames + nframes * m_nchannels, 0.f);
+        return size;
+    }
+    
+    ulong DspFifo::read(const ulong nframes, float* const* channels, const ulong offset) noexcept
+    {
+        const ulong size = min(nframes, m_size);
+        for(ulong i = 0; i < m_nchannels; i++)
+        {
+            float* dest = channels[i] + offset;
+            for(ulong j = 0; j < size; j++)
+            {
+                dest[j] = m_buffer[((m_read + j) % m_capacity) * m_nchannels + i];
+            }
+            fill(dest + size, dest + nframes, 0.f);
+        }
+        m_read = (m_read + size) % m_capacity;
+        m_size -= size;
+        return size;
+    }
+    
+    ulong DspFifo::pull(const ulong nframes, sample* matrix, const ulong stride) noexcept
+    {
+        const ulong size = min(nframes, m_size);
+        for(ulong i = 0; i < m_nchannels; i++)
+        {
+            sample* dest = matrix + i * stride;
+            for(ulong j = 0; j < size; j++)
+            {
+                dest[j] = sample(m_buffer[((m_read + j) % m_capacity) * m_nchannels + i]);
+            }
+            fill(dest + size, dest + nframes, sample(0));
+        }
+        m_read = (m_read + size) % m_capacity;
+        m_size -= size;
+        return size;
+    }
+    
+    void DspFifo::push(const ulong nframes, sample const* matrix, const ulong stride) noexcept
+    {
+        const ulong size = min(nframes, m_capacity - m_size);
+        const ulong start = m_read + m_size;
+        for(ulong i = 0; i < m_nchannels; i++)
+        {
+            sample const* src = matrix + i * stride;
+            for(ulong j = 0; j < size; j++)
+            {
+                m_buffer[((start + j) % m_capacity) * m_nchannels + i] = float(src[j]);
+            }
+        }
+        m_size += size;
+    }
+}
+
+
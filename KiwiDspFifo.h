@@ -0,0 +1,152 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+ */
+
+#ifndef __DEF_KIWI_DSP_FIFO__
+#define __DEF_KIWI_DSP_FIFO__
+
+#include "../KiwiDsp/KiwiDsp.h"
+
+namespace Kiwi
+{
+    // ================================================================================ //
+    //                                      DSP FIFO                                    //
+    // ================================================================================ //
+    
+    //! The fifo between the buffers of a driver and the vectors of the dsp.
+    /** The fifo is a ring of interleaved float frames. The driver side writes and reads float buffers, interleaved or one per channel, and the dsp side pulls and pushes sample matrices. The memory is allocated by prepare() so the other methods can be called from the audio thread.
+     */
+    class DspFifo
+    {
+    private:
+        vector<float>   m_buffer;
+        ulong           m_nchannels;
+        ulong           m_capacity;
+        ulong           m_read;
+        ulong           m_size;
+    
+    public:
+    
+        //! Constructor
+        /**
+         */
+        DspFifo() noexcept;
+        
+        //! Destructor
+        /**
+         */
+        ~DspFifo();
+        
+        //! Prepare the fifo.
+        /** This function allocates the fifo then clears it.
+         @param nchannels The number of channels.
+         @param capacity The maximum number of frames.
+         */
+        void prepare(const ulong nchannels, const ulong capacity);
+        
+        //! Clear the fifo.
+        /** This function empties the fifo then fills it with a number of silent frames.
+         @param latency The number of silent frames.
+         */
+        void clear(const ulong latency = 0) noexcept;
+        
+        //! Retrieve the latency between two buffer sizes.
+        /** This function retrieves the number of silent frames the output fifo must start with so that buffers of a size can be produced from vectors of another size without underflows.
+         @param buffersize The size of the buffers.
+         @param vectorsize The size of the vectors.
+         @return The latency.
+         */
+        static inline ulong getLatency(const ulong buffersize, const ulong vectorsize) noexcept
+        {
+            ulong a = buffersize, b = vectorsize;
+            while(b)
+            {
+                const ulong r = a % b;
+                a = b;
+                b = r;
+            }
+            return vectorsize - a;
+        }
+        
+        //! Retrieve the number of frames.
+        /** This function retrieves the number of frames in the fifo.
+         @return The number of frames.
+         */
+        inline ulong getSize() const noexcept
+        {
+            return m_size;
+        }
+        
+        //! Write interleaved frames.
+        /** This function writes frames from an interleaved float buffer. The frames that don't fit are dropped.
+         @param nframes The number of frames.
+         @param frames The interleaved buffer.
+         */
+        void write(const ulong nframes, float const* frames) noexcept;
+        
+        //! Write frames from channels.
+        /** This function writes frames from one float buffer per channel.
+         @param nframes The number of frames.
+         @param channels The buffers.
+         @param offset The offset in the buffers.
+         */
+        void write(const ulong nframes, float const* const* channels, const ulong offset) noexcept;
+        
+        //! Read interleaved frames.
+        /** This function reads frames to an interleaved float buffer. The missing frames are silent.
+         @param nframes The number of frames.
+         @param frames The interleaved buffer.
+         @return The number of frames really read.
+         */
+        ulong read(const ulong nframes, float* frames) noexcept;
+        
+        //! Read frames to channels.
+        /** This function reads frames to one float buffer per channel. The missing frames are silent.
+         @param nframes The number of frames.
+         @param channels The buffers.
+         @param offset The offset in the buffers.
+         @return The number of frames really read.
+         */
+        ulong read(const ulong nframes, float* const* channels, const ulong offset) noexcept;
+        
+        //! Pull frames to a sample matrix.
+        /** This function reads frames to a sample matrix. The missing frames are silent.
+         @param nframes The number of frames.
+         @param matrix The sample matrix.
+         @param stride The distance between two channels of the matrix.
+         @return The number of frames really read.
+         */
+        ulong pull(const ulong nframes, sample* matrix, const ulong stride) noexcept;
+        
+        //! Push frames from a sample matrix.
+        /** This function writes frames from a sample matrix. The frames that don't fit are dropped.
+         @param nframes The number of frames.
+         @param matrix The sample matrix.
+         @param stride The distance between two channels of the matrix.
+         */
+        void push(const ulong nframes, sample const* matrix, const ulong stride) noexcept;
+    };
+}
+
+#endif
+
+
@@ -0,0 +1,1289 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+*/
+
+#include "KiwiDspKernels.h"
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define __KIWI_KERNELS_X86_INTEGER__
+#define __KIWI_KERNELS_X86_LAYOUT__
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#if defined(__KIWI_DSP_DOUBLE__)
+#define __KIWI_KERNELS_X86__
+#endif
+#elif defined(__aarch64__)
+#define __KIWI_KERNELS_NEON_INTEGER__
+#define __KIWI_KERNELS_NEON_LAYOUT__
+#include <arm_neon.h>
+#if defined(__KIWI_DSP_DOUBLE__)
+#define __KIWI_KERNELS_NEON__
+#endif
+#endif
+
+#if defined(__GNUC__)
+#define __KIWI_KERNELS_TARGET__(arch) __attribute__((target(arch)))
+#else
+#define __KIWI_KERNELS_TARGET__(arch)
+#endif
+
+namespace Kiwi
+{
+    namespace Kernels
+    {
+        struct Implementation
+        {
+            char const* name;
+            void (*convertin)(const ulong, float const*, sample*);
+            void (*convertout)(const ulong, sample const*, float*);
+            void (*deinterleave)(const ulong, const ulong, float const*, sample*);
+            void (*interleave)(const ulong, const ulong, sample const*, float*);
+        };
+        
+        // ================================================================================ //
+        //                                      SCALAR                                      //
+        // ================================================================================ //
+        
+        static void scalarConvertIn(const ulong vectorsize, float const* in, sample* out)
+        {
+            for(ulong i = 0; i < vectorsize; i++)
+            {
+                out[i] = sample(in[i]);
+            }
+        }
+        
+        static void scalarConvertOut(const ulong vectorsize, sample const* in, float* out)
+        {
+            for(ulong i = 0; i < vectorsize; i++)
+            {
+                out[i] = float(in[i]);
+            }
+        }
+        
+        static void scalarDeinterleave(const ulong vectorsize, const ulong nchannels, float const* in, sample* out)
+        {
+            for(ulong i = 0; i < nchannels; i++)
+            {
+                float const* src = in + i;
+                sample* dest = out + i * vectorsize;
+                for(ulong j = 0; j < vectorsize; j++, src += nchannels)
+                {
+                    dest[j] = sample(*src);
+                }
+            }
+        }
+        
+        static void scalarInterleave(const ulong vectorsize, const ulong nchannels, sample const* in, float* out)
+        {
+            for(ulong i = 0; i < nchannels; i++)
+            {
+                sample const* src = in + i * vectorsize;
+                float* dest = out + i;
+                for(ulong j = 0; j < vectorsize; j++, dest += nchannels)
+                {
+                    *dest = float(src[j]);
+                }
+            }
+        }
+        
+        static const Implementation scalar = {"Scalar", &scalarConvertIn, &scalarConvertOut, &scalarDeinterleave, &scalarInterleave};
+
+#ifdef __KIWI_KERNELS_X86_INTEGER__
+        
+        static bool hasSse2() noexcept
+        {
+#if defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 1);
+            return (info[3] & (1 << 26)) != 0;
+#else
+            return __builtin_cpu_supports("sse2");
+#endif
+        }
+        
+#endif
+
+#ifdef __KIWI_KERNELS_X86__
+
+        // ================================================================================ //
+        //                                      SSE2                                        //
+        // ================================================================================ //
+        
+        __KIWI_KERNELS_TARGET__("sse2") static void sse2ConvertIn(const ulong vectorsize, float const* in, sample* out)
+        {
+            ulong i = 0;
+            for(; i + 4 <= vectorsize; i += 4)
+            {
+                const __m128 v = _mm_loadu_ps(in + i);
+                _mm_storeu_pd(out + i, _mm_cvtps_pd(v));
+                _mm_storeu_pd(out + i + 2, _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+            }
+            scalarConvertIn(vectorsize - i, in + i, out + i);
+        }
+        
+        __KIWI_KERNELS_TARGET__("sse2") static void sse2ConvertOut(const ulong vectorsize, sample const* in, float* out)
+        {
+            ulong i = 0;
+            for(; i + 4 <= vectorsize; i += 4)
+            {
+                const __m128 a = _mm_cvtpd_ps(_mm_loadu_pd(in + i));
+                const __m128 b = _mm_cvtpd_ps(_mm_loadu_pd(in + i + 2));
+                _mm_storeu_ps(out + i, _mm_movelh_ps(a, b));
+            }
+            scalarConvertOut(vectorsize - i, in + i, out + i);
+        }
+        
+        __KIWI_KERNELS_TARGET__("sse2") static void sse2Deinterleave(const ulong vectorsize, const ulong nchannels, float const* in, sample* out)
+        {
+            if(nchannels == 1)
+            {
+                sse2ConvertIn(vectorsize, in, out);
+            }
+            else if(nchannels == 2)
+            {
+                sample* left  = out;
+                sample* right = out + vectorsize;
+                ulong i = 0;
+                for(; i + 2 <= vectorsize; i += 2)
+                {
+                    const __m128 v = _mm_loadu_ps(in + i * 2);
+                    const __m128 s = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 1, 2, 0));
+                    _mm_storeu_pd(left + i, _mm_cvtps_pd(s));
+                    _mm_storeu_pd(right + i, _mm_cvtps_pd(_mm_movehl_ps(s, s)));
+                }
+                for(; i < vectorsize; i++)
+                {
+                    left[i]  = sample(in[i * 2]);
+                    right[i] = sample(in[i * 2 + 1]);
+                }
+            }
+            else
+            {
+                scalarDeinterleave(vectorsize, nchannels, in, out);
+            }
+        }
+        
+        __KIWI_KERNELS_TARGET__("sse2") static void sse2Interleave(const ulong vectorsize, const ulong nchannels, sample const* in, float* out)
+        {
+            if(nchannels == 1)
+            {
+                sse2ConvertOut(vectorsize, in, out);
+            }
+            else if(nchannels == 2)
+            {
+                sample const* left  = in;
+                sample const* right = in + vectorsize;
+                ulong i = 0;
+                for(; i + 2 <= vectorsize; i += 2)
+                {
+                    const __m128 l = _mm_cvtpd_ps(_mm_loadu_pd(left + i));
+                    const __m128 r = _mm_cvtpd_ps(_mm_loadu_pd(right + i));
+                    _mm_storeu_ps(out + i * 2, _mm_unpacklo_ps(l, r));
+                }
+                for(; i < vectorsize; i++)
+                {
+                    out[i * 2]     = float(left[i]);
+                    out[i * 2 + 1] = float(right[i]);
+                }
+            }
+            else
+            {
+                scalarInterleave(vectorsize, nchannels, in, out);
+            }
+        }
+        
+        static const Implementation sse2 = {"SSE2", &sse2ConvertIn, &sse2ConvertOut, &sse2Deinterleave, &sse2Interleave};
+        
+        // ================================================================================ //
+        //                                      AVX2                                        //
+        // ================================================================================ //
+        
+        __KIWI_KERNELS_TARGET__("avx2") static void avx2ConvertIn(const ulong vectorsize, float const* in, sample* out)
+        {
+            ulong i = 0;
+            for(; i + 8 <= vectorsize; i += 8)
+            {
+                const __m256 v = _mm256_loadu_ps(in + i);
+                _mm256_storeu_pd(out + i, _mm256_cvtps_pd(_mm256_castps256_ps128(v)));
+                _mm256_storeu_pd(out + i + 4, _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1)));
+            }
+            scalarConvertIn(vectorsize - i, in + i, out + i);
+        }
+        
+        __KIWI_KERNELS_TARGET__("avx2") static void avx2ConvertOut(const ulong vectorsize, sample const* in, float* out)
+        {
+            ulong i = 0;
+            for(; i + 8 <= vectorsize; i += 8)
+            {
+                const __m128 a = _mm256_cvtpd_ps(_mm256_loadu_pd(in + i));
+                const __m128 b = _mm256_cvtpd_ps(_mm256_loadu_pd(in + i + 4));
+                _mm256_storeu_ps(out + i, _mm256_insertf128_ps(_mm256_castps128_ps256(a), b, 1));
+            }
+            scalarConvertOut(vectorsize - i, in + i, out + i);
+        }
+        
+        __KIWI_KERNELS_TARGET__("avx2") static void avx2Deinterleave(const ulong vectorsize, const ulong nchannels, float const* in, sample* out)
+        {
+            if(nchannels == 1)
+            {
+                avx2ConvertIn(vectorsize, in, out);
+            }
+            else if(nchannels == 2)
+            {
+                sample* left  = out;
+                sample* right = out + vectorsize;
+                const __m256i index = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+                ulong i = 0;
+                for(; i + 4 <= vectorsize; i += 4)
+                {
+                    const __m256 v = _mm256_permutevar8x32_ps(_mm256_loadu_ps(in + i * 2), index);
+                    _mm256_storeu_pd(left + i, _mm256_cvtps_pd(_mm256_castps256_ps128(v)));
+                    _mm256_storeu_pd(right + i, _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1)));
+                }
+                for(; i < vectorsize; i++)
+                {
+                    left[i]  = sample(in[i * 2]);
+                    right[i] = sample(in[i * 2 + 1]);
+                }
+            }
+            else
+            {
+                scalarDeinterleave(vectorsize, nchannels, in, out);
+            }
+        }
+        
+        __KIWI_KERNELS_TARGET__("avx2") static void avx2Interleave(const ulong vectorsize, const ulong nchannels, sample const* in, float* out)
+        {
+            if(nchannels == 1)
+            {
+                avx2ConvertOut(vectorsize, in, out);
+            }
+            else if(nchannels == 2)
+            {
+                sample const* left  = in;
+                sample const* right = in + vectorsize;
+                ulong i = 0;
+                for(; i + 4 <= vectorsize; i += 4)
+                {
+                    const __m128 l = _mm256_cvtpd_ps(_mm256_loadu_pd(left + i));
+                    const __m128 r = _mm256_cvtpd_ps(_mm256_loadu_pd(right + i));
+                    _mm_storeu_ps(out + i * 2, _mm_unpacklo_ps(l, r));
+                    _mm_storeu_ps(out + i * 2 + 4, _mm_unpackhi_ps(l, r));
+                }
+                for(; i < vectorsize; i++)
+                {
+                    out[i * 2]     = float(left[i]);
+                    out[i * 2 + 1] = float(right[i]);
+                }
+            }
+            else
+            {
+                scalarInterleave(vectorsize, nchannels, in, out);
+            }
+        }
+        
+        static const Implementation avx2 = {"AVX2", &avx2ConvertIn, &avx2ConvertOut, &avx2Deinterleave, &avx2Interleave};
+        
+        static bool hasAvx2() noexcept
+        {
+#if defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 0);
+            if(info[0] < 7)
+            {
+                return false;
+            }
+            __cpuid(info, 1);
+            if(!(info[2] & (1 << 27)) || !(info[2] & (1 << 28)) || (_xgetbv(0) & 6) != 6)
+            {
+                return false;
+            }
+            __cpuidex(info, 7, 0);
+            return (info[1] & (1 << 5)) != 0;
+#else
+            return __builtin_cpu_supports("avx2");
+#endif
+        }
+
+#endif
+
+#ifdef __KIWI_KERNELS_NEON__
+
+        // ================================================================================ //
+        //                                      NEON                                        //
+        // ================================================================================ //
+        
+        static void neonConvertIn(const ulong vectorsize, float const* in, sample* out)
+        {
+            ulong i = 0;
+            for(; i + 4 <= vectorsize; i += 4)
+            {
+                const float32x4_t v = vld1q_f32(in + i);
+                vst1q_f64(out + i, vcvt_f64_f32(vget_low_f32(v)));
+                vst1q_f64(out + i + 2, vcvt_high_f64_f32(v));
+            }
+            scalarConvertIn(vectorsize - i, in + i, out + i);
+        }
+        
+        static void neonConvertOut(const ulong vectorsize, sample const* in, float* out)
+        {
+            ulong i = 0;
+            for(; i + 4 <= vectorsize; i += 4)
+            {
+                vst1q_f32(out + i, vcvt_high_f32_f64(vcvt_f32_f64(vld1q_f64(in + i)), vld1q_f64(in + i + 2)));
+            }
+            scalarConvertOut(vectorsize - i, in + i, out + i);
+        }
+        
+        static void neonDeinterleave(const ulong vectorsize, const ulong nchannels, float const* in, sample* out)
+        {
+            if(nchannels == 1)
+            {
+                neonConvertIn(vectorsize, in, out);
+            }
+            else if(nchannels == 2)
+            {
+                sample* left  = out;
+                sample* right = out + vectorsize;
+                ulong i = 0;
+                for(; i + 4 <= vectorsize; i += 4)
+                {
+                    const float32x4x2_t v = vld2q_f32(in + i * 2);
+                    vst1q_f64(left + i, vcvt_f64_f32(vget_low_f32(v.val[0])));
+                    vst1q_f64(left + i + 2, vcvt_high_f64_f32(v.val[0]));
+                    vst1q_f64(right + i, vcvt_f64_f32(vget_low_f32(v.val[1])));
+                    vst1q_f64(right + i + 2, vcvt_high_f64_f32(v.val[1]));
+                }
+                for(; i < vectorsize; i++)
+                {
+                    left[i]  = sample(in[i * 2]);
+                    right[i] = sample(in[i * 2 + 1]);
+                }
+            }
+            else
+            {
+                scalarDeinterleave(vectorsize, nchannels, in, out);
+            }
+        }
+        
+        static void neonInterleave(const ulong vectorsize, const ulong nchannels, sample const* in, float* out)
+        {
+            if(nchannels == 1)
+            {
+                neonConvertOut(vectorsize, in, out);
+            }
+            else if(nchannels == 2)
+            {
+                sample const* left  = in;
+                sample const* right = in + vectorsize;
+                ulong i = 0;
+                for(; i + 4 <= vectorsize; i += 4)
+                {
+                    float32x4x2_t v;
+                    v.val[0] = vcvt_high_f32_f64(vcvt_f32_f64(vld1q_f64(left + i)), vld1q_f64(left + i + 2));
+                    v.val[1] = vcvt_high_f32_f64(vcvt_f32_f64(vld1q_f64(right + i)), vld1q_f64(right + i + 2));
+                    vst2q_f32(out + i * 2, v);
+                }
+                for(; i < vectorsize; i++)
+                {
+                    out[i * 2]     = float(left[i]);
+                    out[i * 2 + 1] = float(right[i]);
+                }
+            }
+            else
+            {
+                scalarInterleave(vectorsize, nchannels, in, out);
+            }
+        }
+        
+        static const Implementation neon = {"NEON", &neonConvertIn, &neonConvertOut, &neonDeinterleave, &neonInterleave};
+
+#endif
+
+        // ================================================================================ //
+        //                                  INTEGER SCALAR                                  //
+        // ================================================================================ //
+        
+        struct IntegerImplementation
+        {
+            char const* name;
+            void (*fromint16)(const ulong, int16_t const*, float*);
+            void (*fromint24)(const ulong, uint8_t const*, float*);
+            void (*fromint32)(const ulong, int32_t const*, float*);
+            void (*toint16)(const ulong, float const*, int16_t*, Dither*);
+            void (*toint24)(const ulong, float const*, uint8_t*, Dither*);
+            void (*toint32)(const ulong, float const*, int32_t*);
+        };
+        
+        static const float int16scale   = 32768.f;
+        static const float int24scale   = 8388608.f;
+        static const float int32scale   = 2147483648.f;
+        static const float int32max     = 2147483520.f;
+        static const float ditherscale  = 1.f / 16777216.f;
+        
+        static inline float scalarDither(Dither* dither, const ulong lane) noexcept
+        {
+            if(dither)
+            {
+                uint32_t& x = dither->state[lane & 3];
+                x ^= x << 13;
+                x ^= x >> 17;
+                x ^= x << 5;
+                const float a = float(x >> 8) * ditherscale;
+                x ^= x << 13;
+                x ^= x >> 17;
+                x ^= x << 5;
+                return a - float(x >> 8) * ditherscale;
+            }
+            return 0.f;
+        }
+        
+        static inline int32_t readInt24(uint8_t const* in) noexcept
+        {
+            return int32_t(uint32_t(in[0]) << 8 | uint32_t(in[1]) << 16 | uint32_t(in[2]) << 24) >> 8;
+        }
+        
+        static inline void writeInt24(const int32_t value, uint8_t* out) noexcept
+        {
+            out[0] = uint8_t(value);
+            out[1] = uint8_t(value >> 8);
+            out[2] = uint8_t(value >> 16);
+        }
+        
+        static void scalarFromInt16(const ulong size, int16_t const* in, float* out)
+        {
+            for(ulong i = 0; i < size; i++)
+            {
+                out[i] = float(in[i]) * (1.f / int16scale);
+            }
+        }
+        
+        static void scalarFromInt24(const ulong size, uint8_t const* in, float* out)
+        {
+            for(ulong i = 0; i < size; i++)
+            {
+                out[i] = float(readInt24(in + i * 3)) * (1.f / int24scale);
+            }
+        }
+        
+        static void scalarFromInt32(const ulong size, int32_t const* in, float* out)
+        {
+            for(ulong i = 0; i < size; i++)
+            {
+                out[i] = float(in[i]) * (1.f / int32scale);
+            }
+        }
+        
+        static void scalarToInt16(const ulong size, float const* in, int16_t* out, Dither* dither)
+        {
+            for(ulong i = 0; i < size; i++)
+            {
+                const float value = in[i] * int16scale + scalarDither(dither, i);
+                out[i] = int16_t(lrintf(min(max(value, -int16scale), int16scale - 1.f)));
+            }
+        }
+        
+        static void scalarToInt24(const ulong size, float const* in, uint8_t* out, Dither* dither)
+        {
+            for(ulong i = 0; i < size; i++)
+            {
+                const float value = in[i] * int24scale + scalarDither(dither, i);
+                writeInt24(int32_t(lrintf(min(max(value, -int24scale), int24scale - 1.f))), out + i * 3);
+            }
+        }
+        
+        static void scalarToInt32(const ulong size, float const* in, int32_t* out)
+        {
+            for(ulong i = 0; i < size; i++)
+            {
+                out[i] = int32_t(lrintf(min(max(in[i] * int32scale, -int32scale), int32max)));
+            }
+        }
+        
+        static const IntegerImplementation integerScalar = {"Scalar", &scalarFromInt16, &scalarFromInt24, &scalarFromInt32, &scalarToInt16, &scalarToInt24, &scalarToInt32};
+        
+#ifdef __KIWI_KERNELS_X86_INTEGER__
+        
+        // ================================================================================ //
+        //                                  INTEGER SSE2                                    //
+        // ================================================================================ //
+        
+        __KIWI_KERNELS_TARGET__("sse2") static inline __m128 sse2Random(__m128i& state) noexcept
+        {
+            state = _mm_xor_si128(state, _mm_slli_epi32(state, 13));
+            state = _mm_xor_si128(state, _mm_srli_epi32(state, 17));
+            state = _mm_xor_si128(state, _mm_slli_epi32(state, 5));
+            return _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(state, 8)), _mm_set1_ps(ditherscale));
+        }
+        
+        __KIWI_KERNELS_TARGET__("sse2") static inline __m128 sse2Dither(__m128i& state) noexcept
+        {
+            const __m128 a = sse2Random(state);
+            return _mm_sub_ps(a, sse2Random(state));
+        }
+        
+        __KIWI_KERNELS_TARGET__("sse2") static void sse2FromInt16(const ulong size, int16_t const* in, float* out)
+        {
+            const __m128 scale = _mm_set1_ps(1.f / int16scale);
+            ulong i = 0;
+            for(; i + 8 <= size; i += 8)
+            {
+                const __m128i v = _mm_loadu_si128((__m128i const*)(in + i));
+                const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+                const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+                _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+                _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+            }
+            scalarFromInt16(size - i, in + i, out + i);
+        }
+        
+        __KIWI_KERNELS_TARGET__("sse2") static void sse2FromInt24(const ulong size, uint8_t const* in, float* out)
+        {
+            const __m128 scale = _mm_set1_ps(1.f / int24scale);
+            ulong i = 0;
+            for(; i + 4 <= size; i += 4)
+            {
+                uint8_t const* p = in + i * 3;
+                const __m128i v = _mm_setr_epi32(int32_t(uint32_t(p[0]) << 8 | uint32_t(p[1]) << 16 | uint32_t(p[2]) << 24),
+                                                 int32_t(uint32_t(p[3]) << 8 | uint32_t(p[4]) << 16 | uint32_t(p[5]) << 24),
+                                                 int32_t(uint32_t(p[6]) << 8 | uint32_t(p[7]) << 16 | uint32_t(p[8]) << 24),
+                                                 int32_t(uint32_t(p[9]) << 8 | uint32_t(p[10]) << 16 | uint32_t(p[11]) << 24));
+                _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(v, 8)), scale));
+            }
+            scalarFromInt24(size - i, in + i * 3, out + i);
+        }
+        
+        __KIWI_KERNELS_TARGET__("sse2") static void sse2FromInt32(const ulong size, int32_t const* in, float* out)
+        {
+            const __m128 scale = _mm_set1_ps(1.f / int32scale);
+            ulong i = 0;
+            for(; i + 4 <= size; i += 4)
+            {
+                _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((__m128i const*)(in + i))), scale));
+            }
+            scalarFromInt32(size - i, in + i, out + i);
+        }
+        
+        __KIWI_KERNELS_TARGET__("sse2") static void sse2ToInt16(const ulong size, float const* in, int16_t* out, Dither* dither)
+        {
+            const __m128 scale  = _mm_set1_ps(int16scale);
+            const __m128 low    = _mm_set1_ps(-int16scale);
+            const __m128 high   = _mm_set1_ps(int16scale - 1.f);
+            __m128i state = dither ? _mm_loadu_si128((__m128i const*)dither->state) : _mm_setzero_si128();
+            ulong i = 0;
+            for(; i + 8 <= size; i += 8)
+            {
+                __m128 a = _mm_mul_ps(_mm_loadu_ps(in + i), scale);
+                __m128 b = _mm_mul_ps(_mm_loadu_ps(in + i + 4), scale);
+                if(dither)
+                {
+                    a = _mm_add_ps(a, sse2Dither(state));
+                    b = _mm_add_ps(b, sse2Dither(state));
+                }
+                const __m128i ia = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(a, low), high));
+                const __m128i ib = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(b, low), high));
+                _mm_storeu_si128((__m128i*)(out + i), _mm_packs_epi32(ia, ib));
+            }
+            if(dither)
+            {
+                _mm_storeu_si128((__m128i*)dither->state, state);
+            }
+            scalarToInt16(size - i, in + i, out + i, dither);
+        }
+        
+        __KIWI_KERNELS_TARGET__("sse2") static void sse2ToInt24(const ulong size, float const* in, uint8_t* out, Dither* dither)
+        {
+            const __m128 scale  = _mm_set1_ps(int24scale);
+            const __m128 low    = _mm_set1_ps(-int24scale);
+            const __m128 high   = _mm_set1_ps(int24scale - 1.f);
+            __m128i state = dither ? _mm_loadu_si128((__m128i const*)dither->state) : _mm_setzero_si128();
+            int32_t values[4];
+            ulong i = 0;
+            for(; i + 4 <= size; i += 4)
+            {
+                __m128 v = _mm_mul_ps(_mm_loadu_ps(in + i), scale);
+                if(dither)
+                {
+                    v = _mm_add_ps(v, sse2Dither(state));
+                }
+                _mm_storeu_si128((__m128i*)values, _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(v, low), high)));
+                for(ulong j = 0; j < 4; j++)
+                {
+                    writeInt24(values[j], out + (i + j) * 3);
+                }
+            }
+            if(dither)
+            {
+                _mm_storeu_si128((__m128i*)dither->state, state);
+            }
+            scalarToInt24(size - i, in + i, out + i * 3, dither);
+        }
+        
+        __KIWI_KERNELS_TARGET__("sse2") static void sse2ToInt32(const ulong size, float const* in, int32_t* out)
+        {
+            const __m128 scale  = _mm_set1_ps(int32scale);
+            const __m128 low    = _mm_set1_ps(-int32scale);
+            const __m128 high   = _mm_set1_ps(int32max);
+            ulong i = 0;
+            for(; i + 4 <= size; i += 4)
+            {
+                const __m128 v = _mm_mul_ps(_mm_loadu_ps(in + i), scale);
+                _mm_storeu_si128((__m128i*)(out + i), _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(v, low), high)));
+            }
+            scalarToInt32(size - i, in + i, out + i);
+        }
+        
+        static const IntegerImplementation integerSse2 = {"SSE2", &sse2FromInt16, &sse2FromInt24, &sse2FromInt32, &sse2ToInt16, &sse2ToInt24, &sse2ToInt32};
+        
+#endif
+        
+#ifdef __KIWI_KERNELS_NEON_INTEGER__
+        
+        // ================================================================================ //
+        //                                  INTEGER NEON                                    //
+        // ================================================================================ //
+        
+        static inline float32x4_t neonRandom(uint32x4_t& state) noexcept
+        {
+            state = veorq_u32(state, vshlq_n_u32(state, 13));
+            state = veorq_u32(state, vshrq_n_u32(state, 17));
+            state = veorq_u32(state, vshlq_n_u32(state, 5));
+            return vmulq_n_f32(vcvtq_f32_u32(vshrq_n_u32(state, 8)), ditherscale);
+        }
+        
+        static inline float32x4_t neonDither(uint32x4_t& state) noexcept
+        {
+            const float32x4_t a = neonRandom(state);
+            return vsubq_f32(a, neonRandom(state));
+        }
+        
+        static void neonFromInt16(const ulong size, int16_t const* in, float* out)
+        {
+            ulong i = 0;
+            for(; i + 8 <= size; i += 8)
+            {
+                const int16x8_t v = vld1q_s16(in + i);
+                vst1q_f32(out + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), 1.f / int16scale));
+                vst1q_f32(out + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_high_s16(v)), 1.f / int16scale));
+            }
+            scalarFromInt16(size - i, in + i, out + i);
+        }
+        
+        static void neonFromInt24(const ulong size, uint8_t const* in, float* out)
+        {
+            ulong i = 0;
+            for(; i + 16 <= size; i += 16)
+            {
+                // Loads 16 packed values as 3 planes of bytes then widens them.
+                const uint8x16x3_t v = vld3q_u8(in + i * 3);
+                const uint16x8_t lo  = vorrq_u16(vmovl_u8(vget_low_u8(v.val[0])), vshll_n_u8(vget_low_u8(v.val[1]), 8));
+                const uint16x8_t hi  = vorrq_u16(vmovl_u8(vget_high_u8(v.val[0])), vshll_n_u8(vget_high_u8(v.val[1]), 8));
+                const uint16x8_t lo2 = vmovl_u8(vget_low_u8(v.val[2]));
+                const uint16x8_t hi2 = vmovl_u8(vget_high_u8(v.val[2]));
+                const uint32x4_t a = vorrq_u32(vshll_n_u16(vget_low_u16(lo), 8), vshlq_n_u32(vmovl_u16(vget_low_u16(lo2)), 24));
+                const uint32x4_t b = vorrq_u32(vshll_n_u16(vget_high_u16(lo), 8), vshlq_n_u32(vmovl_u16(vget_high_u16(lo2)), 24));
+                const uint32x4_t c = vorrq_u32(vshll_n_u16(vget_low_u16(hi), 8), vshlq_n_u32(vmovl_u16(vget_low_u16(hi2)), 24));
+                const uint32x4_t d = vorrq_u32(vshll_n_u16(vget_high_u16(hi), 8), vshlq_n_u32(vmovl_u16(vget_high_u16(hi2)), 24));
+                vst1q_f32(out + i, vmulq_n_f32(vcvtq_f32_s32(vshrq_n_s32(vreinterpretq_s32_u32(a), 8)), 1.f / int24scale));
+                vst1q_f32(out + i + 4, vmulq_n_f32(vcvtq_f32_s32(vshrq_n_s32(vreinterpretq_s32_u32(b), 8)), 1.f / int24scale));
+                vst1q_f32(out + i + 8, vmulq_n_f32(vcvtq_f32_s32(vshrq_n_s32(vreinterpretq_s32_u32(c), 8)), 1.f / int24scale));
+                vst1q_f32(out + i + 12, vmulq_n_f32(vcvtq_f32_s32(vshrq_n_s32(vreinterpretq_s32_u32(d), 8)), 1.f / int24scale));
+            }
+            scalarFromInt24(size - i, in + i * 3, out + i);
+        }
+        
+        static void neonFromInt32(const ulong size, int32_t const* in, float* out)
+        {
+            ulong i = 0;
+            for(; i + 4 <= size; i += 4)
+            {
+                vst1q_f32(out + i, vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(in + i)), 1.f / int32scale));
+            }
+            scalarFromInt32(size - i, in + i, out + i);
+        }
+        
+        static void neonToInt16(const ulong size, float const* in, int16_t* out, Dither* dither)
+        {
+            uint32x4_t state = dither ? vld1q_u32(dither->state) : vdupq_n_u32(0);
+            ulong i = 0;
+            for(; i + 8 <= size; i += 8)
+            {
+                float32x4_t a = vmulq_n_f32(vld1q_f32(in + i), int16scale);
+                float32x4_t b = vmulq_n_f32(vld1q_f32(in + i + 4), int16scale);
+                if(dither)
+                {
+                    a = vaddq_f32(a, neonDither(state));
+                    b = vaddq_f32(b, neonDither(state));
+                }
+                vst1q_s16(out + i, vcombine_s16(vqmovn_s32(vcvtnq_s32_f32(a)), vqmovn_s32(vcvtnq_s32_f32(b))));
+            }
+            if(dither)
+            {
+                vst1q_u32(dither->state, state);
+            }
+            scalarToInt16(size - i, in + i, out + i, dither);
+        }
+        
+        static void neonToInt24(const ulong size, float const* in, uint8_t* out, Dither* dither)
+        {
+            const float32x4_t low  = vdupq_n_f32(-int24scale);
+            const float32x4_t high = vdupq_n_f32(int24scale - 1.f);
+            uint32x4_t state = dither ? vld1q_u32(dither->state) : vdupq_n_u32(0);
+            int32_t values[4];
+            ulong i = 0;
+            for(; i + 4 <= size; i += 4)
+            {
+                float32x4_t v = vmulq_n_f32(vld1q_f32(in + i), int24scale);
+                if(dither)
+                {
+                    v = vaddq_f32(v, neonDither(state));
+                }
+                vst1q_s32(values, vcvtnq_s32_f32(vminq_f32(vmaxq_f32(v, low), high)));
+                for(ulong j = 0; j < 4; j++)
+                {
+                    writeInt24(values[j], out + (i + j) * 3);
+                }
+            }
+            if(dither)
+            {
+                vst1q_u32(dither->state, state);
+            }
+            scalarToInt24(size - i, in + i, out + i * 3, dither);
+        }
+        
+        static void neonToInt32(const ulong size, float const* in, int32_t* out)
+        {
+            ulong i = 0;
+            for(; i + 4 <= size; i += 4)
+            {
+                vst1q_s32(out + i, vcvtnq_s32_f32(vmulq_n_f32(vld1q_f32(in + i), int32scale)));
+            }
+            scalarToInt32(size - i, in + i, out + i);
+        }
+        
+        static const IntegerImplementation integerNeon = {"NEON", &neonFromInt16, &neonFromInt24, &neonFromInt32, &neonToInt16, &neonToInt24, &neonToInt32};
+        
+#endif
+        
+        // ================================================================================ //
+        //                                  LAYOUT SCALAR                                   //
+        // ================================================================================ //
+        
+        // The kernels are indexed by the number of channels: 1, 2, 4 and 8.
+        struct LayoutImplementation
+        {
+            char const*     name;
+            Deinterleaver   deinterleave[4];
+            Interleaver     interleave[4];
+        };
+        
+        template<ulong N> static inline void scalarDeinterleaveFrames(const ulong start, const ulong vectorsize, float const* in, sample* out) noexcept
+        {
+            for(ulong i = start; i < vectorsize; i++)
+            {
+                for(ulong j = 0; j < N; j++)
+                {
+                    out[j * vectorsize + i] = sample(in[i * N + j]);
+                }
+            }
+        }
+        
+        template<ulong N> static inline void scalarInterleaveFrames(const ulong start, const ulong vectorsize, sample const* in, float* out) noexcept
+        {
+            for(ulong i = start; i < vectorsize; i++)
+            {
+                for(ulong j = 0; j < N; j++)
+                {
+                    out[i * N + j] = float(in[j * vectorsize + i]);
+                }
+            }
+        }
+        
+        template<ulong N> static void scalarDeinterleaveFixed(const ulong vectorsize, const ulong, float const* in, sample* out)
+        {
+            scalarDeinterleaveFrames<N>(0, vectorsize, in, out);
+        }
+        
+        template<ulong N> static void scalarInterleaveFixed(const ulong vectorsize, const ulong, sample const* in, float* out)
+        {
+            scalarInterleaveFrames<N>(0, vectorsize, in, out);
+        }
+        
+        static const LayoutImplementation layoutScalar = {"Scalar",
+            {&scalarDeinterleaveFixed<1>, &scalarDeinterleaveFixed<2>, &scalarDeinterleaveFixed<4>, &scalarDeinterleaveFixed<8>},
+            {&scalarInterleaveFixed<1>, &scalarInterleaveFixed<2>, &scalarInterleaveFixed<4>, &scalarInterleaveFixed<8>}};
+        
+#ifdef __KIWI_KERNELS_X86_LAYOUT__
+        
+        // ================================================================================ //
+        //                                  LAYOUT SSE2                                     //
+        // ================================================================================ //
+        
+        // The shuffles work on floats, the samples are converted when they
+        // are loaded or stored.
+#ifdef __KIWI_DSP_DOUBLE__
+        __KIWI_KERNELS_TARGET__("sse2") static inline __m128 sse2Load(sample const* in) noexcept
+        {
+            return _mm_movelh_ps(_mm_cvtpd_ps(_mm_loadu_pd(in)), _mm_cvtpd_ps(_mm_loadu_pd(in + 2)));
+        }
+        
+        __KIWI_KERNELS_TARGET__("sse2") static inline void sse2Store(sample* out, const __m128 v) noexcept
+        {
+            _mm_storeu_pd(out, _mm_cvtps_pd(v));
+            _mm_storeu_pd(out + 2, _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+        }
+#else
+        __KIWI_KERNELS_TARGET__("sse2") static inline __m128 sse2Load(sample const* in) noexcept
+        {
+            return _mm_loadu_ps(in);
+        }
+        
+        __KIWI_KERNELS_TARGET__("sse2") static inline void sse2Store(sample* out, const __m128 v) noexcept
+        {
+            _mm_storeu_ps(out, v);
+        }
+#endif
+        
+        __KIWI_KERNELS_TARGET__("sse2") static void sse2Deinterleave1(const ulong vectorsize, const ulong, float const* in, sample* out)
+        {
+            ulong i = 0;
+            for(; i + 4 <= vectorsize; i += 4)
+            {
+                sse2Store(out + i, _mm_loadu_ps(in + i));
+            }
+            scalarDeinterleaveFrames<1>(i, vectorsize, in, out);
+        }
+        
+        __KIWI_KERNELS_TARGET__("sse2") static void sse2Deinterleave2(const ulong vectorsize, const ulong, float const* in, sample* out)
+        {
+            ulong i = 0;
+            for(; i + 4 <= vectorsize; i += 4)
+            {
+                const __m128 a = _mm_loadu_ps(in + i * 2);
+                const __m128 b = _mm_loadu_ps(in + i * 2 + 4);
+                sse2Store(out + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+                sse2Store(out + vectorsize + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+            }
+            scalarDeinterleaveFrames<2>(i, vectorsize, in, out);
+        }
+        
+        // Four frames of each group of four channels are transposed.
+        template<ulong N> __KIWI_KERNELS_TARGET__("sse2") static void sse2DeinterleaveQuads(const ulong vectorsize, const ulong, float const* in, sample* out)
+        {
+            ulong i = 0;
+            for(; i + 4 <= vectorsize; i += 4)
+            {
+                for(ulong j = 0; j < N; j += 4)
+                {
+                    __m128 r0 = _mm_loadu_ps(in + i * N + j);
+                    __m128 r1 = _mm_loadu_ps(in + (i + 1) * N + j);
+                    __m128 r2 = _mm_loadu_ps(in + (i + 2) * N + j);
+                    __m128 r3 = _mm_loadu_ps(in + (i + 3) * N + j);
+                    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+                    sse2Store(out + j * vectorsize + i, r0);
+                    sse2Store(out + (j + 1) * vectorsize + i, r1);
+                    sse2Store(out + (j + 2) * vectorsize + i, r2);
+                    sse2Store(out + (j + 3) * vectorsize + i, r3);
+                }
+            }
+            scalarDeinterleaveFrames<N>(i, vectorsize, in, out);
+        }
+        
+        __KIWI_KERNELS_TARGET__("sse2") static void sse2Interleave1(const ulong vectorsize, const ulong, sample const* in, float* out)
+        {
+            ulong i = 0;
+            for(; i + 4 <= vectorsize; i += 4)
+            {
+                _mm_storeu_ps(out + i, sse2Load(in + i));
+            }
+            scalarInterleaveFrames<1>(i, vectorsize, in, out);
+        }
+        
+        __KIWI_KERNELS_TARGET__("sse2") static void sse2Interleave2(const ulong vectorsize, const ulong, sample const* in, float* out)
+        {
+            ulong i = 0;
+            for(; i + 4 <= vectorsize; i += 4)
+            {
+                const __m128 l = sse2Load(in + i);
+                const __m128 r = sse2Load(in + vectorsize + i);
+                _mm_storeu_ps(out + i * 2, _mm_unpacklo_ps(l, r));
+                _mm_storeu_ps(out + i * 2 + 4, _mm_unpackhi_ps(l, r));
+            }
+            scalarInterleaveFrames<2>(i, vectorsize, in, out);
+        }
+        
+        template<ulong N> __KIWI_KERNELS_TARGET__("sse2") static void sse2InterleaveQuads(const ulong vectorsize, const ulong, sample const* in, float* out)
+        {
+            ulong i = 0;
+            for(; i + 4 <= vectorsize; i += 4)
+            {
+                for(ulong j = 0; j < N; j += 4)
+                {
+                    __m128 r0 = sse2Load(in + j * vectorsize + i);
+                    __m128 r1 = sse2Load(in + (j + 1) * vectorsize + i);
+                    __m128 r2 = sse2Load(in + (j + 2) * vectorsize + i);
+                    __m128 r3 = sse2Load(in + (j + 3) * vectorsize + i);
+                    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+                    _mm_storeu_ps(out + i * N + j, r0);
+                    _mm_storeu_ps(out + (i + 1) * N + j, r1);
+                    _mm_storeu_ps(out + (i + 2) * N + j, r2);
+                    _mm_storeu_ps(out + (i + 3) * N + j, r3);
+                }
+            }
+            scalarInterleaveFrames<N>(i, vectorsize, in, out);
+        }
+        
+        static const LayoutImplementation layoutSse2 = {"SSE2",
+            {&sse2Deinterleave1, &sse2Deinterleave2, &sse2DeinterleaveQuads<4>, &sse2DeinterleaveQuads<8>},
+            {&sse2Interleave1, &sse2Interleave2, &sse2InterleaveQuads<4>, &sse2InterleaveQuads<8>}};
+        
+#ifdef __KIWI_KERNELS_X86__
+        
+        // The conversion kernels already have wider versions for 1 and 2
+        // channels.
+        static const LayoutImplementation layoutAvx2 = {"AVX2",
+            {&avx2Deinterleave, &avx2Deinterleave, &sse2DeinterleaveQuads<4>, &sse2DeinterleaveQuads<8>},
+            {&avx2Interleave, &avx2Interleave, &sse2InterleaveQuads<4>, &sse2InterleaveQuads<8>}};
+        
+#endif
+        
+#endif
+        
+#ifdef __KIWI_KERNELS_NEON_LAYOUT__
+        
+        // ================================================================================ //
+        //                                  LAYOUT NEON                                     //
+        // ================================================================================ //
+        
+        // The structured loads and stores deinterleave 2 and 4 channels, the
+        // 8 channels use the scalar kernels.
+#ifdef __KIWI_DSP_DOUBLE__
+        static inline float32x4_t neonLoad(sample const* in) noexcept
+        {
+            return vcvt_high_f32_f64(vcvt_f32_f64(vld1q_f64(in)), vld1q_f64(in + 2));
+        }
+        
+        static inline void neonStore(sample* out, const float32x4_t v) noexcept
+        {
+            vst1q_f64(out, vcvt_f64_f32(vget_low_f32(v)));
+            vst1q_f64(out + 2, vcvt_high_f64_f32(v));
+        }
+#else
+        static inline float32x4_t neonLoad(sample const* in) noexcept
+        {
+            return vld1q_f32(in);
+        }
+        
+        static inline void neonStore(sample* out, const float32x4_t v) noexcept
+        {
+            vst1q_f32(out, v);
+        }
+#endif
+        
+        static void neonDeinterleave1(const ulong vectorsize, const ulong, float const* in, sample* out)
+        {
+            ulong i = 0;
+            for(; i + 4 <= vectorsize; i += 4)
+            {
+                neonStore(out + i, vld1q_f32(in + i));
+            }
+            scalarDeinterleaveFrames<1>(i, vectorsize, in, out);
+        }
+        
+        static void neonDeinterleave2(const ulong vectorsize, const ulong, float const* in, sample* out)
+        {
+            ulong i = 0;
+            for(; i + 4 <= vectorsize; i += 4)
+            {
+                const float32x4x2_t v = vld2q_f32(in + i * 2);
+                neonStore(out + i, v.val[0]);
+                neonStore(out + vectorsize + i, v.val[1]);
+            }
+            scalarDeinterleaveFrames<2>(i, vectorsize, in, out);
+        }
+        
+        static void neonDeinterleave4(const ulong vectorsize, const ulong, float const* in, sample* out)
+        {
+            ulong i = 0;
+            for(; i + 4 <= vectorsize; i += 4)
+            {
+                const float32x4x4_t v = vld4q_f32(in + i * 4);
+                neonStore(out + i, v.val[0]);
+                neonStore(out + vectorsize + i, v.val[1]);
+                neonStore(out + vectorsize * 2 + i, v.val[2]);
+                neonStore(out + vectorsize * 3 + i, v.val[3]);
+            }
+            scalarDeinterleaveFrames<4>(i, vectorsize, in, out);
+        }
+        
+        static void neonInterleave1(const ulong vectorsize, const ulong, sample const* in, float* out)
+        {
+            ulong i = 0;
+            for(; i + 4 <= vectorsize; i += 4)
+            {
+                vst1q_f32(out + i, neonLoad(in + i));
+            }
+            scalarInterleaveFrames<1>(i, vectorsize, in, out);
+        }
+        
+        static void neonInterleave2(const ulong vectorsize, const ulong, sample const* in, float* out)
+        {
+            ulong i = 0;
+            for(; i + 4 <= vectorsize; i += 4)
+            {
+                float32x4x2_t v;
+                v.val[0] = neonLoad(in + i);
+                v.val[1] = neonLoad(in + vectorsize + i);
+                vst2q_f32(out + i * 2, v);
+            }
+            scalarInterleaveFrames<2>(i, vectorsize, in, out);
+        }
+        
+        static void neonInterleave4(const ulong vectorsize, const ulong, sample const* in, float* out)
+        {
+            ulong i = 0;
+            for(; i + 4 <= vectorsize; i += 4)
+            {
+                float32x4x4_t v;
+                v.val[0] = neonLoad(in + i);
+                v.val[1] = neonLoad(in + vectorsize + i);
+                v.val[2] = neonLoad(in + vectorsize * 2 + i);
+                v.val[3] = neonLoad(in + vectorsize * 3 + i);
+                vst4q_f32(out + i * 4, v);
+            }
+            scalarInterleaveFrames<4>(i, vectorsize, in, out);
+        }
+        
+        static const LayoutImplementation layoutNeon = {"NEON",
+            {&neonDeinterleave1, &neonDeinterleave2, &neonDeinterleave4, &scalarDeinterleaveFixed<8>},
+            {&neonInterleave1, &neonInterleave2, &neonInterleave4, &scalarInterleaveFixed<8>}};
+        
+#endif
+        
+        // ================================================================================ //
+        //                                      DISPATCH                                    //
+        // ================================================================================ //
+        
+        static Implementation getBestImplementation() noexcept
+        {
+#if defined(__KIWI_KERNELS_X86__)
+            if(hasAvx2())
+            {
+                return avx2;
+            }
+            else if(hasSse2())
+            {
+                return sse2;
+            }
+#elif defined(__KIWI_KERNELS_NEON__)
+            return neon;
+#endif
+            return scalar;
+        }
+        
+        static const Implementation implementation = getBestImplementation();
+        
+        static IntegerImplementation getBestIntegerImplementation() noexcept
+        {
+#if defined(__KIWI_KERNELS_X86_INTEGER__)
+            if(hasSse2())
+            {
+                return integerSse2;
+            }
+#elif defined(__KIWI_KERNELS_NEON_INTEGER__)
+            return integerNeon;
+#endif
+            return integerScalar;
+        }
+        
+        static const IntegerImplementation integerImplementation = getBestIntegerImplementation();
+        
+        static LayoutImplementation getBestLayoutImplementation() noexcept
+        {
+#if defined(__KIWI_KERNELS_X86_LAYOUT__)
+#if defined(__KIWI_KERNELS_X86__)
+            if(hasAvx2())
+            {
+                return layoutAvx2;
+            }
+#endif
+            if(hasSse2())
+            {
+                return layoutSse2;
+            }
+#elif defined(__KIWI_KERNELS_NEON_LAYOUT__)
+            return layoutNeon;
+#endif
+            return layoutScalar;
+        }
+        
+        static const LayoutImplementation layoutImplementation = getBestLayoutImplementation();
+        
+#ifndef __KIWI_DSP_DOUBLE__
+        
+        // The other numbers of channels keep the generic kernels of the dsp.
+        static void signalDeinterleave(const ulong vectorsize, const ulong nchannels, float const* in, sample* out)
+        {
+            Signal::vdeterleave(vectorsize, nchannels, (float *)in, out);
+        }
+        
+        static void signalInterleave(const ulong vectorsize, const ulong nchannels, sample const* in, float* out)
+        {
+            Signal::vinterleave(vectorsize, nchannels, (float *)in, out);
+        }
+        
+#endif
+        
+        // A stream opened without inputs or outputs has no buffer for them.
+        static void emptyDeinterleave(const ulong, const ulong, float const*, sample*)
+        {
+            ;
+        }
+        
+        static void emptyInterleave(const ulong, const ulong, sample const*, float*)
+        {
+            ;
+        }
+        
+        string getImplementationName() noexcept
+        {
+            return implementation.name;
+        }
+        
+        string getIntegerImplementationName() noexcept
+        {
+            return integerImplementation.name;
+        }
+        
+        string getLayoutImplementationName() noexcept
+        {
+            return layoutImplementation.name;
+        }
+        
+        void fromFloat(const ulong vectorsize, float const* in, sample* out) noexcept
+        {
+            implementation.convertin(vectorsize, in, out);
+        }
+        
+        void toFloat(const ulong vectorsize, sample const* in, float* out) noexcept
+        {
+            implementation.convertout(vectorsize, in, out);
+        }
+        
+        void deinterleave(const ulong vectorsize, const ulong nchannels, float const* in, sample* out) noexcept
+        {
+            implementation.deinterleave(vectorsize, nchannels, in, out);
+        }
+        
+        void interleave(const ulong vectorsize, const ulong nchannels, sample const* in, float* out) noexcept
+        {
+            implementation.interleave(vectorsize, nchannels, in, out);
+        }
+        
+        void deinterleave(const ulong vectorsize, const ulong nchannels, const ulong channel, float const* in, sample* out) noexcept
+        {
+            in += channel;
+            for(ulong i = 0; i < vectorsize; i++, in += nchannels)
+            {
+                out[i] = sample(*in);
+            }
+        }
+        
+        void interleave(const ulong vectorsize, const ulong nchannels, const ulong channel, sample const* in, float* out) noexcept
+        {
+            out += channel;
+            for(ulong i = 0; i < vectorsize; i++, out += nchannels)
+            {
+                *out = float(in[i]);
+            }
+        }
+        
+        Deinterleaver getDeinterleaver(const ulong nchannels) noexcept
+        {
+            switch(nchannels)
+            {
+                case 0:  return &emptyDeinterleave;
+                case 1:  return layoutImplementation.deinterleave[0];
+                case 2:  return layoutImplementation.deinterleave[1];
+                case 4:  return layoutImplementation.deinterleave[2];
+                case 8:  return layoutImplementation.deinterleave[3];
+#ifdef __KIWI_DSP_DOUBLE__
+                default: return implementation.deinterleave;
+#else
+                default: return &signalDeinterleave;
+#endif
+            }
+        }
+        
+        Interleaver getInterleaver(const ulong nchannels) noexcept
+        {
+            switch(nchannels)
+            {
+                case 0:  return &emptyInterleave;
+                case 1:  return layoutImplementation.interleave[0];
+                case 2:  return layoutImplementation.interleave[1];
+                case 4:  return layoutImplementation.interleave[2];
+                case 8:  return layoutImplementation.interleave[3];
+#ifdef __KIWI_DSP_DOUBLE__
+                default: return implementation.interleave;
+#else
+                default: return &signalInterleave;
+#endif
+            }
+        }
+        
+        void fromInt16(const ulong size, int16_t const* in, float* out) noexcept
+        {
+            integerImplementation.fromint16(size, in, out);
+        }
+        
+        void fromInt24(const ulong size, uint8_t const* in, float* out) noexcept
+        {
+            integerImplementation.fromint24(size, in, out);
+        }
+        
+        void fromInt32(const ulong size, int32_t const* in, float* out) noexcept
+        {
+            integerImplementation.fromint32(size, in, out);
+        }
+        
+        void toInt16(const ulong size, float const* in, int16_t* out, Dither* dither) noexcept
+        {
+            integerImplementation.toint16(size, in, out, dither);
+        }
+        
+        void toInt24(const ulong size, float const* in, uint8_t* out, Dither* dither) noexcept
+        {
+            integerImplementation.toint24(size, in, out, dither);
+        }
+        
+        void toInt32(const ulong size, float const* in, int32_t* out) noexcept
+        {
+            integerImplementation.toint32(size, in, out);
+        }
+    }
+}
+
+
@@ -0,0 +1,206 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+ */
+
+#ifndef __DEF_KIWI_DSP_KERNELS__
+#define __DEF_KIWI_DSP_KERNELS__
+
+#include "../KiwiDsp/KiwiDsp.h"
+
+namespace Kiwi
+{
+    // ================================================================================ //
+    //                                      KERNELS                                     //
+    // ================================================================================ //
+    
+    //! The conversion kernels used by the device managers.
+    /** The kernels convert the float buffers of the audio drivers to the sample matrices of the dsp and the inverse. The matrices are made of one vector per channel. The best implementation (AVX2, SSE2, NEON or scalar) is selected once at runtime depending on the CPU. The integer kernels convert the native formats of the drivers to float buffers and have their own implementation, as the kernels specialized for a number of channels.
+     */
+    namespace Kernels
+    {
+        //! Retrieve the name of the selected implementation.
+        /** This function retrieves the name of the implementation selected for the CPU.
+         @return The name of the implementation.
+         */
+        string getImplementationName() noexcept;
+        
+        //! Convert a float vector to a sample vector.
+        /** This function converts a float vector to a sample vector.
+         @param vectorsize The vector size.
+         @param in The float vector.
+         @param out The sample vector.
+         */
+        void fromFloat(const ulong vectorsize, float const* in, sample* out) noexcept;
+        
+        //! Convert a sample vector to a float vector.
+        /** This function converts a sample vector to a float vector.
+         @param vectorsize The vector size.
+         @param in The sample vector.
+         @param out The float vector.
+         */
+        void toFloat(const ulong vectorsize, sample const* in, float* out) noexcept;
+        
+        //! Deinterleave and convert a float buffer to a sample matrix.
+        /** This function deinterleaves and converts an interleaved float buffer to a sample matrix in one pass.
+         @param vectorsize The vector size.
+         @param nchannels The number of channels.
+         @param in The interleaved float buffer.
+         @param out The sample matrix.
+         */
+        void deinterleave(const ulong vectorsize, const ulong nchannels, float const* in, sample* out) noexcept;
+        
+        //! Interleave and convert a sample matrix to a float buffer.
+        /** This function interleaves and converts a sample matrix to an interleaved float buffer in one pass.
+         @param vectorsize The vector size.
+         @param nchannels The number of channels.
+         @param in The sample matrix.
+         @param out The interleaved float buffer.
+         */
+        void interleave(const ulong vectorsize, const ulong nchannels, sample const* in, float* out) noexcept;
+        
+        //! Extract and convert a channel of a float buffer.
+        /** This function extracts one channel of an interleaved float buffer to a sample vector. It is used when only some channels of the buffer are active.
+         @param vectorsize The vector size.
+         @param nchannels The number of channels of the buffer.
+         @param channel The index of the channel.
+         @param in The interleaved float buffer.
+         @param out The sample vector.
+         */
+        void deinterleave(const ulong vectorsize, const ulong nchannels, const ulong channel, float const* in, sample* out) noexcept;
+        
+        //! Convert and insert a channel in a float buffer.
+        /** This function writes a sample vector to one channel of an interleaved float buffer, the other channels are left unchanged. It is used when only some channels of the buffer are active.
+         @param vectorsize The vector size.
+         @param nchannels The number of channels of the buffer.
+         @param channel The index of the channel.
+         @param in The sample vector.
+         @param out The interleaved float buffer.
+         */
+        void interleave(const ulong vectorsize, const ulong nchannels, const ulong channel, sample const* in, float* out) noexcept;
+        
+        //! A deinterleaving kernel.
+        /** The kernel has the arguments of deinterleave(), a kernel specialized for a number of channels ignores the number it receives.
+         */
+        typedef void (*Deinterleaver)(const ulong vectorsize, const ulong nchannels, float const* in, sample* out);
+        
+        //! An interleaving kernel.
+        /** The kernel has the arguments of interleave(), a kernel specialized for a number of channels ignores the number it receives.
+         */
+        typedef void (*Interleaver)(const ulong vectorsize, const ulong nchannels, sample const* in, float* out);
+        
+        //! Retrieve the name of the selected specialized implementation.
+        /** This function retrieves the name of the implementation of the kernels specialized for a number of channels selected for the CPU.
+         @return The name of the implementation.
+         */
+        string getLayoutImplementationName() noexcept;
+        
+        //! Retrieve the deinterleaving kernel for a number of channels.
+        /** This function retrieves the kernel specialized for 1, 2, 4 or 8 channels, a kernel that does nothing for no channel, or the generic kernel for the other numbers. It should be called once when the stream starts so the callback calls the kernel directly.
+         @param nchannels The number of channels.
+         @return The kernel.
+         */
+        Deinterleaver getDeinterleaver(const ulong nchannels) noexcept;
+        
+        //! Retrieve the interleaving kernel for a number of channels.
+        /** This function retrieves the kernel specialized for 1, 2, 4 or 8 channels, a kernel that does nothing for no channel, or the generic kernel for the other numbers. It should be called once when the stream starts so the callback calls the kernel directly.
+         @param nchannels The number of channels.
+         @return The kernel.
+         */
+        Interleaver getInterleaver(const ulong nchannels) noexcept;
+        
+        //! The state of the dither.
+        /** The dither adds a triangular noise of one least significant bit to the integer conversions. Each device output must use its own state.
+         */
+        struct Dither
+        {
+            uint32_t state[4];
+            
+            Dither(const uint32_t seed = 0x9e3779b9) noexcept
+            {
+                for(ulong i = 0; i < 4; i++)
+                {
+                    state[i] = (seed + uint32_t(i) * 0x6c078965u) | 1u;
+                }
+            }
+        };
+        
+        //! Retrieve the name of the selected integer implementation.
+        /** This function retrieves the name of the implementation of the integer conversions selected for the CPU.
+         @return The name of the implementation.
+         */
+        string getIntegerImplementationName() noexcept;
+        
+        //! Convert 16 bits integers to floats.
+        /** This function converts signed 16 bits integers to floats between -1 and 1.
+         @param size The number of values.
+         @param in The integers.
+         @param out The floats.
+         */
+        void fromInt16(const ulong size, int16_t const* in, float* out) noexcept;
+        
+        //! Convert packed 24 bits integers to floats.
+        /** This function converts signed 24 bits integers packed in 3 bytes to floats between -1 and 1.
+         @param size The number of values.
+         @param in The packed integers.
+         @param out The floats.
+         */
+        void fromInt24(const ulong size, uint8_t const* in, float* out) noexcept;
+        
+        //! Convert 32 bits integers to floats.
+        /** This function converts signed 32 bits integers to floats between -1 and 1.
+         @param size The number of values.
+         @param in The integers.
+         @param out The floats.
+         */
+        void fromInt32(const ulong size, int32_t const* in, float* out) noexcept;
+        
+        //! Convert floats to 16 bits integers.
+        /** This function converts floats to signed 16 bits integers with saturation.
+         @param size The number of values.
+         @param in The floats.
+         @param out The integers.
+         @param dither The state of the dither or nullptr for no dither.
+         */
+        void toInt16(const ulong size, float const* in, int16_t* out, Dither* dither) noexcept;
+        
+        //! Convert floats to packed 24 bits integers.
+        /** This function converts floats to signed 24 bits integers packed in 3 bytes with saturation.
+         @param size The number of values.
+         @param in The floats.
+         @param out The packed integers.
+         @param dither The state of the dither or nullptr for no dither.
+         */
+        void toInt24(const ulong size, float const* in, uint8_t* out, Dither* dither) noexcept;
+        
+        //! Convert floats to 32 bits integers.
+        /** This function converts floats to signed 32 bits integers with saturation. The resolution of the floats is lower than the one of the integers so there is no dither.
+         @param size The number of values.
+         @param in The floats.
+         @param out The integers.
+         */
+        void toInt32(const ulong size, float const* in, int32_t* out) noexcept;
+    }
+}
+
+#endif
+
+
@@ -0,0 +1,145 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+*/
+
+#include "KiwiDspLatency.h"
+
+namespace Kiwi
+{
+    DspLatencyProbe::DspLatencyProbe() noexcept :
+    m_input(0),
+    m_output(0),
+    m_position(0),
+    m_state(Idle)
+    {
+        ;
+    }
+    
+    DspLatencyProbe::~DspLatencyProbe()
+    {
+        ;
+    }
+    
+    void DspLatencyProbe::cancel() noexcept
+    {
+        // Waits for the audio thread to release the recording.
+        int state = m_state.load();
+        while(state == Processing || !m_state.compare_exchange_weak(state, Idle))
+        {
+            this_thread::yield();
+            state = m_state.load();
+        }
+    }
+    
+    void DspLatencyProbe::prepare(const ulong input, const ulong output, const Stimulus stimulus, const ulong maxlatency)
+    {
+        cancel();
+        m_input     = input;
+        m_output    = output;
+        m_position  = 0;
+        if(stimulus == Impulse)
+        {
+            m_stimulus.assign(1, 0.5f);
+        }
+        else
+        {
+            // A maximum length sequence of order 12 from a Galois LFSR.
+            m_stimulus.resize(4095);
+            uint32_t state = 1;
+            for(ulong i = 0; i < 4095; i++)
+            {
+                m_stimulus[i] = (state & 1) ? 0.25f : -0.25f;
+                state = (state >> 1) ^ ((state & 1) ? 0xE08u : 0u);
+            }
+        }
+        m_recording.assign(m_stimulus.size() + maxlatency, 0.f);
+        m_state.store(Running);
+    }
+    
+    ulong DspLatencyProbe::getDuration() const noexcept
+    {
+        return m_recording.size();
+    }
+    
+    bool DspLatencyProbe::isDone() const noexcept
+    {
+        return m_state.load() == Done;
+    }
+    
+    long DspLatencyProbe::analyze() noexcept
+    {
+        if(m_state.load() != Done)
+        {
+            cancel();
+            return -1;
+        }
+        m_state.store(Idle);
+        
+        const ulong size    = m_stimulus.size();
+        const ulong nlags   = m_recording.size() - size + 1;
+        double peak = 0., sum = 0.;
+        long lag = -1;
+        for(ulong i = 0; i < nlags; i++)
+        {
+            double value = 0.;
+            for(ulong j = 0; j < size; j++)
+            {
+                value += double(m_stimulus[j]) * double(m_recording[i + j]);
+            }
+            value = fabs(value);
+            sum += value;
+            if(value > peak)
+            {
+                peak = value;
+                lag  = long(i);
+            }
+        }
+        
+        // The peak must stand out of the mean correlation, otherwise the
+        // recording is only noise and the loopback isn't connected.
+        const double mean = sum / double(nlags);
+        return (peak > 1e-6 && peak > mean * 8.) ? lag : -1;
+    }
+    
+    void DspLatencyProbe::process(const ulong nframes, float const* input, const ulong instride, float* output, const ulong outstride) noexcept
+    {
+        int state = Running;
+        if(!m_state.compare_exchange_strong(state, Processing, memory_order_acquire))
+        {
+            return;
+        }
+        
+        const ulong size    = m_stimulus.size();
+        const ulong length  = m_recording.size();
+        for(ulong i = 0; i < nframes && m_position < length; i++, m_position++)
+        {
+            if(output)
+            {
+                output[i * outstride] = m_position < size ? m_stimulus[m_position] : 0.f;
+            }
+            m_recording[m_position] = input ? input[i * instride] : 0.f;
+        }
+        m_state.store(m_position < length ? Running : Done, memory_order_release);
+    }
+}
+
+
@@ -0,0 +1,145 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+ */
+
+#ifndef __DEF_KIWI_DSP_LATENCY__
+#define __DEF_KIWI_DSP_LATENCY__
+
+#include "../KiwiDsp/KiwiDsp.h"
+
+namespace Kiwi
+{
+    // ================================================================================ //
+    //                                  DSP LATENCY PROBE                               //
+    // ================================================================================ //
+    
+    //! The loopback measure of the latency of a device.
+    /** The probe plays a stimulus on an output channel, records an input channel connected to it with a cable and finds the delay of the stimulus in the recording. The stimulus is an impulse or a maximum length sequence, the sequence is more robust to the noise. The control thread prepares the probe and analyzes the recording, the audio thread only plays and records, the recording is owned by one thread at a time.
+     */
+    class DspLatencyProbe
+    {
+    public:
+        enum Stimulus
+        {
+            Impulse     = 0,
+            Sequence    = 1
+        };
+    
+    private:
+        enum State
+        {
+            Idle        = 0,
+            Running     = 1,
+            Processing  = 2,
+            Done        = 3
+        };
+        
+        vector<float>   m_stimulus;
+        vector<float>   m_recording;
+        ulong           m_input;
+        ulong           m_output;
+        ulong           m_position;
+        atomic<int>     m_state;
+        
+        void cancel() noexcept;
+    
+    public:
+    
+        //! Constructor
+        /**
+         */
+        DspLatencyProbe() noexcept;
+        
+        //! Destructor
+        /**
+         */
+        ~DspLatencyProbe();
+        
+        //! Prepare a measure.
+        /** This function stops the current measure, builds the stimulus then starts a new measure. It must be called by the control thread.
+         @param input The index of the input channel.
+         @param output The index of the output channel.
+         @param stimulus The stimulus.
+         @param maxlatency The maximum latency in samples.
+         */
+        void prepare(const ulong input, const ulong output, const Stimulus stimulus, const ulong maxlatency);
+        
+        //! Retrieve the duration of a measure.
+        /** This function retrieves the number of samples the audio thread needs to complete the current measure.
+         @return The number of samples.
+         */
+        ulong getDuration() const noexcept;
+        
+        //! Retrieve if the measure is done.
+        /** This function retrieves if the audio thread has recorded all the samples of the measure.
+         @return True if the measure is done, otherwise false.
+         */
+        bool isDone() const noexcept;
+        
+        //! Analyze the measure.
+        /** This function finds the stimulus in the recording and stops the measure. It must be called by the control thread.
+         @return The round-trip latency in samples or -1 if the measure isn't done or the stimulus wasn't found.
+         */
+        long analyze() noexcept;
+        
+        //! Play and record a buffer.
+        /** This function writes the stimulus over an output channel and records an input channel. It must be called by the audio thread after the tick. It does nothing if no measure is running.
+         @param nframes The number of frames.
+         @param input The first sample of the input channel or nullptr.
+         @param instride The distance between two samples of the input channel.
+         @param output The first sample of the output channel or nullptr.
+         @param outstride The distance between two samples of the output channel.
+         */
+        void process(const ulong nframes, float const* input, const ulong instride, float* output, const ulong outstride) noexcept;
+        
+        //! Retrieve the input channel.
+        /** This function retrieves the index of the input channel of the current measure.
+         @return The index of the input channel.
+         */
+        inline ulong getInputChannel() const noexcept
+        {
+            return m_input;
+        }
+        
+        //! Retrieve the output channel.
+        /** This function retrieves the index of the output channel of the current measure.
+         @return The index of the output channel.
+         */
+        inline ulong getOutputChannel() const noexcept
+        {
+            return m_output;
+        }
+        
+        //! Retrieve if a measure is running.
+        /** This function retrieves if the audio thread must call process().
+         @return True if a measure is running, otherwise false.
+         */
+        inline bool isRunning() const noexcept
+        {
+            return m_state.load(memory_order_acquire) == Running;
+        }
+    };
+}
+
+#endif
+
+
@@ -0,0 +1,916 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+*/
+
+#include "KiwiDspOffline.h"
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+namespace Kiwi
+{
+    // ================================================================================ //
+    //                                  OFFLINE GENERATOR                               //
+    // ================================================================================ //
+    
+    KiwiOfflineDspDeviceManager::Generator::Generator(Method method) :
+    m_method(method),
+    m_position(0)
+    {
+        ;
+    }
+    
+    void KiwiOfflineDspDeviceManager::Generator::read(const ulong nchannels, const ulong vectorsize, sample* matrix)
+    {
+        for(ulong i = 0; i < nchannels; i++)
+        {
+            m_method(i, m_position, vectorsize, matrix + i * vectorsize);
+        }
+        m_position += vectorsize;
+    }
+    
+    // ================================================================================ //
+    //                                  OFFLINE FILE INPUT                              //
+    // ================================================================================ //
+    
+    static inline ulong readLittleEndian(char const* data, const ulong nbytes) noexcept
+    {
+        ulong value = 0;
+        for(ulong i = 0; i < nbytes; i++)
+        {
+            value |= ulong((unsigned char)data[i]) << (i * 8);
+        }
+        return value;
+    }
+    
+    // Only PCM and IEEE float can be decoded, the other encodings have no
+    // channel so the file is rejected.
+    static inline void readFormat(char const* format, const size_t size, ulong& nchannels, ulong& samplerate, ulong& bits, bool& isfloat) noexcept
+    {
+        ulong tag   = readLittleEndian(format, 2);
+        nchannels   = readLittleEndian(format + 2, 2);
+        samplerate  = readLittleEndian(format + 4, 4);
+        bits        = readLittleEndian(format + 14, 2);
+        if(tag == 0xFFFE && size >= 26)
+        {
+            // The extensible format stores the tag in its sub-format.
+            tag = readLittleEndian(format + 24, 2);
+        }
+        isfloat = (tag == 3);
+        if(tag != 1 && tag != 3)
+        {
+            nchannels = 0;
+        }
+    }
+    
+    KiwiOfflineDspDeviceManager::FileInput::FileInput(string const& path, const bool raw) :
+    m_file(path.c_str(), ios::binary),
+    m_nchannels(0),
+    m_samplerate(0),
+    m_bits(0),
+    m_float(false),
+    m_remaining(0)
+    {
+        if(!m_file.is_open())
+        {
+            cout << "Offline error: can't open " << path << endl;
+            return;
+        }
+        if(raw)
+        {
+            m_file.seekg(0, ios::end);
+            m_remaining = ulong(m_file.tellg());
+            m_file.seekg(0, ios::beg);
+            m_nchannels = 1;
+            m_bits      = 32;
+            m_float     = true;
+            return;
+        }
+        
+        char header[12];
+        if(!m_file.read(header, 12) || string(header, 4) != "RIFF" || string(header + 8, 4) != "WAVE")
+        {
+            cout << "Offline error: " << path << " isn't a WAV file" << endl;
+            return;
+        }
+        char chunk[8];
+        while(m_file.read(chunk, 8))
+        {
+            const string name(chunk, 4);
+            const ulong size = readLittleEndian(chunk + 4, 4);
+            if(name == "fmt ")
+            {
+                vector<char> format(size);
+                if(size < 16 || !m_file.read(format.data(), size))
+                {
+                    break;
+                }
+                readFormat(format.data(), size, m_nchannels, m_samplerate, m_bits, m_float);
+                if(size & 1)
+                {
+                    m_file.seekg(1, ios::cur);
+                }
+            }
+            else if(name == "data")
+            {
+                m_remaining = size;
+                break;
+            }
+            else
+            {
+                m_file.seekg(size + (size & 1), ios::cur);
+            }
+        }
+        if(!isValid())
+        {
+            cout << "Offline error: the format of " << path << " isn't supported" << endl;
+            m_remaining = 0;
+        }
+    }
+    
+    KiwiOfflineDspDeviceManager::FileInput::~FileInput()
+    {
+        ;
+    }
+    
+    bool KiwiOfflineDspDeviceManager::FileInput::isValid() const noexcept
+    {
+        return m_nchannels && ((m_float && m_bits == 32) || (!m_float && (m_bits == 16 || m_bits == 24 || m_bits == 32)));
+    }
+    
+    ulong KiwiOfflineDspDeviceManager::FileInput::getNumberOfChannels() const noexcept
+    {
+        return m_nchannels;
+    }
+    
+    ulong KiwiOfflineDspDeviceManager::FileInput::getSampleRate() const noexcept
+    {
+        return m_samplerate;
+    }
+    
+    void KiwiOfflineDspDeviceManager::FileInput::read(const ulong nchannels, const ulong vectorsize, sample* matrix)
+    {
+        Signal::vclear(nchannels * vectorsize, matrix);
+        if(!isValid() || !m_remaining)
+        {
+            return;
+        }
+        
+        const ulong nbytes  = m_bits / 8;
+        const ulong nframes = min(vectorsize, m_remaining / (nbytes * m_nchannels));
+        const ulong nread   = min(nchannels, m_nchannels);
+        m_buffer.resize(vectorsize * nbytes * m_nchannels);
+        if(!m_file.read(m_buffer.data(), nframes * nbytes * m_nchannels))
+        {
+            m_remaining = 0;
+            return;
+        }
+        m_remaining -= nframes * nbytes * m_nchannels;
+        
+        for(ulong i = 0; i < nread; i++)
+        {
+            char const* src = m_buffer.data() + i * nbytes;
+            sample* dest    = matrix + i * vectorsize;
+            for(ulong j = 0; j < nframes; j++, src += nbytes * m_nchannels)
+            {
+                if(m_float)
+                {
+                    float value;
+                    memcpy(&value, src, sizeof(float));
+                    dest[j] = sample(value);
+                }
+                else if(m_bits == 16)
+                {
+                    dest[j] = sample(int16_t(readLittleEndian(src, 2)) / 32768.);
+                }
+                else if(m_bits == 24)
+                {
+                    dest[j] = sample(int32_t(readLittleEndian(src, 3) << 8) / 2147483648.);
+                }
+                else
+                {
+                    dest[j] = sample(int32_t(readLittleEndian(src, 4)) / 2147483648.);
+                }
+            }
+        }
+    }
+    
+    // ================================================================================ //
+    //                                  OFFLINE MAPPED FILE INPUT                       //
+    // ================================================================================ //
+    
+    // The GUIDs of the chunks of a Wave64 file.
+    static const char w64_riff[16] = {'r', 'i', 'f', 'f', '\x2E', '\x91', '\xCF', '\x11', '\xA5', '\xD6', '\x28', '\xDB', '\x04', '\xC1', '\x00', '\x00'};
+    static const char w64_wave[16] = {'w', 'a', 'v', 'e', '\xF3', '\xAC', '\xD3', '\x11', '\x8C', '\xD1', '\x00', '\xC0', '\x4F', '\x8E', '\xDB', '\x8A'};
+    static const char w64_fmt[16]  = {'f', 'm', 't', ' ', '\xF3', '\xAC', '\xD3', '\x11', '\x8C', '\xD1', '\x00', '\xC0', '\x4F', '\x8E', '\xDB', '\x8A'};
+    static const char w64_data[16] = {'d', 'a', 't', 'a', '\xF3', '\xAC', '\xD3', '\x11', '\x8C', '\xD1', '\x00', '\xC0', '\x4F', '\x8E', '\xDB', '\x8A'};
+    
+    // The granularity of the prefetch.
+    static const size_t page_size = 4096;
+    
+    KiwiOfflineDspDeviceManager::MappedFileInput::MappedFileInput(vector<string> const& paths, const bool raw, const ulong prefetch) :
+    m_valid(!paths.empty()),
+    m_prefetch(prefetch),
+    m_position(0),
+    m_target(prefetch),
+    m_touched(0),
+    m_running(false)
+    {
+        m_files.resize(paths.size());
+        for(ulong i = 0; i < paths.size(); i++)
+        {
+            if(map(paths[i], raw, m_files[i]))
+            {
+                for(ulong j = 0; j < m_files[i].nchannels; j++)
+                {
+                    m_channels.push_back(make_pair(i, j));
+                }
+            }
+            else
+            {
+                m_valid = false;
+            }
+        }
+        if(m_prefetch && !m_channels.empty())
+        {
+            m_running = true;
+            m_thread = thread(&MappedFileInput::run, this);
+        }
+    }
+    
+    KiwiOfflineDspDeviceManager::MappedFileInput::~MappedFileInput()
+    {
+        if(m_thread.joinable())
+        {
+            {
+                lock_guard<mutex> guard(m_mutex);
+                m_running = false;
+            }
+            m_condition.notify_one();
+            m_thread.join();
+        }
+        for(ulong i = 0; i < m_files.size(); i++)
+        {
+            unmap(m_files[i]);
+        }
+    }
+    
+    bool KiwiOfflineDspDeviceManager::MappedFileInput::map(string const& path, const bool raw, File& file)
+    {
+        file = {nullptr, 0, nullptr, nullptr, 0, 0, 0, false, 0};
+#if defined(__linux__) || defined(__APPLE__)
+        const int fd = open(path.c_str(), O_RDONLY);
+        struct stat status;
+        if(fd >= 0 && fstat(fd, &status) == 0 && status.st_size > 0)
+        {
+            void* data = mmap(nullptr, size_t(status.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if(data != MAP_FAILED)
+            {
+                madvise(data, size_t(status.st_size), MADV_SEQUENTIAL);
+                file.data = (char const*)data;
+                file.size = size_t(status.st_size);
+            }
+        }
+        if(fd >= 0)
+        {
+            close(fd);
+        }
+#elif defined(_WIN32)
+        HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        LARGE_INTEGER size;
+        if(handle != INVALID_HANDLE_VALUE && GetFileSizeEx(handle, &size) && size.QuadPart > 0)
+        {
+            HANDLE mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            void* data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+            if(data)
+            {
+                file.data   = (char const*)data;
+                file.size   = size_t(size.QuadPart);
+                file.handle = mapping;
+            }
+            else if(mapping)
+            {
+                CloseHandle(mapping);
+            }
+        }
+        if(handle != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(handle);
+        }
+#endif
+        if(!file.data)
+        {
+            cout << "Offline error: can't map " << path << endl;
+            return false;
+        }
+        
+        size_t nbytes = 0;
+        if(raw)
+        {
+            file.samples    = file.data;
+            file.nchannels  = 1;
+            file.bits       = 32;
+            file.isfloat    = true;
+            nbytes          = file.size;
+        }
+        else if(file.size >= 12 && string(file.data, 4) == "RIFF" && string(file.data + 8, 4) == "WAVE")
+        {
+            for(size_t offset = 12; offset + 8 <= file.size;)
+            {
+                const string name(file.data + offset, 4);
+                const size_t size = readLittleEndian(file.data + offset + 4, 4);
+                if(name == "fmt " && size >= 16 && offset + 8 + size <= file.size)
+                {
+                    readFormat(file.data + offset + 8, size, file.nchannels, file.samplerate, file.bits, file.isfloat);
+                }
+                else if(name == "data")
+                {
+                    // An unfinished recording has an empty or a wrong size.
+                    file.samples = file.data + offset + 8;
+                    nbytes = (size && size <= file.size - offset - 8) ? size : file.size - offset - 8;
+                    break;
+                }
+                offset += 8 + size + (size & 1);
+            }
+        }
+        else if(file.size >= 40 && memcmp(file.data, w64_riff, 16) == 0 && memcmp(file.data + 24, w64_wave, 16) == 0)
+        {
+            for(size_t offset = 40; offset + 24 <= file.size;)
+            {
+                char const* guid = file.data + offset;
+                const uint64_t size = uint64_t(readLittleEndian(guid + 16, 4)) | (uint64_t(readLittleEndian(guid + 20, 4)) << 32);
+                if(memcmp(guid, w64_fmt, 16) == 0 && size >= 40 && offset + size <= file.size)
+                {
+                    readFormat(guid + 24, size_t(size - 24), file.nchannels, file.samplerate, file.bits, file.isfloat);
+                }
+                else if(memcmp(guid, w64_data, 16) == 0)
+                {
+                    file.samples = guid + 24;
+                    nbytes = (size > 24 && size - 24 <= file.size - offset - 24) ? size_t(size - 24) : file.size - offset - 24;
+                    break;
+                }
+                if(size < 24)
+                {
+                    break;
+                }
+                offset += size_t((size + 7) & ~uint64_t(7));
+            }
+        }
+        
+        if(!file.samples || !file.nchannels || !((file.isfloat && file.bits == 32) || (!file.isfloat && (file.bits == 16 || file.bits == 24 || file.bits == 32))))
+        {
+            cout << "Offline error: the format of " << path << " isn't supported" << endl;
+            unmap(file);
+            return false;
+        }
+        file.nframes = nbytes / (file.nchannels * (file.bits / 8));
+        return true;
+    }
+    
+    void KiwiOfflineDspDeviceManager::MappedFileInput::unmap(File& file) noexcept
+    {
+        if(file.data)
+        {
+#if defined(__linux__) || defined(__APPLE__)
+            munmap(const_cast<char*>(file.data), file.size);
+#elif defined(_WIN32)
+            UnmapViewOfFile(file.data);
+            CloseHandle(file.handle);
+#endif
+        }
+        file = {nullptr, 0, nullptr, nullptr, 0, 0, 0, false, 0};
+    }
+    
+    bool KiwiOfflineDspDeviceManager::MappedFileInput::isValid() const noexcept
+    {
+        return m_valid;
+    }
+    
+    ulong KiwiOfflineDspDeviceManager::MappedFileInput::getNumberOfChannels() const noexcept
+    {
+        return m_channels.size();
+    }
+    
+    ulong KiwiOfflineDspDeviceManager::MappedFileInput::getSampleRate() const noexcept
+    {
+        for(ulong i = 0; i < m_files.size(); i++)
+        {
+            if(m_files[i].samplerate)
+            {
+                return m_files[i].samplerate;
+            }
+        }
+        return 0;
+    }
+    
+    void KiwiOfflineDspDeviceManager::MappedFileInput::touch(const ulong from, const ulong to) const noexcept
+    {
+        for(ulong i = 0; i < m_files.size(); i++)
+        {
+            File const& file = m_files[i];
+            if(!file.samples || from >= file.nframes)
+            {
+                continue;
+            }
+            const size_t framesize = file.nchannels * (file.bits / 8);
+            const uintptr_t begin  = uintptr_t(file.samples + from * framesize) & ~uintptr_t(page_size - 1);
+            const uintptr_t end    = uintptr_t(file.samples + min(to, file.nframes) * framesize);
+#if defined(__linux__) || defined(__APPLE__)
+            madvise((void *)begin, size_t(end - begin), MADV_WILLNEED);
+#endif
+            char sum = 0;
+            for(uintptr_t page = max(begin, uintptr_t(file.data)); page < end; page += page_size)
+            {
+                sum += *(volatile char const*)page;
+            }
+            (void)sum;
+        }
+    }
+    
+    void KiwiOfflineDspDeviceManager::MappedFileInput::run()
+    {
+        unique_lock<mutex> lock(m_mutex);
+        while(m_running)
+        {
+            const ulong target  = m_target.load();
+            const ulong touched = m_touched.load();
+            if(touched < target)
+            {
+                lock.unlock();
+                touch(touched, target);
+                m_touched.store(target);
+                lock.lock();
+            }
+            else
+            {
+                m_condition.wait(lock);
+            }
+        }
+    }
+    
+    void KiwiOfflineDspDeviceManager::MappedFileInput::prepare(const ulong vectorsize)
+    {
+        if(m_running)
+        {
+            {
+                lock_guard<mutex> guard(m_mutex);
+                m_target.store(m_position + vectorsize + m_prefetch);
+            }
+            m_condition.notify_one();
+        }
+        if(m_touched.load() < m_position + vectorsize)
+        {
+            // The prefetch is late, the pages are loaded here rather than
+            // during the tick.
+            touch(m_position, m_position + vectorsize);
+        }
+    }
+    
+    void KiwiOfflineDspDeviceManager::MappedFileInput::convert(const ulong channel, const ulong vectorsize, sample* vec) const noexcept
+    {
+        File const& file    = m_files[m_channels[channel].first];
+        const ulong nbytes  = file.bits / 8;
+        const ulong step    = nbytes * file.nchannels;
+        const ulong nframes = m_position < file.nframes ? min(vectorsize, file.nframes - m_position) : 0ul;
+        char const* src     = file.samples + m_position * step + m_channels[channel].second * nbytes;
+        for(ulong j = 0; j < nframes; j++, src += step)
+        {
+            if(file.isfloat)
+            {
+                float value;
+                memcpy(&value, src, sizeof(float));
+                vec[j] = sample(value);
+            }
+            else if(file.bits == 16)
+            {
+                vec[j] = sample(int16_t(readLittleEndian(src, 2)) / 32768.);
+            }
+            else if(file.bits == 24)
+            {
+                vec[j] = sample(int32_t(readLittleEndian(src, 3) << 8) / 2147483648.);
+            }
+            else
+            {
+                vec[j] = sample(int32_t(readLittleEndian(src, 4)) / 2147483648.);
+            }
+        }
+        if(nframes < vectorsize)
+        {
+            Signal::vclear(vectorsize - nframes, vec + nframes);
+        }
+    }
+    
+    void KiwiOfflineDspDeviceManager::MappedFileInput::read(const ulong nchannels, const ulong vectorsize, sample* matrix)
+    {
+        prepare(vectorsize);
+        for(ulong i = 0; i < nchannels; i++)
+        {
+            if(i < m_channels.size())
+            {
+                convert(i, vectorsize, matrix + i * vectorsize);
+            }
+            else
+            {
+                Signal::vclear(vectorsize, matrix + i * vectorsize);
+            }
+        }
+        m_position += vectorsize;
+    }
+    
+    void KiwiOfflineDspDeviceManager::MappedFileInput::fetch(const ulong nchannels, const ulong vectorsize, sample* matrix, sample const** channels)
+    {
+        prepare(vectorsize);
+        for(ulong i = 0; i < nchannels; i++)
+        {
+            sample* vec = matrix + i * vectorsize;
+            channels[i] = vec;
+            if(i >= m_channels.size())
+            {
+                Signal::vclear(vectorsize, vec);
+                continue;
+            }
+            File const& file = m_files[m_channels[i].first];
+            char const* src  = file.samples + m_position * sizeof(float);
+            if(sizeof(sample) == sizeof(float) && file.isfloat && file.nchannels == 1 && m_position + vectorsize <= file.nframes && (uintptr_t(src) % DspArena::alignment) == 0)
+            {
+                channels[i] = (sample const*)src;
+            }
+            else
+            {
+                convert(i, vectorsize, vec);
+            }
+        }
+        m_position += vectorsize;
+    }
+    
+    // ================================================================================ //
+    //                                  OFFLINE FILE OUTPUT                             //
+    // ================================================================================ //
+    
+    static inline void writeLittleEndian(ofstream& file, const ulong value, const ulong nbytes)
+    {
+        for(ulong i = 0; i < nbytes; i++)
+        {
+            file.put(char((value >> (i * 8)) & 0xff));
+        }
+    }
+    
+    KiwiOfflineDspDeviceManager::FileOutput::FileOutput(string const& path, const ulong samplerate, const bool raw) :
+    m_file(path.c_str(), ios::binary | ios::trunc),
+    m_samplerate(samplerate),
+    m_raw(raw),
+    m_nchannels(0),
+    m_nbytes(0)
+    {
+        if(!m_file.is_open())
+        {
+            cout << "Offline error: can't open " << path << endl;
+        }
+        else if(!m_raw)
+        {
+            writeHeader();
+        }
+    }
+    
+    KiwiOfflineDspDeviceManager::FileOutput::~FileOutput()
+    {
+        if(m_file.is_open() && !m_raw)
+        {
+            m_file.seekp(0, ios::beg);
+            writeHeader();
+        }
+    }
+    
+    bool KiwiOfflineDspDeviceManager::FileOutput::isValid() const noexcept
+    {
+        return m_file.is_open();
+    }
+    
+    void KiwiOfflineDspDeviceManager::FileOutput::writeHeader()
+    {
+        const ulong nchannels = max(m_nchannels, 1ul);
+        m_file.write("RIFF", 4);
+        writeLittleEndian(m_file, 36 + m_nbytes, 4);
+        m_file.write("WAVE", 4);
+        m_file.write("fmt ", 4);
+        writeLittleEndian(m_file, 16, 4);
+        writeLittleEndian(m_file, 3, 2);
+        writeLittleEndian(m_file, nchannels, 2);
+        writeLittleEndian(m_file, m_samplerate, 4);
+        writeLittleEndian(m_file, m_samplerate * nchannels * sizeof(float), 4);
+        writeLittleEndian(m_file, nchannels * sizeof(float), 2);
+        writeLittleEndian(m_file, 32, 2);
+        m_file.write("data", 4);
+        writeLittleEndian(m_file, m_nbytes, 4);
+    }
+    
+    void KiwiOfflineDspDeviceManager::FileOutput::write(const ulong nchannels, const ulong vectorsize, sample const* matrix)
+    {
+        if(!isValid() || !nchannels)
+        {
+            return;
+        }
+        if(!m_nchannels)
+        {
+            m_nchannels = nchannels;
+        }
+        
+        const ulong nwrite = min(nchannels, m_nchannels);
+        m_buffer.assign(vectorsize * m_nchannels, 0.f);
+        for(ulong i = 0; i < nwrite; i++)
+        {
+            sample const* src = matrix + i * vectorsize;
+            float* dest = m_buffer.data() + i;
+            for(ulong j = 0; j < vectorsize; j++, dest += m_nchannels)
+            {
+                *dest = float(src[j]);
+            }
+        }
+        m_file.write((char const*)m_buffer.data(), m_buffer.size() * sizeof(float));
+        m_nbytes += m_buffer.size() * sizeof(float);
+    }
+    
+    // ================================================================================ //
+    //                                  OFFLINE DEVICE                                  //
+    // ================================================================================ //
+    
+    KiwiOfflineDspDeviceManager::KiwiOfflineDspDeviceManager() :
+    m_nins(2),
+    m_nouts(2),
+    m_samplerate(44100),
+    m_vectorsize(64),
+    m_sample_ins(nullptr),
+    m_sample_outs(nullptr),
+    m_position(0)
+    {
+        ;
+    }
+    
+    KiwiOfflineDspDeviceManager::~KiwiOfflineDspDeviceManager()
+    {
+        stop();
+    }
+    
+    void KiwiOfflineDspDeviceManager::getAvailableDrivers(vector<string>& drivers) const
+    {
+        drivers.clear();
+        drivers.push_back("Offline");
+    }
+    
+    string KiwiOfflineDspDeviceManager::getDriverName() const
+    {
+        return "Offline";
+    }
+    
+    void KiwiOfflineDspDeviceManager::getAvailableInputDevices(vector<string>& devices) const
+    {
+        devices.clear();
+        devices.push_back("Offline Input");
+    }
+    
+    void KiwiOfflineDspDeviceManager::getAvailableOutputDevices(vector<string>& devices) const
+    {
+        devices.clear();
+        devices.push_back("Offline Output");
+    }
+    
+    string KiwiOfflineDspDeviceManager::getInputDeviceName() const
+    {
+        return "Offline Input";
+    }
+    
+    string KiwiOfflineDspDeviceManager::getOutputDeviceName() const
+    {
+        return "Offline Output";
+    }
+    
+    ulong KiwiOfflineDspDeviceManager::getNumberOfInputs() const
+    {
+        return m_nins;
+    }
+    
+    ulong KiwiOfflineDspDeviceManager::getNumberOfOutputs() const
+    {
+        return m_nouts;
+    }
+    
+    void KiwiOfflineDspDeviceManager::getAvailableSampleRates(vector<ulong>& samplerates) const
+    {
+        samplerates.clear();
+        for(ulong i = 1; i < 6; i++)
+        {
+            samplerates.push_back(11025 * i);
+            samplerates.push_back(12000 * i);
+            samplerates.push_back(16000 * i);
+        }
+        sort(samplerates.begin(), samplerates.end());
+    }
+    
+    ulong KiwiOfflineDspDeviceManager::getSampleRate() const
+    {
+        return m_samplerate;
+    }
+    
+    void KiwiOfflineDspDeviceManager::getAvailableVectorSizes(vector<ulong>& vectorsizes) const
+    {
+        vectorsizes.clear();
+        for(ulong i = 1; i <= 8192; i *= 2)
+        {
+            vectorsizes.push_back(i);
+        }
+    }
+    
+    ulong KiwiOfflineDspDeviceManager::getVectorSize() const
+    {
+        return m_vectorsize;
+    }
+    
+    void KiwiOfflineDspDeviceManager::setDriver(string const&)
+    {
+        ;
+    }
+    
+    void KiwiOfflineDspDeviceManager::setInputDevice(string const&)
+    {
+        ;
+    }
+    
+    void KiwiOfflineDspDeviceManager::setOutputDevice(string const&)
+    {
+        ;
+    }
+    
+    void KiwiOfflineDspDeviceManager::setSampleRate(ulong const samplerate)
+    {
+        if(samplerate != getSampleRate() && isSampleRateAvailable(samplerate))
+        {
+            m_samplerate = samplerate;
+            if(m_sample_outs)
+            {
+                start();
+            }
+        }
+    }
+    
+    void KiwiOfflineDspDeviceManager::setVectorSize(ulong const vectorsize)
+    {
+        if(vectorsize != getVectorSize() && isVectorSizeAvailable(vectorsize))
+        {
+            m_vectorsize = vectorsize;
+            if(m_sample_outs)
+            {
+                start();
+            }
+        }
+    }
+    
+    void KiwiOfflineDspDeviceManager::setNumberOfInputs(ulong const nins)
+    {
+        if(nins != m_nins)
+        {
+            m_nins = nins;
+            if(m_sample_outs)
+            {
+                start();
+            }
+        }
+    }
+    
+    void KiwiOfflineDspDeviceManager::setNumberOfOutputs(ulong const nouts)
+    {
+        if(nouts != m_nouts)
+        {
+            m_nouts = nouts;
+            if(m_sample_outs)
+            {
+                start();
+            }
+        }
+    }
+    
+    void KiwiOfflineDspDeviceManager::setInput(sInput input)
+    {
+        m_input = input;
+        for(ulong i = 0; i < m_channel_ins.size(); i++)
+        {
+            m_channel_ins[i] = m_sample_ins + i * m_vectorsize;
+        }
+    }
+    
+    void KiwiOfflineDspDeviceManager::setOutput(sOutput output)
+    {
+        m_output = output;
+    }
+    
+    sample const* KiwiOfflineDspDeviceManager::getInputsSamples(const ulong channel) const noexcept
+    {
+        if(m_sample_ins && channel < getNumberOfInputs())
+        {
+            return m_channel_ins[channel];
+        }
+        else
+        {
+            return nullptr;
+        }
+    }
+    
+    sample* KiwiOfflineDspDeviceManager::getOutputsSamples(const ulong channel) const noexcept
+    {
+        if(m_sample_outs && channel < getNumberOfOutputs())
+        {
+            return m_sample_outs + channel * getVectorSize();
+        }
+        else
+        {
+            return nullptr;
+        }
+    }
+    
+    ulong KiwiOfflineDspDeviceManager::getPosition() const noexcept
+    {
+        return m_position;
+    }
+    
+    void KiwiOfflineDspDeviceManager::renderVectors(const ulong nvectors)
+    {
+        if(!m_sample_outs)
+        {
+            return;
+        }
+        const ulong nins    = m_nins;
+        const ulong nouts   = m_nouts;
+        const ulong vecsize = m_vectorsize;
+        for(ulong i = 0; i < nvectors; i++)
+        {
+            if(m_input)
+            {
+                m_input->fetch(nins, vecsize, m_sample_ins, m_channel_ins.data());
+            }
+            Signal::vclear(nouts * vecsize, m_sample_outs);
+            tick();
+            if(m_output)
+            {
+                m_output->write(nouts, vecsize, m_sample_outs);
+            }
+            m_position += vecsize;
+        }
+    }
+    
+    void KiwiOfflineDspDeviceManager::render(const double seconds)
+    {
+        if(seconds > 0. && m_vectorsize)
+        {
+            const ulong nsamples = ulong(ceil(seconds * double(m_samplerate)));
+            renderVectors((nsamples + m_vectorsize - 1) / m_vectorsize);
+        }
+    }
+    
+    void KiwiOfflineDspDeviceManager::stop()
+    {
+        m_sample_ins    = nullptr;
+        m_sample_outs   = nullptr;
+    }
+    
+    void KiwiOfflineDspDeviceManager::start()
+    {
+        stop();
+        const ulong insize  = DspArena::align(max(m_nins, 1ul) * m_vectorsize);
+        const ulong outsize = DspArena::align(max(m_nouts, 1ul) * m_vectorsize);
+        m_sample_ins    = m_arena.reserve(insize + outsize);
+        m_sample_outs   = m_sample_ins + insize;
+        Signal::vclear(insize + outsize, m_sample_ins);
+        m_channel_ins.resize(m_nins);
+        for(ulong i = 0; i < m_nins; i++)
+        {
+            m_channel_ins[i] = m_sample_ins + i * m_vectorsize;
+        }
+        m_position      = 0;
+    }
+}
+
+
@@ -0,0 +1,468 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+ */
+
+#ifndef __DEF_KIWI_DSP_OFFLINE__
+#define __DEF_KIWI_DSP_OFFLINE__
+
+#include "../KiwiDsp/KiwiDsp.h"
+#include "KiwiDspArena.h"
+#include <fstream>
+
+namespace Kiwi
+{
+    class KiwiOfflineDspDeviceManager : public DspDeviceManager
+    {
+    public:
+    
+        //! The input of the offline device.
+        /** The input fills the input matrix of the device before each tick.
+         */
+        class Input
+        {
+        public:
+            virtual ~Input() {}
+            
+            //! Read a vector.
+            /** This function fills the input matrix with the next vector. The matrix is made of one vector per channel.
+             @param nchannels The number of channels.
+             @param vectorsize The vector size.
+             @param matrix The input matrix.
+             */
+            virtual void read(const ulong nchannels, const ulong vectorsize, sample* matrix) = 0;
+            
+            //! Fetch a vector.
+            /** This function points the channels to the next vector. The default implementation reads the vector to the input matrix and points the channels to the matrix, an input that already holds the samples of a channel in the format of the matrix can point the channel to them instead of copying them.
+             @param nchannels The number of channels.
+             @param vectorsize The vector size.
+             @param matrix The input matrix.
+             @param channels The vectors of the channels.
+             */
+            virtual void fetch(const ulong nchannels, const ulong vectorsize, sample* matrix, sample const** channels)
+            {
+                read(nchannels, vectorsize, matrix);
+                for(ulong i = 0; i < nchannels; i++)
+                {
+                    channels[i] = matrix + i * vectorsize;
+                }
+            }
+        };
+        
+        //! The output of the offline device.
+        /** The output receives the output matrix of the device after each tick.
+         */
+        class Output
+        {
+        public:
+            virtual ~Output() {}
+            
+            //! Write a vector.
+            /** This function receives the last vector computed. The matrix is made of one vector per channel.
+             @param nchannels The number of channels.
+             @param vectorsize The vector size.
+             @param matrix The output matrix.
+             */
+            virtual void write(const ulong nchannels, const ulong vectorsize, sample const* matrix) = 0;
+        };
+        
+        //! An input that generates the signal.
+        /** The generator calls a function for each channel and each vector. The function receives the channel, the number of samples already generated for the channel, the vector size and the vector to fill.
+         */
+        class Generator : public Input
+        {
+        public:
+            typedef function<void(const ulong channel, const ulong position, const ulong vectorsize, sample* vec)> Method;
+            
+            Generator(Method method);
+            void read(const ulong nchannels, const ulong vectorsize, sample* matrix) override;
+        private:
+            const Method    m_method;
+            ulong           m_position;
+        };
+        
+        //! An input that reads an audio file.
+        /** The file can be a WAV file in 16, 24 or 32 bits integer or 32 bits float format, or raw interleaved 32 bits float samples. The signal is zero when the end of the file is reached.
+         */
+        class FileInput : public Input
+        {
+        public:
+            FileInput(string const& path, const bool raw = false);
+            ~FileInput();
+            
+            //! Retrieve if the file is valid.
+            /** This function retrieves if the file has been opened and its format is supported.
+             @return true if the file is valid, otherwise false.
+             */
+            bool isValid() const noexcept;
+            
+            //! Retrieve the number of channels of the file.
+            /** This function retrieves the number of channels of the file.
+             @return The number of channels of the file.
+             */
+            ulong getNumberOfChannels() const noexcept;
+            
+            //! Retrieve the sample rate of the file.
+            /** This function retrieves the sample rate of the file, zero for raw files.
+             @return The sample rate of the file.
+             */
+            ulong getSampleRate() const noexcept;
+            
+            void read(const ulong nchannels, const ulong vectorsize, sample* matrix) override;
+        private:
+            ifstream        m_file;
+            ulong           m_nchannels;
+            ulong           m_samplerate;
+            ulong           m_bits;
+            bool            m_float;
+            ulong           m_remaining;
+            vector<char>    m_buffer;
+        };
+        
+        //! An input that maps audio files in memory.
+        /** The files are mapped in memory instead of being read and their channels follow each other in the order of the files. A file can be a WAV or a Wave64 file in 16, 24 or 32 bits integer or 32 bits float format, or raw interleaved 32 bits float samples. The vectors of a mono file in the format of the samples are served in place when they are aligned like the matrix, the other channels are converted. In practice only the raw files start on an aligned address, the samples of a WAV file usually start after a header of 44 bytes so they are copied like the other formats. The live device managers have no input hook, the input is only available to the offline device manager. A thread touches the pages of the files ahead of the position so the page faults don't happen while the dsp ticks. The signal is zero when the end of a file is reached.
+         */
+        class MappedFileInput : public Input
+        {
+        public:
+            MappedFileInput(vector<string> const& paths, const bool raw = false, const ulong prefetch = 65536);
+            ~MappedFileInput();
+            
+            //! Retrieve if the files are valid.
+            /** This function retrieves if all the files have been mapped and their formats are supported.
+             @return true if the files are valid, otherwise false.
+             */
+            bool isValid() const noexcept;
+            
+            //! Retrieve the number of channels of the files.
+            /** This function retrieves the number of channels of all the files.
+             @return The number of channels of the files.
+             */
+            ulong getNumberOfChannels() const noexcept;
+            
+            //! Retrieve the sample rate of the files.
+            /** This function retrieves the sample rate of the first file that has one, zero for raw files.
+             @return The sample rate of the files.
+             */
+            ulong getSampleRate() const noexcept;
+            
+            void read(const ulong nchannels, const ulong vectorsize, sample* matrix) override;
+            void fetch(const ulong nchannels, const ulong vectorsize, sample* matrix, sample const** channels) override;
+        private:
+            struct File
+            {
+                char const*     data;
+                size_t          size;
+                void*           handle;
+                char const*     samples;
+                ulong           nchannels;
+                ulong           samplerate;
+                ulong           bits;
+                bool            isfloat;
+                ulong           nframes;
+            };
+            
+            //! Map a file.
+            /** This function maps a file and finds its samples.
+             @param path The path of the file.
+             @param raw True if the file has no header.
+             @param file The description of the file.
+             @return True if the file has been mapped and its format is supported.
+             */
+            static bool map(string const& path, const bool raw, File& file);
+            
+            //! Unmap a file.
+            /** This function releases the memory of a file.
+             @param file The description of the file.
+             */
+            static void unmap(File& file) noexcept;
+            
+            //! Touch the pages of the files.
+            /** This function reads a byte of each page of the files between two positions so the pages are in memory.
+             @param from The first frame.
+             @param to The frame after the last one.
+             */
+            void touch(const ulong from, const ulong to) const noexcept;
+            
+            //! Touch the pages ahead of the position.
+            /** This function is the loop of the prefetch thread.
+             */
+            void run();
+            
+            //! Convert a vector of a channel.
+            /** This function converts the samples of a channel from the current position to a vector, the missing frames are silent.
+             @param channel The index of the channel.
+             @param vectorsize The vector size.
+             @param vec The vector.
+             */
+            void convert(const ulong channel, const ulong vectorsize, sample* vec) const noexcept;
+            
+            //! Prepare the pages of a vector.
+            /** This function touches the pages of the next vector if the prefetch thread is late and wakes it up.
+             @param vectorsize The vector size.
+             */
+            void prepare(const ulong vectorsize);
+            
+            vector<File>                    m_files;
+            vector<pair<ulong, ulong>>      m_channels;
+            bool                            m_valid;
+            const ulong                     m_prefetch;
+            ulong                           m_position;
+            atomic<ulong>                   m_target;
+            atomic<ulong>                   m_touched;
+            bool                            m_running;
+            mutex                           m_mutex;
+            condition_variable              m_condition;
+            thread                          m_thread;
+        };
+        
+        //! An output that writes an audio file.
+        /** The file is written as a 32 bits float WAV file or as raw interleaved 32 bits float samples.
+         */
+        class FileOutput : public Output
+        {
+        public:
+            FileOutput(string const& path, const ulong samplerate, const bool raw = false);
+            ~FileOutput();
+            
+            //! Retrieve if the file is valid.
+            /** This function retrieves if the file has been opened.
+             @return true if the file is valid, otherwise false.
+             */
+            bool isValid() const noexcept;
+            
+            void write(const ulong nchannels, const ulong vectorsize, sample const* matrix) override;
+        private:
+            void writeHeader();
+            
+            ofstream        m_file;
+            const ulong     m_samplerate;
+            const bool      m_raw;
+            ulong           m_nchannels;
+            ulong           m_nbytes;
+            vector<float>   m_buffer;
+        };
+        
+        typedef shared_ptr<Input>   sInput;
+        typedef shared_ptr<Output>  sOutput;
+    
+    private:
+        ulong               m_nins;
+        ulong               m_nouts;
+        ulong               m_samplerate;
+        ulong               m_vectorsize;
+        DspArena            m_arena;
+        sample*             m_sample_ins;
+        sample*             m_sample_outs;
+        vector<sample const*> m_channel_ins;
+        sInput              m_input;
+        sOutput             m_output;
+        ulong               m_position;
+        
+        inline void tick() const noexcept
+        {
+            DspDeviceManager::tick();
+        }
+    
+    public:
+        //! Constructor
+        /**
+         */
+        KiwiOfflineDspDeviceManager();
+        
+        //! Destructor
+        /**
+         */
+        ~KiwiOfflineDspDeviceManager();
+        
+        //! Retrieve the names of the available drivers.
+        /** This function retrieves the names of the available drivers.
+         @param drivers The names of the drivers.
+         */
+        void getAvailableDrivers(vector<string>& drivers) const override;
+        
+        //! Retrieve the names of the current driver.
+        /** This function retrieves the names of the current driver.
+         @return The names of the current driver.
+         */
+        string getDriverName() const override;
+        
+        //! Retrieve the names of the available input devices.
+        /** This function retrieves the names of the available input devices.
+         @param devices The names of the input devices.
+         */
+        void getAvailableInputDevices(vector<string>& devices) const override;
+        
+        //! Retrieve the names of the available output devices.
+        /** This function retrieves the names of the available output devices.
+         @param devices The names of the output devices.
+         */
+        void getAvailableOutputDevices(vector<string>& devices) const override;
+        
+        //! Retrieve the names of the current input device.
+        /** This function retrieves the names of the current input device.
+         @return The name of the current input device.
+         */
+        string getInputDeviceName() const override;
+        
+        //! Retrieve the names of the current output device.
+        /** This function retrieves the names of the current output device.
+         @return The name of the current output device.
+         */
+        string getOutputDeviceName() const override;
+        
+        //! Retrieve the number of inputs of the current device.
+        /** This function retrieves the number of inputs of the current device.
+         @return The number of inputs of the current device.
+         */
+        ulong getNumberOfInputs() const override;
+        
+        //! Retrieve the number of outputs of the current device.
+        /** This function retrieves the number of outputs of the current device.
+         @return The number of outputs of the current device.
+         */
+        ulong getNumberOfOutputs() const override;
+        
+        //! Retrieve the available sample rates for the current devices.
+        /** This function retrieves the available sample rates for the current devices.
+         @param samplerates The available sample rates.
+         */
+        void getAvailableSampleRates(vector<ulong>& samplerates) const override;
+        
+        //! Retrieve the current sample rate.
+        /** This function retrieves the current sample rate.
+         @return The current sample rate.
+         */
+        ulong getSampleRate() const override;
+        
+        //! Retrieve the available vector sizes for the current devices.
+        /** This function retrieves the available vector sizes for the current devices.
+         @param vectorsizes The available vector sizes.
+         */
+        void getAvailableVectorSizes(vector<ulong>& vectorsizes) const override;
+        
+        //! Retrieve the current vector size.
+        /** This function retrieves the current vector size.
+         @return The current vector size.
+         */
+        ulong getVectorSize() const override;
+        
+        //! Set the driver.
+        /** This function does nothing, the offline device has only one driver.
+         @param The names of the driver.
+         */
+        void setDriver(string const& driver) override;
+        
+        //! Set the input device.
+        /** This function does nothing, the offline device has only one input device.
+         @param The names of the device.
+         */
+        void setInputDevice(string const& device) override;
+        
+        //! Set the output device.
+        /** This function does nothing, the offline device has only one output device.
+         @param The names of the device.
+         */
+        void setOutputDevice(string const& device) override;
+        
+        //! Set the sample rate.
+        /** This function sets the sample rate.
+         @param samplerate The sample rate.
+         */
+        void setSampleRate(ulong const samplerate) override;
+        
+        //! Set the vector size.
+        /** This function sets the svector size.
+         @param vectorsize The vector size.
+         */
+        void setVectorSize(ulong const vectorsize) override;
+        
+        //! Set the number of inputs.
+        /** This function sets the number of inputs.
+         @param nins The number of inputs.
+         */
+        void setNumberOfInputs(ulong const nins);
+        
+        //! Set the number of outputs.
+        /** This function sets the number of outputs.
+         @param nouts The number of outputs.
+         */
+        void setNumberOfOutputs(ulong const nouts);
+        
+        //! Set the input.
+        /** This function sets the input that feeds the input matrix, nullptr means silence.
+         @param input The input.
+         */
+        void setInput(sInput input);
+        
+        //! Set the output.
+        /** This function sets the output that receives the output matrix, nullptr means the output is discarded.
+         @param output The output.
+         */
+        void setOutput(sOutput output);
+        
+        //! Retrieve the inputs sample matrix.
+        /** This function retrieves the inputs sample matrix.
+         @param channel the index of the channel.
+         @return The inputs sample matrix.
+         */
+        sample const* getInputsSamples(const ulong channel) const noexcept override;
+        
+        //! Retrieve the outputs sample matrix.
+        /** This function retrieves the outputs sample matrix.
+         @param channel the index of the channel.
+         @return The outputs sample matrix.
+         */
+        sample* getOutputsSamples(const ulong channel) const noexcept override;
+        
+        //! Retrieve the number of samples rendered.
+        /** This function retrieves the number of samples per channel rendered since the device started.
+         @return The number of samples rendered.
+         */
+        ulong getPosition() const noexcept;
+        
+        //! Render vectors.
+        /** This function ticks the dsp as fast as possible for a number of vectors. The device must be started.
+         @param nvectors The number of vectors.
+         */
+        void renderVectors(const ulong nvectors);
+        
+        //! Render a duration.
+        /** This function ticks the dsp as fast as possible for a duration. The duration is rounded up to a whole number of vectors.
+         @param seconds The duration in seconds.
+         */
+        void render(const double seconds);
+        
+        //! Start the device.
+        /** This function starts the device.
+         */
+        void start() override;
+        
+        //! Stop the device.
+        /** This function stops the device.
+         */
+        void stop() override;
+    };
+}
+
+#endif
+
+
@@ -0,0 +1,248 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+*/
+
+
+#include "KiwiDspOversampler.h"
+
+namespace Kiwi
+{
+    //! The modified Bessel function of the first kind of order zero.
+    static double bessel(const double x) noexcept
+    {
+        double sum = 1., term = 1.;
+        for(ulong k = 1; term > sum * 1e-12; k++)
+        {
+            const double factor = x / (2. * double(k));
+            term *= factor * factor;
+            sum  += term;
+        }
+        return sum;
+    }
+    
+    //! Design the taps of the branch of a half-band filter that isn't the center tap.
+    /** The half-band filter has 4 * order - 1 taps designed with a Kaiser window, the branch gets the 2 * order taps of even indices with a gain of 2 so it interpolates without loss.
+     */
+    static vector<sample> design(const ulong order, const double beta)
+    {
+        const double center = double(2 * order - 1);
+        const double pi     = 3.14159265358979323846;
+        vector<double> taps(2 * order);
+        double sum = 0.;
+        for(ulong i = 0; i < 2 * order; i++)
+        {
+            const double offset = double(2 * i) - center;
+            const double ratio  = offset / center;
+            const double window = bessel(beta * sqrt(1. - ratio * ratio)) / bessel(beta);
+            taps[i] = sin(pi * offset * 0.5) / (pi * offset * 0.5) * window;
+            sum += taps[i];
+        }
+        vector<sample> result(2 * order);
+        for(ulong i = 0; i < 2 * order; i++)
+        {
+            result[i] = sample(taps[i] / sum);
+        }
+        return result;
+    }
+    
+    DspOversampler::DspOversampler(const ulong nins, const ulong nouts, const ulong vectorsize, const ulong ratio) :
+    m_nins(nins),
+    m_nouts(nouts),
+    m_vectorsize(vectorsize),
+    m_ratio(isRatioValid(ratio) ? ratio : 1)
+    {
+        // The first stage protects the band of the device, the next ones
+        // only reject the images of a band that is at most a quarter of
+        // their rate.
+        for(ulong i = 1; i < m_ratio; i *= 2)
+        {
+            m_stages.push_back(m_stages.empty() ? Stage{first_order, design(first_order, 8.)} : Stage{next_order, design(next_order, 8.)});
+        }
+        
+        const ulong nstages = m_stages.size();
+        const ulong half    = m_vectorsize * m_ratio / 2;
+        m_up.resize(m_nins * nstages);
+        m_down_even.resize(m_nouts * nstages);
+        m_down_odd.resize(m_nouts * nstages);
+        for(ulong i = 0; i < nstages; i++)
+        {
+            const ulong order = m_stages[i].order;
+            for(ulong j = 0; j < m_nins; j++)
+            {
+                m_up[j * nstages + i].assign(2 * order - 1, 0.);
+            }
+            for(ulong j = 0; j < m_nouts; j++)
+            {
+                m_down_even[j * nstages + i].assign(2 * order - 1, 0.);
+                m_down_odd[j * nstages + i].assign(order, 0.);
+            }
+        }
+        const ulong order = m_stages.empty() ? 0ul : m_stages[0].order;
+        m_work_even.assign(2 * order + half, 0.);
+        m_work_odd.assign(order + half, 0.);
+        m_accumulator.assign(half, 0.);
+        m_ping.assign(half, 0.);
+        m_pong.assign(half, 0.);
+    }
+    
+    DspOversampler::~DspOversampler()
+    {
+        ;
+    }
+    
+    bool DspOversampler::isRatioValid(const ulong ratio) noexcept
+    {
+        return ratio == 1 || ratio == 2 || ratio == 4 || ratio == 8;
+    }
+    
+    ulong DspOversampler::getLatency(const ulong ratio) noexcept
+    {
+        // Each stage delays by 2 * order - 1 samples at its low rate, half
+        // in the upsampling and half in the downsampling.
+        double latency = 0.;
+        double rate    = 1.;
+        for(ulong i = 1; i < ratio && isRatioValid(ratio); i *= 2)
+        {
+            latency += double((i == 1 ? 2 * first_order : 2 * next_order) - 1) / rate;
+            rate    *= 2.;
+        }
+        return ulong(latency + 0.5);
+    }
+    
+    void DspOversampler::clear() noexcept
+    {
+        for(auto& history : m_up)
+        {
+            fill(history.begin(), history.end(), sample(0));
+        }
+        for(auto& history : m_down_even)
+        {
+            fill(history.begin(), history.end(), sample(0));
+        }
+        for(auto& history : m_down_odd)
+        {
+            fill(history.begin(), history.end(), sample(0));
+        }
+    }
+    
+    void DspOversampler::upsample(Stage const& stage, vector<sample>& history, const ulong nframes, sample const* input, sample* output) noexcept
+    {
+        const ulong order   = stage.order;
+        const ulong size    = 2 * order - 1;
+        sample* work        = m_work_even.data();
+        sample* accumulator = m_accumulator.data();
+        copy(history.begin(), history.end(), work);
+        copy(input, input + nframes, work + size);
+        
+        // The even outputs are the filtered branch, the odd outputs are the
+        // center tap, a delay of order - 1 samples.
+        fill(accumulator, accumulator + nframes, sample(0));
+        for(ulong i = 0; i < 2 * order; i++)
+        {
+            const sample tap    = stage.taps[i];
+            sample const* in    = work + size - i;
+            for(ulong j = 0; j < nframes; j++)
+            {
+                accumulator[j] += tap * in[j];
+            }
+        }
+        sample const* delayed = work + order;
+        for(ulong j = 0; j < nframes; j++)
+        {
+            output[2 * j]       = accumulator[j];
+            output[2 * j + 1]   = delayed[j];
+        }
+        copy(work + nframes, work + nframes + size, history.begin());
+    }
+    
+    void DspOversampler::downsample(Stage const& stage, vector<sample>& even, vector<sample>& odd, const ulong nframes, sample const* input, sample* output) noexcept
+    {
+        const ulong order   = stage.order;
+        const ulong size    = 2 * order - 1;
+        sample* work_even   = m_work_even.data();
+        sample* work_odd    = m_work_odd.data();
+        copy(even.begin(), even.end(), work_even);
+        copy(odd.begin(), odd.end(), work_odd);
+        for(ulong j = 0; j < nframes; j++)
+        {
+            work_even[size + j] = input[2 * j];
+            work_odd[order + j] = input[2 * j + 1];
+        }
+        
+        // The odd inputs only meet the center tap, the even inputs meet the
+        // filtered branch, both with the gain of the decimation.
+        for(ulong j = 0; j < nframes; j++)
+        {
+            output[j] = sample(0.5) * work_odd[j];
+        }
+        for(ulong i = 0; i < 2 * order; i++)
+        {
+            const sample tap    = sample(0.5) * stage.taps[i];
+            sample const* in    = work_even + size - i;
+            for(ulong j = 0; j < nframes; j++)
+            {
+                output[j] += tap * in[j];
+            }
+        }
+        copy(work_even + nframes, work_even + nframes + size, even.begin());
+        copy(work_odd + nframes, work_odd + nframes + order, odd.begin());
+    }
+    
+    void DspOversampler::upsample(const ulong channel, sample const* input, sample* output) noexcept
+    {
+        const ulong nstages = m_stages.size();
+        if(!nstages)
+        {
+            copy(input, input + m_vectorsize, output);
+            return;
+        }
+        ulong nframes = m_vectorsize;
+        sample const* in = input;
+        for(ulong i = 0; i < nstages; i++)
+        {
+            sample* out = i == nstages - 1 ? output : ((i & 1) ? m_pong.data() : m_ping.data());
+            upsample(m_stages[i], m_up[channel * nstages + i], nframes, in, out);
+            in = out;
+            nframes *= 2;
+        }
+    }
+    
+    void DspOversampler::downsample(const ulong channel, sample const* input, sample* output) noexcept
+    {
+        const ulong nstages = m_stages.size();
+        if(!nstages)
+        {
+            copy(input, input + m_vectorsize, output);
+            return;
+        }
+        ulong nframes = m_vectorsize * m_ratio;
+        sample const* in = input;
+        for(ulong i = nstages; i-- > 0;)
+        {
+            nframes /= 2;
+            sample* out = !i ? output : ((i & 1) ? m_pong.data() : m_ping.data());
+            downsample(m_stages[i], m_down_even[channel * nstages + i], m_down_odd[channel * nstages + i], nframes, in, out);
+            in = out;
+        }
+    }
+}
+
@@ -0,0 +1,144 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+ */
+
+
+#ifndef __DEF_KIWI_DSP_OVERSAMPLER__
+#define __DEF_KIWI_DSP_OVERSAMPLER__
+
+#include "../KiwiDsp/KiwiDsp.h"
+
+namespace Kiwi
+{
+    // ================================================================================ //
+    //                                  DSP OVERSAMPLER                                 //
+    // ================================================================================ //
+    
+    //! The oversampler of the sample matrices of a device.
+    /** The oversampler converts the vectors of the device to vectors of 2, 4 or 8 times their size for the dsp and back. Each factor of 2 is a stage made of a half-band filter split in its two polyphase branches: the branch of the center tap is a pure delay and the other one is a symmetric filter evaluated at the low rate, so a stage costs half the taps of a direct filter. The first stage, next to the device rate, has a steep transition band, the next ones only have to reject the images above the original band and are much shorter. The filters are applied tap by tap over the whole vector so the compiler vectorizes the inner loops. The state of the filters is kept per channel, the oversampler is only used by the audio thread once it is built.
+     */
+    class DspOversampler
+    {
+    public:
+        static const ulong max_ratio    = 8;
+        static const ulong first_order  = 16;
+        static const ulong next_order   = 6;
+    
+    private:
+        struct Stage
+        {
+            ulong           order;
+            vector<sample>  taps;
+        };
+        
+        const ulong             m_nins;
+        const ulong             m_nouts;
+        const ulong             m_vectorsize;
+        const ulong             m_ratio;
+        vector<Stage>           m_stages;
+        vector<vector<sample>>  m_up;
+        vector<vector<sample>>  m_down_even;
+        vector<vector<sample>>  m_down_odd;
+        vector<sample>          m_work_even;
+        vector<sample>          m_work_odd;
+        vector<sample>          m_accumulator;
+        vector<sample>          m_ping;
+        vector<sample>          m_pong;
+        
+        void upsample(Stage const& stage, vector<sample>& history, const ulong nframes, sample const* input, sample* output) noexcept;
+        
+        void downsample(Stage const& stage, vector<sample>& even, vector<sample>& odd, const ulong nframes, sample const* input, sample* output) noexcept;
+    
+    public:
+    
+        //! Constructor
+        /** The constructor designs the filters and allocates the states of the channels.
+         @param nins The number of input channels.
+         @param nouts The number of output channels.
+         @param vectorsize The vector size of the device.
+         @param ratio The oversampling ratio, 1, 2, 4 or 8.
+         */
+        DspOversampler(const ulong nins, const ulong nouts, const ulong vectorsize, const ulong ratio);
+        
+        //! Destructor
+        /**
+         */
+        ~DspOversampler();
+        
+        //! Retrieve if a ratio is valid.
+        /** This function retrieves if a ratio is a power of two that the oversampler supports.
+         @param ratio The ratio.
+         @return True if the ratio is 1, 2, 4 or 8, otherwise false.
+         */
+        static bool isRatioValid(const ulong ratio) noexcept;
+        
+        //! Retrieve the ratio.
+        /** This function retrieves the oversampling ratio.
+         @return The ratio.
+         */
+        inline ulong getRatio() const noexcept
+        {
+            return m_ratio;
+        }
+        
+        //! Retrieve the latency of a ratio.
+        /** This function retrieves the delay that the upsampling and the downsampling add to a signal that goes through the dsp for a ratio.
+         @param ratio The ratio.
+         @return The latency in samples at the rate of the device.
+         */
+        static ulong getLatency(const ulong ratio) noexcept;
+        
+        //! Retrieve the latency.
+        /** This function retrieves the delay that the upsampling and the downsampling add to a signal that goes through the dsp.
+         @return The latency in samples at the rate of the device.
+         */
+        inline ulong getLatency() const noexcept
+        {
+            return getLatency(m_ratio);
+        }
+        
+        //! Clear the states.
+        /** This function clears the states of the filters of all the channels.
+         */
+        void clear() noexcept;
+        
+        //! Upsample an input vector.
+        /** This function converts a vector of an input channel at the rate of the device to a vector of the dsp.
+         @param channel The index of the input channel.
+         @param input The vector of the device.
+         @param output The vector of the dsp, ratio times larger.
+         */
+        void upsample(const ulong channel, sample const* input, sample* output) noexcept;
+        
+        //! Downsample an output vector.
+        /** This function converts a vector of an output channel of the dsp to a vector at the rate of the device.
+         @param channel The index of the output channel.
+         @param input The vector of the dsp, ratio times larger.
+         @param output The vector of the device.
+         */
+        void downsample(const ulong channel, sample const* input, sample* output) noexcept;
+    };
+}
+
+#endif
+
+
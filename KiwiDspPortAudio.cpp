@@ -27,61 +27,190 @@
 
 namespace Kiwi
 {
-    ulong KiwiPortAudioDeviceManager::m_nmanagers = 0;
+    mutex KiwiPortAudioDeviceManager::Session::m_mutex;
+    atomic<ulong> KiwiPortAudioDeviceManager::Session::m_count(0);
+    
+    KiwiPortAudioDeviceManager::Session::Session() : m_valid(false)
+    {
+        lock_guard<mutex> guard(m_mutex);
+        if(!m_count.load(memory_order_relaxed))
+        {
+            PaError err = Pa_Initialize();
+            if(err != paNoError)
+            {
+                cout << "PortAudio error: %s\n" << Pa_GetErrorText(err) << endl;
+                return;
+            }
+        }
+        m_count.fetch_add(1, memory_order_release);
+        m_valid = true;
+    }
+    
+    KiwiPortAudioDeviceManager::Session::~Session()
+    {
+        if(m_valid)
+        {
+            lock_guard<mutex> guard(m_mutex);
+            if(m_count.fetch_sub(1, memory_order_acq_rel) == 1)
+            {
+                PaError err = Pa_Terminate();
+                if(err != paNoError)
+                {
+                    cout << "PortAudio error: %s\n" << Pa_GetErrorText(err) << endl;
+                }
+            }
+        }
+    }
+    
+    // The number of channels to open for a mask, up to the last active one.
+    static inline int getChannelCount(vector<bool> const& mask, const int nchannels) noexcept
+    {
+        int count = 0;
+        for(ulong i = 0; i < mask.size() && int(i) < nchannels; i++)
+        {
+            if(mask[i])
+            {
+                count = int(i) + 1;
+            }
+        }
+        return count;
+    }
     
     KiwiPortAudioDeviceManager::DeviceNode::DeviceNode(KiwiPortAudioDeviceManager* _device) :
-    device(_device),
     nins(_device->m_paraminput.channelCount),
-    inputs(_device->m_sample_ins),
+    inputs(_device->m_oversampler ? _device->m_stage_ins : _device->m_sample_ins),
     nouts(_device->m_paramoutput.channelCount),
-    outputs(_device->m_sample_outs),
+    outputs(_device->m_oversampler ? _device->m_stage_outs : _device->m_sample_outs),
     samplerate(_device->m_samplerate),
-    vectorsize(_device->m_vectorsize)
+    vectorsize(_device->m_vectorsize),
+    ratio(_device->m_oversampler ? _device->m_oversampler->getRatio() : 1ul),
+    contexts(_device->m_contexts),
+    critical(_device->m_critical),
+    pool(_device->m_pool.get()),
+    fifo_ins(_device->isAdapting() || _device->m_resampler_ins ? &_device->m_fifo_ins : nullptr),
+    fifo_outs(_device->isAdapting() || _device->m_resampler_ins ? &_device->m_fifo_outs : nullptr),
+    matrix_ins(_device->m_sample_ins),
+    matrix_outs(_device->m_sample_outs),
+    oversampler(_device->m_oversampler),
+    resampler_ins(_device->m_resampler_ins.get()),
+    resampler_outs(_device->m_resampler_outs.get()),
+    resampled_ins(_device->m_resampled_ins.data()),
+    resampled_outs(_device->m_resampled_outs.data()),
+    chunk(_device->m_resampler_ins ? max((vectorsize * samplerate) / _device->m_engine_samplerate, 1ul) : 0ul),
+    active_ins(getActiveChannels(_device->m_active_ins, nins)),
+    active_outs(getActiveChannels(_device->m_active_outs, nouts)),
+    masked(active_ins.size() < nins || active_outs.size() < nouts),
+    deinterleave(Kernels::getDeinterleaver(nins)),
+    interleave(Kernels::getInterleaver(nouts))
     {
         ;
     }
     
-    KiwiPortAudioDeviceManager::KiwiPortAudioDeviceManager() :
-    m_stream(nullptr),
-    m_sample_ins(nullptr),
-    m_sample_outs(nullptr)
+    void KiwiPortAudioDeviceManager::Route::clear(void* outputs, const ulong nframes) const noexcept
     {
-        lock_guard<mutex> guard(m_mutex);
-        if(!m_nmanagers)
+        if(outputs && planar)
         {
-            PaError err = Pa_Initialize();
-            if(err != paNoError)
+            for(ulong i = 0; i < nouts; i++)
             {
-                cout << "PortAudio error: %s\n" << Pa_GetErrorText(err) << endl;
+                memset(((void* const*)outputs)[i], 0, nframes * size);
             }
         }
-        m_nmanagers++;
-        m_driver = Pa_GetDefaultHostApi();
-        m_paraminput.device            = Pa_GetDefaultInputDevice();
-        m_paramoutput.device           = Pa_GetDefaultOutputDevice();
-        m_paraminput.sampleFormat      = paFloat32;
-        m_paramoutput.sampleFormat     = paFloat32;
-        m_paraminput.suggestedLatency  = 0;
-        m_paramoutput.suggestedLatency = 0;
-        m_paraminput.channelCount      = 2;
-        m_paramoutput.channelCount     = 2;
-        m_vectorsize                   = 64;
-        m_samplerate                   = 44100;
-        m_stream = nullptr;
+        else if(outputs)
+        {
+            memset(outputs, 0, nframes * nouts * size);
+        }
     }
     
-    KiwiPortAudioDeviceManager::~KiwiPortAudioDeviceManager()
+    void KiwiPortAudioDeviceManager::Route::fade(void* outputs, const ulong nframes, const bool in) const noexcept
     {
-        stop();
-        if(m_nmanagers == 1)
+        if(!outputs || !nframes)
         {
-            PaError err = Pa_Terminate();
-            if(err != paNoError)
+            return;
+        }
+        const float step = 1.f / float(nframes);
+        for(ulong i = 0; i < nframes; i++)
+        {
+            const float gain = in ? float(i + 1) * step : float(nframes - 1 - i) * step;
+            for(ulong j = 0; j < nouts; j++)
             {
-                cout << "PortAudio error: %s\n" << Pa_GetErrorText(err) << endl;
+                float& value = planar ? ((float* const*)outputs)[j][i] : ((float *)outputs)[i * nouts + j];
+                value *= gain;
             }
         }
-        m_nmanagers--;
+    }
+    
+    KiwiPortAudioDeviceManager::KiwiPortAudioDeviceManager() :
+    m_stream(nullptr),
+    m_sample_ins(nullptr),
+    m_sample_outs(nullptr),
+    m_stage_ins(nullptr),
+    m_stage_outs(nullptr),
+    m_oversampling(1),
+    m_engine_samplerate(0),
+    m_resampler_quality(DspResampler::High),
+    m_nthreads(1),
+    m_adapter(false),
+    m_changes(0),
+    m_pending(false),
+    m_blocking(false),
+    m_io_running(false),
+    m_format(Float32),
+    m_stream_format(Float32),
+    m_dither(false),
+    m_denormals(true),
+    m_convert_size(0),
+    m_noninterleaved(false),
+    m_planar(false),
+    m_host_ins(nullptr),
+    m_host_outs(nullptr),
+    m_generation(0),
+    m_scanned(0),
+    m_scan_driver(0),
+    m_scanning(true),
+    m_watchdog_buffersize(0),
+    m_nroutes(0),
+    m_active(0),
+    m_handover(0),
+    m_handover_node(nullptr),
+    m_republish(false),
+    m_fadein(false),
+    m_seamless(false),
+    m_node(nullptr),
+    m_epoch(1),
+    m_reader(0)
+    {
+        {
+            lock_guard<mutex> guard(m_mutex);
+            m_driver = Pa_GetDefaultHostApi();
+            m_paraminput.device            = Pa_GetDefaultInputDevice();
+            m_paramoutput.device           = Pa_GetDefaultOutputDevice();
+            m_paraminput.sampleFormat      = paFloat32;
+            m_paramoutput.sampleFormat     = paFloat32;
+            m_paraminput.suggestedLatency  = 0;
+            m_paramoutput.suggestedLatency = 0;
+            m_paraminput.channelCount      = 2;
+            m_paramoutput.channelCount     = 2;
+            m_vectorsize                   = 64;
+            m_samplerate                   = 44100;
+            m_stream = nullptr;
+            m_capabilities.devices         = false;
+            m_capabilities.samplerates     = false;
+        }
+        m_scanner = thread(&KiwiPortAudioDeviceManager::scanner, this);
+        invalidate(true);
+    }
+    
+    KiwiPortAudioDeviceManager::~KiwiPortAudioDeviceManager()
+    {
+        {
+            lock_guard<mutex> guard(m_capabilities_mutex);
+            m_scanning = false;
+        }
+        m_capabilities_condition.notify_all();
+        m_scanner.join();
+        stop();
+        publish(nullptr);
+        reclaim();
     }
     
     void KiwiPortAudioDeviceManager::getAvailableDrivers(vector<string>& drivers) const
@@ -106,46 +235,20 @@ namespace Kiwi
     void KiwiPortAudioDeviceManager::getAvailableInputDevices(vector<string>& devices) const
     {
         devices.clear();
-        const PaHostApiInfo *hostInfo = Pa_GetHostApiInfo(m_driver);
-        if(hostInfo)
+        unique_lock<mutex> lock(getCapabilities());
+        for(auto const& device : m_capabilities.inputs)
         {
-            const PaDeviceInfo *deviceInfo;
-            const int numDevices = hostInfo->deviceCount;
-            for(int i = 0; i < numDevices; i++)
-            {
-                const PaDeviceIndex index = Pa_HostApiDeviceIndexToDeviceIndex(m_driver, i);
-                deviceInfo = Pa_GetDeviceInfo(index);
-                if(deviceInfo)
-                {
-                    if(deviceInfo->maxInputChannels)
-                    {
-                        devices.push_back(deviceInfo->name);
-                    }
-                }
-            }
+            devices.push_back(device.name);
         }
     }
     
     void KiwiPortAudioDeviceManager::getAvailableOutputDevices(vector<string>& devices) const
     {
         devices.clear();
-        const PaHostApiInfo *hostInfo = Pa_GetHostApiInfo(m_driver);
-        if(hostInfo)
+        unique_lock<mutex> lock(getCapabilities());
+        for(auto const& device : m_capabilities.outputs)
         {
-            const PaDeviceInfo *deviceInfo;
-            const int numDevices = hostInfo->deviceCount;
-            for(int i = 0; i < numDevices; i++)
-            {
-                const PaDeviceIndex index = Pa_HostApiDeviceIndexToDeviceIndex(m_driver, i);
-                deviceInfo = Pa_GetDeviceInfo(index);
-                if(deviceInfo)
-                {
-                    if(deviceInfo->maxOutputChannels)
-                    {
-                        devices.push_back(deviceInfo->name);
-                    }
-                }
-            }
+            devices.push_back(device.name);
         }
     }
     
@@ -187,21 +290,8 @@ namespace Kiwi
     
     void KiwiPortAudioDeviceManager::getAvailableSampleRates(vector<ulong>& samplerates) const
     {
-        for(ulong i = 1; i < 6; i++)
-        {
-            if(Pa_IsFormatSupported(&m_paraminput, &m_paramoutput, (double)(11025 * i)) == paFormatIsSupported)
-            {
-                samplerates.push_back((double)(11025 * i));
-            }
-            if(Pa_IsFormatSupported(&m_paraminput, &m_paramoutput, (double)(12000 * i)) == paFormatIsSupported)
-            {
-                samplerates.push_back((double)(12000 * i));
-            }
-            if(Pa_IsFormatSupported(&m_paraminput, &m_paramoutput, (double)(16000 * i)) == paFormatIsSupported)
-            {
-                samplerates.push_back((double)(16000 * i));
-            }
-        }
+        unique_lock<mutex> lock(getCapabilities());
+        samplerates = m_capabilities.rates;
     }
     
     ulong KiwiPortAudioDeviceManager::getSampleRate() const
@@ -211,6 +301,7 @@ namespace Kiwi
     
     void KiwiPortAudioDeviceManager::getAvailableVectorSizes(vector<ulong>& vectorsizes) const
     {
+        vectorsizes.clear();
         for(ulong i = 1; i <= 8192; i *= 2)
         {
             vectorsizes.push_back(i);
@@ -233,7 +324,8 @@ namespace Kiwi
                 if(hostInfo && hostInfo->name == driver)
                 {
                     m_driver = i;
-                    start();
+                    invalidate(true);
+                    restart();
                 }
             }
         }
@@ -241,48 +333,46 @@ namespace Kiwi
     
     void KiwiPortAudioDeviceManager::setInputDevice(string const& device)
     {
-        const PaHostApiInfo *hostInfo = Pa_GetHostApiInfo(m_driver);
-        if(hostInfo)
+        PaDeviceIndex index = paNoDevice;
         {
-            const PaDeviceInfo *deviceInfo;
-            const int numDevices = hostInfo->deviceCount;
-            for(int i = 0; i < numDevices; i++)
+            unique_lock<mutex> lock(getCapabilities());
+            for(auto const& candidate : m_capabilities.inputs)
             {
-                const PaDeviceIndex index = Pa_HostApiDeviceIndexToDeviceIndex(m_driver, i);
-                if(index != m_paraminput.device)
+                if(candidate.name == device)
                 {
-                    deviceInfo = Pa_GetDeviceInfo(index);
-                    if(deviceInfo && deviceInfo->name == device)
-                    {
-                        m_paraminput.device = index;
-                        start();
-                    }
+                    index = candidate.index;
+                    break;
                 }
             }
         }
+        if(index != paNoDevice && index != m_paraminput.device)
+        {
+            m_paraminput.device = index;
+            invalidate(false);
+            reroute();
+        }
     }
     
     void KiwiPortAudioDeviceManager::setOutputDevice(string const& device)
     {
-        const PaHostApiInfo *hostInfo = Pa_GetHostApiInfo(m_driver);
-        if(hostInfo)
+        PaDeviceIndex index = paNoDevice;
         {
-            const PaDeviceInfo *deviceInfo;
-            const int numDevices = hostInfo->deviceCount;
-            for(int i = 0; i < numDevices; i++)
+            unique_lock<mutex> lock(getCapabilities());
+            for(auto const& candidate : m_capabilities.outputs)
             {
-                const PaDeviceIndex index = Pa_HostApiDeviceIndexToDeviceIndex(m_driver, i);
-                if(index != m_paramoutput.device)
+                if(candidate.name == device)
                 {
-                    deviceInfo = Pa_GetDeviceInfo(index);
-                    if(deviceInfo && deviceInfo->name == device)
-                    {
-                        m_paramoutput.device = index;
-                        start();
-                    }
+                    index = candidate.index;
+                    break;
                 }
             }
         }
+        if(index != paNoDevice && index != m_paramoutput.device)
+        {
+            m_paramoutput.device = index;
+            invalidate(false);
+            reroute();
+        }
     }
     
     void KiwiPortAudioDeviceManager::setSampleRate(ulong const samplerate)
@@ -290,7 +380,7 @@ namespace Kiwi
         if(samplerate != getSampleRate() && isSampleRateAvailable(samplerate))
         {
             m_samplerate = (ulong)samplerate;
-            start();
+            restart();
         }
     }
     
@@ -298,150 +388,1259 @@ namespace Kiwi
     {
         if(vectorsize != getVectorSize() && isVectorSizeAvailable(vectorsize))
         {
+            m_watchdog_buffersize = 0;
             m_vectorsize = (ulong)vectorsize;
-            start();
+            restart();
         }
     }
     
-    sample const* KiwiPortAudioDeviceManager::getInputsSamples(const ulong channel) const noexcept
+    void KiwiPortAudioDeviceManager::invalidate(const bool devices)
     {
-        if(m_sample_ins && channel < getNumberOfInputs())
         {
-            return m_sample_ins + channel * getVectorSize();
-        }
-        else
-        {
-            return nullptr;
+            lock_guard<mutex> guard(m_capabilities_mutex);
+            if(devices)
+            {
+                m_capabilities.devices = false;
+            }
+            m_capabilities.samplerates = false;
+            m_scan_driver = m_driver;
+            m_scan_input  = m_paraminput;
+            m_scan_output = m_paramoutput;
+            ++m_generation;
         }
+        m_capabilities_condition.notify_all();
     }
     
-    sample* KiwiPortAudioDeviceManager::getOutputsSamples(const ulong channel) const noexcept
+    void KiwiPortAudioDeviceManager::scanner()
     {
-        if(m_sample_outs && channel < getNumberOfOutputs())
-        {
-            return m_sample_outs + channel * getVectorSize();
-        }
-        else
+        unique_lock<mutex> lock(m_capabilities_mutex);
+        while(m_scanning)
         {
-            return nullptr;
+            if(m_scanned == m_generation)
+            {
+                m_capabilities_condition.wait(lock);
+                continue;
+            }
+            
+            // The probes run on a copy of the request so neither the
+            // capabilities nor the manager are locked meanwhile.
+            const ulong generation          = m_generation;
+            const bool devices              = !m_capabilities.devices;
+            const PaHostApiIndex driver     = m_scan_driver;
+            const PaStreamParameters input  = m_scan_input;
+            const PaStreamParameters output = m_scan_output;
+            lock.unlock();
+            Capabilities capabilities;
+            scan(capabilities, devices, driver, input, output);
+            lock.lock();
+            
+            if(generation == m_generation)
+            {
+                if(devices)
+                {
+                    m_capabilities.inputs.swap(capabilities.inputs);
+                    m_capabilities.outputs.swap(capabilities.outputs);
+                    m_capabilities.devices = true;
+                }
+                m_capabilities.rates.swap(capabilities.rates);
+                m_capabilities.samplerates = true;
+                m_scanned = generation;
+                m_capabilities_condition.notify_all();
+            }
         }
     }
     
-    void KiwiPortAudioDeviceManager::stop()
+    void KiwiPortAudioDeviceManager::scan(Capabilities& capabilities, const bool devices, const PaHostApiIndex driver, PaStreamParameters const& input, PaStreamParameters const& output)
     {
-        lock_guard<mutex> guard(m_mutex);
-        if(m_stream)
+        if(devices)
         {
-            if(Pa_IsStreamActive(m_stream))
+            const PaHostApiInfo *hostInfo = Pa_GetHostApiInfo(driver);
+            if(hostInfo)
             {
-                PaError err = Pa_StopStream(m_stream);
-                if(err != paNoError)
+                const int numDevices = hostInfo->deviceCount;
+                for(int i = 0; i < numDevices; i++)
                 {
-                    cout << "PortAudio error: %s\n" << Pa_GetErrorText(err) << endl;
-                    err = Pa_AbortStream(m_stream);
-                    if(err != paNoError)
+                    const PaDeviceIndex index = Pa_HostApiDeviceIndexToDeviceIndex(driver, i);
+                    const PaDeviceInfo *deviceInfo = Pa_GetDeviceInfo(index);
+                    if(deviceInfo)
                     {
-                        cout << "PortAudio error: %s\n" << Pa_GetErrorText(err) << endl;
+                        if(deviceInfo->maxInputChannels)
+                        {
+                            capabilities.inputs.push_back({deviceInfo->name, index});
+                        }
+                        if(deviceInfo->maxOutputChannels)
+                        {
+                            capabilities.outputs.push_back({deviceInfo->name, index});
+                        }
                     }
                 }
-                while(!Pa_IsStreamStopped(m_stream))
+            }
+        }
+        for(ulong i = 1; i < 6; i++)
+        {
+            const ulong bases[] = {11025, 12000, 16000};
+            for(ulong base : bases)
+            {
+                if(Pa_IsFormatSupported(&input, &output, (double)(base * i)) == paFormatIsSupported)
                 {
-                    ;
+                    capabilities.rates.push_back(base * i);
                 }
-                m_stream = nullptr;
             }
         }
-        if(m_sample_ins)
+    }
+    
+    unique_lock<mutex> KiwiPortAudioDeviceManager::getCapabilities() const
+    {
+        unique_lock<mutex> lock(m_capabilities_mutex);
+        while(m_scanned != m_generation)
+        {
+            m_capabilities_condition.wait(lock);
+        }
+        return lock;
+    }
+    
+    void KiwiPortAudioDeviceManager::refreshCapabilities()
+    {
+        invalidate(true);
+    }
+    
+    void KiwiPortAudioDeviceManager::restart()
+    {
+        if(m_changes)
         {
-            delete [] m_sample_ins;
-            m_sample_ins = nullptr;
+            m_pending = true;
         }
-        if(m_sample_outs)
+        else
         {
-            delete [] m_sample_outs;
-            m_sample_ins = nullptr;
+            start();
         }
     }
     
-    void KiwiPortAudioDeviceManager::start()
+    void KiwiPortAudioDeviceManager::reroute()
     {
-        if(m_stream)
+        if(m_changes)
         {
-            stop();
+            m_pending = true;
         }
-
-        lock_guard<mutex> guard(m_mutex);
-        m_sample_ins    = new sample[m_paraminput.channelCount * m_vectorsize];
-        m_sample_outs   = new sample[m_paramoutput.channelCount * m_vectorsize];
-        
-        DeviceNode* node = new DeviceNode(this);
-        PaError err = Pa_OpenStream(&m_stream, &m_paraminput, &m_paramoutput, m_samplerate, m_vectorsize, paClipOff, &callback, node);
-        if(err != paNoError)
+        else if(!handover())
         {
-            cout << "PortAudio error: %s\n" << Pa_GetErrorText(err) << endl;
-            return;
+            start();
+        }
+    }
+    
+    bool KiwiPortAudioDeviceManager::handover()
+    {
+        if(!m_seamless || !m_stream || m_blocking || m_adapter || m_watchdog_buffersize || isResampling() || m_stream_format != Float32 || Pa_IsStreamActive(m_stream) != 1)
+        {
+            return false;
         }
         
-        err = Pa_SetStreamFinishedCallback(m_stream, &finish);
-        if(err != paNoError)
+        unique_ptr<Route> route;
+        PaStream* stream = nullptr;
+        DeviceNode* previous = nullptr;
         {
-            cout << "PortAudio error: %s\n" << Pa_GetErrorText(err) << endl;
-            return;
+            lock_guard<mutex> guard(m_mutex);
+            // The new node uses the other arena so the current stream keeps
+            // its matrices until the end.
+            split(m_switch_arena);
+            
+            route.reset(new Route{this, ++m_nroutes, ulong(m_paramoutput.channelCount), sizeof(float), m_planar});
+            DeviceNode* node = new DeviceNode(this);
+            PaError err = Pa_OpenStream(&stream, m_paraminput.channelCount ? &m_paraminput : nullptr, m_paramoutput.channelCount ? &m_paramoutput : nullptr, m_samplerate, m_vectorsize, paClipOff, &callback, route.get());
+            if(err == paNoError)
+            {
+                err = Pa_StartStream(stream);
+            }
+            if(err != paNoError)
+            {
+                cout << "PortAudio error: %s\n" << Pa_GetErrorText(err) << endl;
+                if(stream)
+                {
+                    Pa_CloseStream(stream);
+                }
+                delete node;
+                split(m_arena);
+                return false;
+            }
+            
+            // The current stream hands the dsp over at the end of its next
+            // block, the nodes published meanwhile are deferred.
+            previous = m_node.load();
+            m_handover_node.store(node);
+            m_handover.store(route->generation, memory_order_release);
         }
         
+        const chrono::steady_clock::time_point deadline = chrono::steady_clock::now() + chrono::seconds(1);
+        while(m_active.load(memory_order_acquire) != route->generation && chrono::steady_clock::now() < deadline)
+        {
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
         
-        err = Pa_StartStream(m_stream);
+        lock_guard<mutex> guard(m_mutex);
+        PaError err = Pa_StopStream(m_stream);
         if(err != paNoError)
         {
             cout << "PortAudio error: %s\n" << Pa_GetErrorText(err) << endl;
-            return;
+            Pa_AbortStream(m_stream);
+        }
+        Pa_CloseStream(m_stream);
+        if(m_active.load() != route->generation)
+        {
+            // The previous device stalled, the dsp is handed over without
+            // fade.
+            m_node.store(m_handover_node.load());
+            m_active.store(route->generation, memory_order_release);
+        }
+        m_handover.store(0);
+        m_handover_node.store(nullptr);
+        m_retired.push_back(make_pair(++m_epoch, previous));
+        
+        m_arena.swap(m_switch_arena);
+        m_stream = stream;
+        m_route  = move(route);
+        if(m_republish)
+        {
+            m_republish = false;
+            publish(new DeviceNode(this));
+        }
+        reclaim();
+        return true;
+    }
+    
+    void KiwiPortAudioDeviceManager::beginChanges() noexcept
+    {
+        m_changes++;
+    }
+    
+    void KiwiPortAudioDeviceManager::commitChanges()
+    {
+        if(m_changes && !--m_changes && m_pending)
+        {
+            m_pending = false;
+            start();
         }
     }
-
     
-    int KiwiPortAudioDeviceManager::callback(const void *inputBuffer, void *outputBuffer, ulong framesPerBuffer, const PaStreamCallbackTimeInfo* timeInfo, PaStreamCallbackFlags statusFlags, void *userData)
+    bool KiwiPortAudioDeviceManager::applySetup(DspDeviceSetup const& setup)
     {
-        DeviceNode* d = (DeviceNode*)userData;
-        lock_guard<mutex> guard(d->device->m_mutex);
-#ifdef __KIWI_DSP_DOUBLE__
-        const ulong nins    = d->nins;
-        const ulong nouts   = d->nouts;
-        const ulong vecsize = d->vectorsize;
-        float*  vec1     = (float*)inputBuffer;
-        sample* vec2     = d->inputs;
+        beginChanges();
+        if(!setup.driver.empty())
+        {
+            setDriver(setup.driver);
+        }
+        if(!setup.input.empty())
+        {
+            setInputDevice(setup.input);
+        }
+        if(!setup.output.empty())
+        {
+            setOutputDevice(setup.output);
+        }
+        if(setup.samplerate)
+        {
+            setSampleRate(setup.samplerate);
+        }
+        if(setup.vectorsize)
+        {
+            setVectorSize(setup.vectorsize);
+        }
+        commitChanges();
         
-        for(ulong i = 0; i < nins; i++)
+        return (setup.driver.empty() || setup.driver == getDriverName()) &&
+        (setup.input.empty() || setup.input == getInputDeviceName()) &&
+        (setup.output.empty() || setup.output == getOutputDeviceName()) &&
+        (!setup.samplerate || setup.samplerate == getSampleRate()) &&
+        (!setup.vectorsize || setup.vectorsize == getVectorSize());
+    }
+    
+    sample const* KiwiPortAudioDeviceManager::getInputsSamples(const ulong channel) const noexcept
+    {
+        // The matrices and the active channels come from the node so they
+        // stay on the stream that ticks the dsp while a handover prepares the
+        // other one or while a new mask waits for the restart.
+        sample const* const* host = m_host_ins.load(memory_order_relaxed);
+        DeviceNode const* node = m_node.load();
+        if(!node || channel >= node->nins || !binary_search(node->active_ins.begin(), node->active_ins.end(), channel))
+        {
+            return nullptr;
+        }
+        else if(host)
+        {
+            return host[channel];
+        }
+        else
+        {
+            return node->matrix_ins + channel * node->vectorsize * node->ratio;
+        }
+    }
+    
+    sample* KiwiPortAudioDeviceManager::getOutputsSamples(const ulong channel) const noexcept
+    {
+        sample* const* host = m_host_outs.load(memory_order_relaxed);
+        DeviceNode const* node = m_node.load();
+        if(!node || channel >= node->nouts || !binary_search(node->active_outs.begin(), node->active_outs.end(), channel))
+        {
+            return nullptr;
+        }
+        else if(host)
+        {
+            return host[channel];
+        }
+        else
+        {
+            return node->matrix_outs + channel * node->vectorsize * node->ratio;
+        }
+    }
+    
+    void KiwiPortAudioDeviceManager::addContext(sDspContext context, const bool critical)
+    {
+        lock_guard<mutex> guard(m_mutex);
+        if(context && find(m_contexts.begin(), m_contexts.end(), context) == m_contexts.end())
         {
-            for(ulong j = 0; j < vecsize; j++)
+            m_contexts.push_back(context);
+            if(critical)
             {
-                *(vec2++) = *(vec1+nins+j*nins);
+                m_critical.push_back(context);
             }
+            republish();
         }
-        Signal::vclear(d->vectorsize * d->nouts, d->outputs);
-        d->device->tick();
-        
-        vec2    = d->outputs;
-        vec1    = (float*)inputBuffer;
-        for(ulong i = 0; i < nouts; i++)
+    }
+    
+    void KiwiPortAudioDeviceManager::removeContext(sDspContext context)
+    {
+        lock_guard<mutex> guard(m_mutex);
+        auto it = find(m_contexts.begin(), m_contexts.end(), context);
+        if(it != m_contexts.end())
         {
-            for(ulong j = 0; j < vecsize; j++)
+            m_contexts.erase(it);
+            auto critical = find(m_critical.begin(), m_critical.end(), context);
+            if(critical != m_critical.end())
             {
-                *(vec1++) = *(vec2+nouts+j*nouts);
+                m_critical.erase(critical);
             }
+            republish();
         }
-#else
-        Signal::vdeterleave(d->vectorsize, d->nins, (float *)inputBuffer, d->inputs);
-        Signal::vclear(d->vectorsize * d->nouts, d->outputs);
-        d->device->tick();
-        Signal::vinterleave(d->vectorsize, d->nouts, (float *)d->outputs, (float *)outputBuffer);
-#endif
-        return paContinue;
     }
     
-    void KiwiPortAudioDeviceManager::finish(void *userData )
+    void KiwiPortAudioDeviceManager::setNumberOfThreads(ulong const nthreads)
+    {
+        const ulong ncores = max(ulong(thread::hardware_concurrency()), 1ul);
+        const ulong nvalid = nthreads ? min(nthreads, ncores) : ncores;
+        if(nvalid != m_nthreads)
+        {
+            m_nthreads = nvalid;
+            if(m_stream)
+            {
+                restart();
+            }
+        }
+    }
+    
+    ulong KiwiPortAudioDeviceManager::getNumberOfManagers() noexcept
+    {
+        return Session::getNumberOfSessions();
+    }
+    
+    ulong KiwiPortAudioDeviceManager::getNumberOfThreads() const noexcept
+    {
+        return m_nthreads;
+    }
+    
+    void KiwiPortAudioDeviceManager::setBufferAdapter(const bool state)
+    {
+        if(state != m_adapter)
+        {
+            m_adapter = state;
+            if(m_stream)
+            {
+                restart();
+            }
+        }
+    }
+    
+    bool KiwiPortAudioDeviceManager::hasBufferAdapter() const noexcept
+    {
+        return m_adapter;
+    }
+    
+    void KiwiPortAudioDeviceManager::setBlockingMode(const bool state)
     {
-        DeviceNode* d = (DeviceNode*)userData;
-        delete d;
+        if(state != m_blocking)
+        {
+            m_blocking = state;
+            if(m_stream)
+            {
+                restart();
+            }
+        }
+    }
+    
+    bool KiwiPortAudioDeviceManager::hasBlockingMode() const noexcept
+    {
+        return m_blocking;
+    }
+    
+    void KiwiPortAudioDeviceManager::setSampleFormat(const SampleFormat format)
+    {
+        if(format != m_format)
+        {
+            m_format = format;
+            if(m_stream)
+            {
+                restart();
+            }
+        }
+    }
+    
+    KiwiPortAudioDeviceManager::SampleFormat KiwiPortAudioDeviceManager::getSampleFormat() const noexcept
+    {
+        return m_format;
+    }
+    
+    void KiwiPortAudioDeviceManager::setNonInterleaved(const bool state)
+    {
+        if(state != m_noninterleaved)
+        {
+            m_noninterleaved = state;
+            if(m_stream)
+            {
+                restart();
+            }
+        }
+    }
+    
+    bool KiwiPortAudioDeviceManager::isNonInterleaved() const noexcept
+    {
+        return m_noninterleaved;
+    }
+    
+    void KiwiPortAudioDeviceManager::setDither(const bool state) noexcept
+    {
+        m_dither.store(state);
+    }
+    
+    bool KiwiPortAudioDeviceManager::hasDither() const noexcept
+    {
+        return m_dither.load();
+    }
+    
+    void KiwiPortAudioDeviceManager::setDenormalsProtection(const bool state)
+    {
+        lock_guard<mutex> guard(m_mutex);
+        m_denormals.store(state);
+        if(m_pool)
+        {
+            m_pool->setDenormalsProtection(state);
+        }
+    }
+    
+    bool KiwiPortAudioDeviceManager::hasDenormalsProtection() const noexcept
+    {
+        return m_denormals.load();
+    }
+    
+    void KiwiPortAudioDeviceManager::setSeamlessSwitch(const bool state) noexcept
+    {
+        m_seamless = state;
+    }
+    
+    bool KiwiPortAudioDeviceManager::hasSeamlessSwitch() const noexcept
+    {
+        return m_seamless;
+    }
+    
+    void KiwiPortAudioDeviceManager::setOversampling(const ulong ratio)
+    {
+        if(DspOversampler::isRatioValid(ratio) && ratio != m_oversampling.load())
+        {
+            lock_guard<mutex> guard(m_mutex);
+            m_oversampling.store(ratio);
+            if(m_node.load())
+            {
+                // The matrices already fit the largest ratio, only the filters
+                // are built again and the node that uses them is published.
+                m_oversampler.reset(ratio > 1 ? new DspOversampler(ulong(m_paraminput.channelCount), ulong(m_paramoutput.channelCount), m_vectorsize, ratio) : nullptr);
+                republish();
+            }
+        }
+    }
+    
+    ulong KiwiPortAudioDeviceManager::getOversampling() const noexcept
+    {
+        // The ratio of the node is the one the dsp runs with, a new ratio only
+        // applies once its node is published.
+        DeviceNode const* node = m_node.load();
+        return node ? node->ratio : m_oversampling.load();
+    }
+    
+    ulong KiwiPortAudioDeviceManager::getOversamplingLatency() const noexcept
+    {
+        return DspOversampler::getLatency(getOversampling());
+    }
+    
+    void KiwiPortAudioDeviceManager::setEngineSampleRate(const ulong samplerate)
+    {
+        if(samplerate != m_engine_samplerate)
+        {
+            m_engine_samplerate = samplerate;
+            if(m_stream)
+            {
+                restart();
+            }
+        }
+    }
+    
+    ulong KiwiPortAudioDeviceManager::getEngineSampleRate() const noexcept
+    {
+        return m_engine_samplerate ? m_engine_samplerate : m_samplerate;
+    }
+    
+    void KiwiPortAudioDeviceManager::setResamplerQuality(const DspResampler::Quality quality)
+    {
+        if(quality != m_resampler_quality)
+        {
+            m_resampler_quality = quality;
+            if(m_stream && isResampling())
+            {
+                restart();
+            }
+        }
+    }
+    
+    DspResampler::Quality KiwiPortAudioDeviceManager::getResamplerQuality() const noexcept
+    {
+        return m_resampler_quality;
+    }
+    
+    void KiwiPortAudioDeviceManager::setActiveInputs(vector<bool> const& mask)
+    {
+        if(mask != m_active_ins)
+        {
+            // The audio thread reads the active channels of its node, the mask
+            // only applies when the stream starts again.
+            m_active_ins = mask;
+            if(m_stream)
+            {
+                restart();
+            }
+        }
+    }
+    
+    void KiwiPortAudioDeviceManager::setActiveOutputs(vector<bool> const& mask)
+    {
+        if(mask != m_active_outs)
+        {
+            m_active_outs = mask;
+            if(m_stream)
+            {
+                restart();
+            }
+        }
+    }
+    
+    bool KiwiPortAudioDeviceManager::isInputActive(const ulong channel) const noexcept
+    {
+        return m_active_ins.empty() || (channel < m_active_ins.size() && m_active_ins[channel]);
+    }
+    
+    bool KiwiPortAudioDeviceManager::isOutputActive(const ulong channel) const noexcept
+    {
+        return m_active_outs.empty() || (channel < m_active_outs.size() && m_active_outs[channel]);
+    }
+    
+    void KiwiPortAudioDeviceManager::setWatchdogRules(const ulong rules)
+    {
+        m_watchdog.setRules(rules);
+        if(!(rules & DspWatchdog::RaiseVectorSize) && m_watchdog_buffersize)
+        {
+            m_watchdog_buffersize = 0;
+            if(m_stream)
+            {
+                restart();
+            }
+        }
+    }
+    
+    ulong KiwiPortAudioDeviceManager::getWatchdogRules() const noexcept
+    {
+        return m_watchdog.getRules();
+    }
+    
+    DspWatchdog::Level KiwiPortAudioDeviceManager::getWatchdogLevel() const noexcept
+    {
+        return m_watchdog.getLevel();
+    }
+    
+    void KiwiPortAudioDeviceManager::pollWatchdog()
+    {
+        const DspWatchdog::Request request = m_watchdog.poll();
+        if(request == DspWatchdog::None || !m_stream)
+        {
+            return;
+        }
+        
+        // Only the buffers of the stream change, the fifos keep ticking the
+        // dsp with the vector size it has been compiled for.
+        vector<ulong> vectorsizes;
+        getAvailableVectorSizes(vectorsizes);
+        const ulong current = getBufferSize();
+        ulong buffersize = current;
+        if(request == DspWatchdog::Raise)
+        {
+            auto it = upper_bound(vectorsizes.begin(), vectorsizes.end(), current);
+            if(it != vectorsizes.end())
+            {
+                buffersize = *it;
+            }
+        }
+        else if(m_watchdog_buffersize)
+        {
+            auto it = lower_bound(vectorsizes.begin(), vectorsizes.end(), current);
+            if(it != vectorsizes.begin())
+            {
+                buffersize = max(*(it - 1), m_vectorsize);
+            }
+        }
+        if(buffersize != current)
+        {
+            m_watchdog_buffersize = buffersize != m_vectorsize ? buffersize : 0;
+            restart();
+        }
+    }
+    
+    static inline PaSampleFormat getPortAudioFormat(const KiwiPortAudioDeviceManager::SampleFormat format) noexcept
+    {
+        switch(format)
+        {
+            case KiwiPortAudioDeviceManager::Int32: return paInt32;
+            case KiwiPortAudioDeviceManager::Int24: return paInt24;
+            case KiwiPortAudioDeviceManager::Int16: return paInt16;
+            default: return paFloat32;
+        }
+    }
+    
+    static inline ulong getSampleSize(const KiwiPortAudioDeviceManager::SampleFormat format) noexcept
+    {
+        switch(format)
+        {
+            case KiwiPortAudioDeviceManager::Int24: return 3;
+            case KiwiPortAudioDeviceManager::Int16: return 2;
+            default: return 4;
+        }
+    }
+    
+    void KiwiPortAudioDeviceManager::stop()
+    {
+        if(m_io.joinable())
+        {
+            m_io_running.store(false);
+            m_io.join();
+        }
+        lock_guard<mutex> guard(m_mutex);
+        if(m_stream)
+        {
+            if(Pa_IsStreamActive(m_stream))
+            {
+                PaError err = Pa_StopStream(m_stream);
+                if(err != paNoError)
+                {
+                    cout << "PortAudio error: %s\n" << Pa_GetErrorText(err) << endl;
+                    err = Pa_AbortStream(m_stream);
+                    if(err != paNoError)
+                    {
+                        cout << "PortAudio error: %s\n" << Pa_GetErrorText(err) << endl;
+                    }
+                }
+                while(!Pa_IsStreamStopped(m_stream))
+                {
+                    ;
+                }
+            }
+            PaError err = Pa_CloseStream(m_stream);
+            if(err != paNoError)
+            {
+                cout << "PortAudio error: %s\n" << Pa_GetErrorText(err) << endl;
+            }
+            m_stream = nullptr;
+        }
+        publish(nullptr);
+        reclaim();
+        m_pool.reset();
+        DspArena::unlock(m_arena.data(), m_arena.getCapacity() * sizeof(sample));
+        DspArena::unlock(m_io_ins.data(), m_io_ins.size());
+        DspArena::unlock(m_io_outs.data(), m_io_outs.size());
+        DspArena::unlock(m_convert_ins.data(), m_convert_ins.size() * sizeof(float));
+        DspArena::unlock(m_convert_outs.data(), m_convert_outs.size() * sizeof(float));
+        m_sample_ins    = nullptr;
+        m_sample_outs   = nullptr;
+        m_stage_ins     = nullptr;
+        m_stage_outs    = nullptr;
+    }
+    
+    void KiwiPortAudioDeviceManager::split(DspArena& arena)
+    {
+        const ulong nins        = ulong(m_paraminput.channelCount);
+        const ulong nouts       = ulong(m_paramoutput.channelCount);
+        const ulong insize      = DspArena::align(nins * m_vectorsize * DspOversampler::max_ratio);
+        const ulong outsize     = DspArena::align(nouts * m_vectorsize * DspOversampler::max_ratio);
+        const ulong stageinsize = DspArena::align(nins * m_vectorsize);
+        const ulong stageoutsize= DspArena::align(nouts * m_vectorsize);
+        m_sample_ins    = arena.reserve(insize + outsize + stageinsize + stageoutsize);
+        m_sample_outs   = m_sample_ins + insize;
+        m_stage_ins     = m_sample_outs + outsize;
+        m_stage_outs    = m_stage_ins + stageinsize;
+    }
+    
+    void KiwiPortAudioDeviceManager::start()
+    {
+        if(m_stream)
+        {
+            stop();
+        }
+
+        lock_guard<mutex> guard(m_mutex);
+        // The stream opens the channels up to the last active one, a
+        // direction without active channel isn't opened.
+        PaDeviceInfo const* infoin  = Pa_GetDeviceInfo(m_paraminput.device);
+        PaDeviceInfo const* infoout = Pa_GetDeviceInfo(m_paramoutput.device);
+        m_paraminput.channelCount  = m_active_ins.empty() ? 2 : getChannelCount(m_active_ins, infoin ? infoin->maxInputChannels : 0);
+        m_paramoutput.channelCount = m_active_outs.empty() ? 2 : getChannelCount(m_active_outs, infoout ? infoout->maxOutputChannels : 0);
+        PaStreamParameters const* input  = m_paraminput.channelCount ? &m_paraminput : nullptr;
+        PaStreamParameters const* output = m_paramoutput.channelCount ? &m_paramoutput : nullptr;
+        split(m_arena);
+        const ulong ratio = m_oversampling.load();
+        m_oversampler.reset(ratio > 1 ? new DspOversampler(ulong(m_paraminput.channelCount), ulong(m_paramoutput.channelCount), m_vectorsize, ratio) : nullptr);
+        if(m_nthreads > 1)
+        {
+            m_pool.reset(new DspThreadPool(m_nthreads));
+            m_pool->setDenormalsProtection(m_denormals.load());
+        }
+        m_resampler_ins.reset();
+        m_resampler_outs.reset();
+        if(isResampling())
+        {
+            // The chunks are a vector at the rate of the device, the output
+            // fifo starts with the frames the filters and the vectors hold
+            // back.
+            const ulong nins    = ulong(m_paraminput.channelCount);
+            const ulong nouts   = ulong(m_paramoutput.channelCount);
+            const ulong chunk   = max((m_vectorsize * m_samplerate) / m_engine_samplerate, 1ul);
+            m_resampler_ins.reset(new DspResampler(nins, m_samplerate, m_engine_samplerate, m_resampler_quality, chunk));
+            const ulong maxframes = m_resampler_ins->getMaximumOutput(chunk);
+            m_resampler_outs.reset(new DspResampler(nouts, m_engine_samplerate, m_samplerate, m_resampler_quality, maxframes));
+            const ulong latency = m_vectorsize + m_resampler_ins->getMaximumOutput(m_resampler_ins->getLatency()) + m_resampler_outs->getLatency() + 2;
+            m_resampled_ins.assign(nins * maxframes, 0.f);
+            m_resampled_outs.assign(nouts * (maxframes + 4 * m_resampler_outs->getLatency() + 2), 0.f);
+            m_fifo_ins.prepare(nins, m_vectorsize + maxframes);
+            m_fifo_outs.prepare(nouts, latency + m_vectorsize * 2 + maxframes);
+            m_fifo_outs.clear(latency);
+        }
+        else if(isAdapting())
+        {
+            // The output fifo is primed once with the delay the buffer size
+            // requires, or the delay of any size when the driver chooses it.
+            const ulong buffersize = m_adapter && !m_blocking ? 1ul : getBufferSize();
+            m_fifo_ins.prepare(m_paraminput.channelCount, m_vectorsize);
+            m_fifo_outs.prepare(m_paramoutput.channelCount, m_vectorsize * 2);
+            m_fifo_outs.clear(DspFifo::getLatency(buffersize, m_vectorsize));
+        }
+        m_stream_format            = m_format;
+        m_paraminput.sampleFormat  = getPortAudioFormat(m_stream_format);
+        m_paramoutput.sampleFormat = getPortAudioFormat(m_stream_format);
+        if(m_stream_format != Float32 && Pa_IsFormatSupported(input, output, m_samplerate) != paFormatIsSupported)
+        {
+            // The requested format is kept so the next stream tries it again.
+            cout << "PortAudio error: the sample format isn't supported, the stream uses Float32" << endl;
+            m_stream_format = Float32;
+            m_paraminput.sampleFormat  = paFloat32;
+            m_paramoutput.sampleFormat = paFloat32;
+        }
+        m_planar = m_noninterleaved && m_stream_format == Float32 && !m_adapter && !m_blocking && !m_watchdog_buffersize && !isResampling();
+        if(m_planar)
+        {
+            m_paraminput.sampleFormat  |= paNonInterleaved;
+            m_paramoutput.sampleFormat |= paNonInterleaved;
+        }
+        if(m_stream_format != Float32)
+        {
+            m_convert_size = max(m_vectorsize, 1024ul);
+            m_convert_ins.assign(m_paraminput.channelCount * m_convert_size, 0.f);
+            m_convert_outs.assign(m_paramoutput.channelCount * m_convert_size, 0.f);
+        }
+        if(m_blocking)
+        {
+            m_io_ins.assign(m_paraminput.channelCount * getBufferSize() * getSampleSize(m_stream_format), 0);
+            m_io_outs.assign(m_paramoutput.channelCount * getBufferSize() * getSampleSize(m_stream_format), 0);
+            DspArena::lock(m_arena.data(), m_arena.getCapacity() * sizeof(sample));
+            DspArena::lock(m_io_ins.data(), m_io_ins.size());
+            DspArena::lock(m_io_outs.data(), m_io_outs.size());
+            DspArena::lock(m_convert_ins.data(), m_convert_ins.size() * sizeof(float));
+            DspArena::lock(m_convert_outs.data(), m_convert_outs.size() * sizeof(float));
+        }
+        
+        m_route.reset(new Route{this, ++m_nroutes, ulong(m_paramoutput.channelCount), getSampleSize(m_stream_format), m_planar});
+        m_active.store(m_route->generation);
+        m_fadein.store(false);
+        m_republish = false;
+        publish(new DeviceNode(this));
+        const ulong framesPerBuffer = (m_adapter && !m_blocking) || isResampling() ? paFramesPerBufferUnspecified : getBufferSize();
+        PaError err = Pa_OpenStream(&m_stream, input, output, m_samplerate, framesPerBuffer, paClipOff, m_blocking ? nullptr : &callback, m_route.get());
+        if(err != paNoError)
+        {
+            cout << "PortAudio error: %s\n" << Pa_GetErrorText(err) << endl;
+            m_stream = nullptr;
+            publish(nullptr);
+            reclaim();
+            return;
+        }
+        
+        m_profiler.prepare(m_samplerate);
+        m_watchdog.prepare();
+        err = Pa_StartStream(m_stream);
+        if(err != paNoError)
+        {
+            cout << "PortAudio error: %s\n" << Pa_GetErrorText(err) << endl;
+            Pa_CloseStream(m_stream);
+            m_stream = nullptr;
+            publish(nullptr);
+            reclaim();
+            return;
+        }
+        if(m_blocking)
+        {
+            m_io_running.store(true);
+            m_io = thread(&KiwiPortAudioDeviceManager::run, this, getBufferSize());
+            DspThreadPool::setRealTime(m_io, 0);
+        }
+    }
+
+    
+    vector<ulong> KiwiPortAudioDeviceManager::getActiveChannels(vector<bool> const& mask, const ulong nchannels)
+    {
+        vector<ulong> channels;
+        for(ulong i = 0; i < nchannels; i++)
+        {
+            if(mask.empty() || (i < mask.size() && mask[i]))
+            {
+                channels.push_back(i);
+            }
+        }
+        return channels;
+    }
+    
+    void KiwiPortAudioDeviceManager::publish(DeviceNode* node)
+    {
+        DeviceNode* old = m_node.exchange(node);
+        const ulong epoch = ++m_epoch;
+        if(old)
+        {
+            m_retired.push_back(make_pair(epoch, old));
+        }
+    }
+    
+    void KiwiPortAudioDeviceManager::republish()
+    {
+        if(m_handover_node.load())
+        {
+            m_republish = true;
+        }
+        else if(m_node.load())
+        {
+            publish(new DeviceNode(this));
+            reclaim();
+        }
+    }
+    
+    void KiwiPortAudioDeviceManager::reclaim()
+    {
+        const ulong reader = m_reader.load();
+        for(auto it = m_retired.begin(); it != m_retired.end();)
+        {
+            if(!reader || reader >= it->first)
+            {
+                delete it->second;
+                it = m_retired.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+    
+    DspProfiler::Statistics KiwiPortAudioDeviceManager::getStatistics() const noexcept
+    {
+        return m_profiler.getStatistics();
+    }
+    
+    void KiwiPortAudioDeviceManager::resetStatistics() noexcept
+    {
+        m_profiler.reset();
+    }
+    
+    ulong KiwiPortAudioDeviceManager::getInputLatency() const noexcept
+    {
+        lock_guard<mutex> guard(m_mutex);
+        PaStreamInfo const* info = m_stream ? Pa_GetStreamInfo(m_stream) : nullptr;
+        return info ? ulong(info->inputLatency * info->sampleRate + 0.5) : 0ul;
+    }
+    
+    ulong KiwiPortAudioDeviceManager::getOutputLatency() const noexcept
+    {
+        lock_guard<mutex> guard(m_mutex);
+        PaStreamInfo const* info = m_stream ? Pa_GetStreamInfo(m_stream) : nullptr;
+        return info ? ulong(info->outputLatency * info->sampleRate + 0.5) : 0ul;
+    }
+    
+    long KiwiPortAudioDeviceManager::measureLatency(const ulong input, const ulong output, const DspLatencyProbe::Stimulus stimulus)
+    {
+        if(!m_stream || !Pa_IsStreamActive(m_stream) || input >= ulong(m_paraminput.channelCount) || output >= ulong(m_paramoutput.channelCount))
+        {
+            return -1;
+        }
+        m_probe.prepare(input, output, stimulus, m_samplerate);
+        const chrono::milliseconds timeout((m_probe.getDuration() * 1000) / m_samplerate + 1000);
+        const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        while(!m_probe.isDone() && chrono::steady_clock::now() - start < timeout)
+        {
+            this_thread::sleep_for(chrono::milliseconds(10));
+        }
+        return m_probe.analyze();
+    }
+    
+    bool KiwiPortAudioDeviceManager::startRecording(string const& path, vector<ulong> const& inputs, vector<ulong> const& outputs, const DspRecorder::Format format)
+    {
+        if(!m_stream || !Pa_IsStreamActive(m_stream))
+        {
+            return false;
+        }
+        for(ulong i = 0; i < inputs.size(); i++)
+        {
+            if(inputs[i] >= ulong(m_paraminput.channelCount))
+            {
+                return false;
+            }
+        }
+        for(ulong i = 0; i < outputs.size(); i++)
+        {
+            if(outputs[i] >= ulong(m_paramoutput.channelCount))
+            {
+                return false;
+            }
+        }
+        return m_recorder.start(path, inputs, outputs, m_samplerate, format);
+    }
+    
+    void KiwiPortAudioDeviceManager::stopRecording()
+    {
+        m_recorder.stop();
+    }
+    
+    DspRecorder::Counters KiwiPortAudioDeviceManager::getRecordingCounters() const noexcept
+    {
+        return m_recorder.getCounters();
+    }
+    
+    static inline ulong getProfilerFlags(PaStreamCallbackFlags const flags) noexcept
+    {
+        return ((flags & paInputUnderflow) ? DspProfiler::InputUnderflow : 0ul) |
+        ((flags & paInputOverflow) ? DspProfiler::InputOverflow : 0ul) |
+        ((flags & paOutputUnderflow) ? DspProfiler::OutputUnderflow : 0ul) |
+        ((flags & paOutputOverflow) ? DspProfiler::OutputOverflow : 0ul);
+    }
+    
+    bool KiwiPortAudioDeviceManager::tick(DeviceNode const* node, const ulong nframes, float const* inputs, float* outputs) noexcept
+    {
+        DspFifo* fifo_ins  = node->fifo_ins;
+        DspFifo* fifo_outs = node->fifo_outs;
+        const ulong vectorsize = node->vectorsize;
+        bool underflow = false;
+        for(ulong done = 0; done < nframes;)
+        {
+            const ulong n = min(nframes - done, vectorsize - fifo_ins->getSize());
+            fifo_ins->write(n, inputs + done * node->nins);
+            if(fifo_ins->getSize() == vectorsize)
+            {
+                fifo_ins->pull(vectorsize, node->inputs, vectorsize);
+                Signal::vclear(vectorsize * node->nouts, node->outputs);
+                render(node);
+                fifo_outs->push(vectorsize, node->outputs, vectorsize);
+            }
+            if(fifo_outs->read(n, outputs + done * node->nouts) < n)
+            {
+                underflow = true;
+            }
+            done += n;
+        }
+        return underflow;
+    }
+    
+    bool KiwiPortAudioDeviceManager::resample(DeviceNode const* node, const ulong nframes, float const* inputs, float* outputs) noexcept
+    {
+        DspFifo* fifo_ins  = node->fifo_ins;
+        DspFifo* fifo_outs = node->fifo_outs;
+        DspResampler* resampler_ins  = node->resampler_ins;
+        DspResampler* resampler_outs = node->resampler_outs;
+        const ulong vectorsize  = node->vectorsize;
+        const ulong chunk       = node->chunk;
+        const ulong maxframes   = resampler_ins->getMaximumOutput(chunk);
+        
+        bool underflow = false;
+        for(ulong done = 0; done < nframes;)
+        {
+            const ulong n = min(nframes - done, chunk);
+            DspProfiler::clock::time_point start = DspProfiler::clock::now();
+            const ulong produced = resampler_ins->process(n, inputs + done * node->nins, maxframes, node->resampled_ins);
+            m_profiler.addConversion(start);
+            fifo_ins->write(produced, node->resampled_ins);
+            while(fifo_ins->getSize() >= vectorsize)
+            {
+                fifo_ins->pull(vectorsize, node->inputs, vectorsize);
+                Signal::vclear(vectorsize * node->nouts, node->outputs);
+                render(node);
+                fifo_outs->push(vectorsize, node->outputs, vectorsize);
+            }
+            const ulong required = resampler_outs->getRequiredInput(n);
+            if(fifo_outs->read(required, node->resampled_outs) < required)
+            {
+                underflow = true;
+            }
+            start = DspProfiler::clock::now();
+            resampler_outs->process(required, node->resampled_outs, n, outputs + done * node->nouts);
+            m_profiler.addConversion(start);
+            done += n;
+        }
+        return underflow;
+    }
+    
+    ulong KiwiPortAudioDeviceManager::process(const ulong nframes, float const* inputs, float* outputs) noexcept
+    {
+        ulong flags = 0ul;
+        m_reader.store(m_epoch.load());
+        DeviceNode const* d = m_node.load();
+        if(!d)
+        {
+            m_reader.store(0);
+            return flags;
+        }
+        if(d->resampler_ins || (d->fifo_ins && (nframes != d->vectorsize || d->fifo_ins->getSize() || d->fifo_outs->getSize())))
+        {
+            if(d->resampler_ins ? resample(d, nframes, inputs, outputs) : tick(d, nframes, inputs, outputs))
+            {
+                flags |= DspProfiler::OutputUnderflow;
+            }
+            if(m_probe.isRunning())
+            {
+                const ulong in = m_probe.getInputChannel(), out = m_probe.getOutputChannel();
+                m_probe.process(nframes, inputs + in, d->nins, outputs + out, d->nouts);
+            }
+            if(m_recorder.isRunning())
+            {
+                m_recorder.process(nframes, inputs, d->nins, outputs, d->nouts);
+            }
+            m_reader.store(0);
+            return flags;
+        }
+        if(d->masked)
+        {
+            // Only the active channels are converted and cleared, the other
+            // outputs of the stream are silent.
+            for(ulong i : d->active_ins)
+            {
+                Kernels::deinterleave(d->vectorsize, d->nins, i, inputs, d->inputs + i * d->vectorsize);
+            }
+            for(ulong i : d->active_outs)
+            {
+                Signal::vclear(d->vectorsize, d->outputs + i * d->vectorsize);
+            }
+            render(d);
+            if(d->active_outs.size() < d->nouts)
+            {
+                memset(outputs, 0, d->vectorsize * d->nouts * sizeof(float));
+            }
+            for(ulong i : d->active_outs)
+            {
+                Kernels::interleave(d->vectorsize, d->nouts, i, d->outputs + i * d->vectorsize, outputs);
+            }
+        }
+        else
+        {
+            // The kernels for the numbers of channels are selected with
+            // the node.
+            d->deinterleave(d->vectorsize, d->nins, inputs, d->inputs);
+            Signal::vclear(d->vectorsize * d->nouts, d->outputs);
+            render(d);
+            d->interleave(d->vectorsize, d->nouts, d->outputs, outputs);
+        }
+        if(m_probe.isRunning())
+        {
+            const ulong in = m_probe.getInputChannel(), out = m_probe.getOutputChannel();
+            m_probe.process(nframes, inputs + in, d->nins, outputs + out, d->nouts);
+        }
+        if(m_recorder.isRunning())
+        {
+            m_recorder.process(nframes, inputs, d->nins, outputs, d->nouts);
+        }
+        m_reader.store(0);
+        return flags;
+    }
+    
+    ulong KiwiPortAudioDeviceManager::process(const ulong nframes, float const* const* inputs, float* const* outputs) noexcept
+    {
+        m_reader.store(m_epoch.load());
+        DeviceNode const* d = m_node.load();
+        if(!d)
+        {
+            m_reader.store(0);
+            return 0ul;
+        }
+#ifndef __KIWI_DSP_DOUBLE__
+        if(!d->oversampler)
+        {
+            for(ulong i = 0; i < d->nouts; i++)
+            {
+                Signal::vclear(d->vectorsize, outputs[i]);
+            }
+            m_host_ins.store(inputs, memory_order_relaxed);
+            m_host_outs.store(outputs, memory_order_relaxed);
+            tick(d);
+            m_host_ins.store(nullptr, memory_order_relaxed);
+            m_host_outs.store(nullptr, memory_order_relaxed);
+        }
+        else
+#endif
+        {
+            for(ulong i : d->active_ins)
+            {
+                Kernels::fromFloat(d->vectorsize, inputs[i], d->inputs + i * d->vectorsize);
+            }
+            for(ulong i : d->active_outs)
+            {
+                Signal::vclear(d->vectorsize, d->outputs + i * d->vectorsize);
+            }
+            render(d);
+            if(d->active_outs.size() < d->nouts)
+            {
+                for(ulong i = 0; i < d->nouts; i++)
+                {
+                    Signal::vclear(d->vectorsize, outputs[i]);
+                }
+            }
+            for(ulong i : d->active_outs)
+            {
+                Kernels::toFloat(d->vectorsize, d->outputs + i * d->vectorsize, outputs[i]);
+            }
+        }
+        if(m_probe.isRunning())
+        {
+            m_probe.process(nframes, inputs[m_probe.getInputChannel()], 1, outputs[m_probe.getOutputChannel()], 1);
+        }
+        if(m_recorder.isRunning())
+        {
+            m_recorder.process(nframes, inputs, d->nins, outputs, d->nouts);
+        }
+        m_reader.store(0);
+        return 0ul;
+    }
+    
+    ulong KiwiPortAudioDeviceManager::transfer(const ulong nframes, void const* inputs, void* outputs) noexcept
+    {
+        if(m_planar)
+        {
+            return process(nframes, (float const* const*)inputs, (float* const*)outputs);
+        }
+        else if(m_stream_format == Float32)
+        {
+            return process(nframes, (float const*)inputs, (float *)outputs);
+        }
+        
+        const ulong nins    = ulong(m_paraminput.channelCount);
+        const ulong nouts   = ulong(m_paramoutput.channelCount);
+        const ulong size    = getSampleSize(m_stream_format);
+        Kernels::Dither* dither = m_dither.load(memory_order_relaxed) ? &m_dither_state : nullptr;
+        ulong flags = 0ul;
+        for(ulong done = 0; done < nframes;)
+        {
+            const ulong n = min(nframes - done, m_convert_size);
+            char const* in  = (char const*)inputs + done * nins * size;
+            char* out       = (char *)outputs + done * nouts * size;
+            
+            DspProfiler::clock::time_point start = DspProfiler::clock::now();
+            switch(m_stream_format)
+            {
+                case Int32: Kernels::fromInt32(n * nins, (int32_t const*)in, m_convert_ins.data()); break;
+                case Int24: Kernels::fromInt24(n * nins, (uint8_t const*)in, m_convert_ins.data()); break;
+                default:    Kernels::fromInt16(n * nins, (int16_t const*)in, m_convert_ins.data()); break;
+            }
+            m_profiler.addConversion(start);
+            
+            flags |= process(n, m_convert_ins.data(), m_convert_outs.data());
+            
+            start = DspProfiler::clock::now();
+            switch(m_stream_format)
+            {
+                case Int32: Kernels::toInt32(n * nouts, m_convert_outs.data(), (int32_t *)out); break;
+                case Int24: Kernels::toInt24(n * nouts, m_convert_outs.data(), (uint8_t *)out, dither); break;
+                default:    Kernels::toInt16(n * nouts, m_convert_outs.data(), (int16_t *)out, dither); break;
+            }
+            m_profiler.addConversion(start);
+            done += n;
+        }
+        return flags;
+    }
+    
+    void KiwiPortAudioDeviceManager::run(const ulong vectorsize) noexcept
+    {
+        const bool input  = m_paraminput.channelCount > 0;
+        const bool output = m_paramoutput.channelCount > 0;
+        ulong flags = 0ul;
+        while(m_io_running.load(memory_order_relaxed))
+        {
+            if(input && Pa_ReadStream(m_stream, m_io_ins.data(), vectorsize) == paInputOverflowed)
+            {
+                flags |= DspProfiler::InputOverflow;
+            }
+            const DspProfiler::clock::time_point start = m_profiler.begin();
+            flags |= transfer(vectorsize, m_io_ins.data(), m_io_outs.data());
+            m_watchdog.update(m_profiler.end(start, vectorsize, flags));
+            flags = 0ul;
+            if(output && Pa_WriteStream(m_stream, m_io_outs.data(), vectorsize) == paOutputUnderflowed)
+            {
+                flags |= DspProfiler::OutputUnderflow;
+            }
+        }
+    }
+    
+    int KiwiPortAudioDeviceManager::callback(const void *inputBuffer, void *outputBuffer, ulong framesPerBuffer, const PaStreamCallbackTimeInfo*, PaStreamCallbackFlags statusFlags, void *userData)
+    {
+        Route const* route = (Route const*)userData;
+        KiwiPortAudioDeviceManager* device = route->device;
+        if(route->generation != device->m_active.load(memory_order_acquire))
+        {
+            route->clear(outputBuffer, framesPerBuffer);
+            return paContinue;
+        }
+        
+        const DspProfiler::clock::time_point start = device->m_profiler.begin();
+        const ulong flags = device->transfer(framesPerBuffer, inputBuffer, outputBuffer);
+        if(device->m_fadein.load(memory_order_relaxed))
+        {
+            route->fade(outputBuffer, framesPerBuffer, true);
+            device->m_fadein.store(false, memory_order_relaxed);
+        }
+        else
+        {
+            const ulong handover = device->m_handover.load(memory_order_acquire);
+            if(handover && handover != route->generation)
+            {
+                route->fade(outputBuffer, framesPerBuffer, false);
+                device->m_node.store(device->m_handover_node.load());
+                device->m_fadein.store(true, memory_order_relaxed);
+                device->m_active.store(handover, memory_order_release);
+            }
+        }
+        device->m_watchdog.update(device->m_profiler.end(start, framesPerBuffer, getProfilerFlags(statusFlags) | flags));
+        return paContinue;
     }
 }
 
@@ -27,26 +27,126 @@
 #define __DEF_KIWI_DSP_PORTAUDIO__
 
 #include "../KiwiDsp/KiwiDsp.h"
+#include "KiwiDspKernels.h"
+#include "KiwiDspThreadPool.h"
+#include "KiwiDspProfiler.h"
+#include "KiwiDspArena.h"
+#include "KiwiDspFifo.h"
+#include "KiwiDspDeviceSetup.h"
+#include "KiwiDspLatency.h"
+#include "KiwiDspDenormals.h"
+#include "KiwiDspWatchdog.h"
+#include "KiwiDspOversampler.h"
+#include "KiwiDspResampler.h"
+#include "KiwiDspRecorder.h"
 #include <portaudio.h>
 
 namespace Kiwi
 {
     class KiwiPortAudioDeviceManager : public DspDeviceManager
     {
+    public:
+        
+        //! The sample formats of the stream.
+        enum SampleFormat
+        {
+            Float32 = 0,
+            Int32   = 1,
+            Int24   = 2,
+            Int16   = 3
+        };
+        
+    private:
+        //! The PortAudio session of the process.
+        /** PortAudio must be initialized once before any manager uses it and terminated after the last one, and its initialization isn't thread-safe. Each manager holds a session, the first one initializes PortAudio and the last one terminates it. The count is changed under a mutex shared by the process so several managers can be created and deleted concurrently by different threads.
+         */
+        class Session
+        {
+        private:
+            static mutex            m_mutex;
+            static atomic<ulong>    m_count;
+            bool                    m_valid;
+            
+        public:
+            Session();
+            ~Session();
+            Session(Session const&) = delete;
+            Session& operator=(Session const&) = delete;
+            
+            //! Retrieve the number of sessions.
+            /** This function retrieves the number of sessions that currently hold PortAudio.
+             @return The number of sessions.
+             */
+            static inline ulong getNumberOfSessions() noexcept
+            {
+                return m_count.load(memory_order_acquire);
+            }
+        };
+        
         struct DeviceNode
         {
-            KiwiPortAudioDeviceManager*        device;
             const ulong                        nins;
             sample *const                      inputs;
             const ulong                        nouts;
             sample *const                      outputs;
             const ulong                        samplerate;
             const ulong                        vectorsize;
+            const ulong                        ratio;
+            const vector<sDspContext>          contexts;
+            const vector<sDspContext>          critical;
+            DspThreadPool* const               pool;
+            DspFifo* const                     fifo_ins;
+            DspFifo* const                     fifo_outs;
+            sample *const                      matrix_ins;
+            sample *const                      matrix_outs;
+            const shared_ptr<DspOversampler>   oversampler;
+            DspResampler* const                resampler_ins;
+            DspResampler* const                resampler_outs;
+            float* const                       resampled_ins;
+            float* const                       resampled_outs;
+            const ulong                        chunk;
+            const vector<ulong>                active_ins;
+            const vector<ulong>                active_outs;
+            const bool                         masked;
+            const Kernels::Deinterleaver       deinterleave;
+            const Kernels::Interleaver         interleave;
             
             DeviceNode(KiwiPortAudioDeviceManager* _device);
         };
         
-        static ulong        m_nmanagers;
+        //! The identity of a stream for its callback.
+        /** The route lets the callback know if its stream is the one that ticks the dsp and how to write silence or a fade in its output buffer.
+         */
+        struct Route
+        {
+            KiwiPortAudioDeviceManager* device;
+            ulong                       generation;
+            ulong                       nouts;
+            ulong                       size;
+            bool                        planar;
+            
+            void clear(void* outputs, const ulong nframes) const noexcept;
+            
+            void fade(void* outputs, const ulong nframes, const bool in) const noexcept;
+        };
+        
+        //! The capabilities of the current driver and devices.
+        struct Capabilities
+        {
+            struct Device
+            {
+                string          name;
+                PaDeviceIndex   index;
+            };
+            
+            bool            devices;
+            bool            samplerates;
+            vector<Device>  inputs;
+            vector<Device>  outputs;
+            vector<ulong>   rates;
+        };
+        
+        const Session       m_session;
 
         PaHostApiIndex      m_driver;
         PaStreamParameters  m_paraminput;
@@ -55,19 +155,297 @@ namespace Kiwi
         ulong               m_vectorsize;
         
         PaStream*           m_stream;
+        DspArena            m_arena;
         sample*             m_sample_ins;
         sample*             m_sample_outs;
+        sample*             m_stage_ins;
+        sample*             m_stage_outs;
+        atomic<ulong>       m_oversampling;
+        shared_ptr<DspOversampler> m_oversampler;
+        ulong               m_engine_samplerate;
+        DspResampler::Quality m_resampler_quality;
+        unique_ptr<DspResampler> m_resampler_ins;
+        unique_ptr<DspResampler> m_resampler_outs;
+        vector<float>       m_resampled_ins;
+        vector<float>       m_resampled_outs;
+        vector<bool>        m_active_ins;
+        vector<bool>        m_active_outs;
         vector<sDspContext> m_contexts;
-        mutex               m_mutex;
+        vector<sDspContext> m_critical;
+        mutable mutex       m_mutex;
+        ulong               m_nthreads;
+        unique_ptr<DspThreadPool> m_pool;
+        DspProfiler         m_profiler;
+        bool                m_adapter;
+        DspFifo             m_fifo_ins;
+        DspFifo             m_fifo_outs;
+        ulong               m_changes;
+        bool                m_pending;
+        bool                m_blocking;
+        atomic<bool>        m_io_running;
+        thread              m_io;
+        vector<char>        m_io_ins;
+        vector<char>        m_io_outs;
+        SampleFormat        m_format;
+        SampleFormat        m_stream_format;
+        atomic<bool>        m_dither;
+        atomic<bool>        m_denormals;
+        Kernels::Dither     m_dither_state;
+        ulong               m_convert_size;
+        vector<float>       m_convert_ins;
+        vector<float>       m_convert_outs;
+        bool                m_noninterleaved;
+        bool                m_planar;
+        atomic<sample const* const*> m_host_ins;
+        atomic<sample* const*> m_host_outs;
+        mutable mutex       m_capabilities_mutex;
+        mutable condition_variable m_capabilities_condition;
+        Capabilities        m_capabilities;
+        ulong               m_generation;
+        ulong               m_scanned;
+        PaHostApiIndex      m_scan_driver;
+        PaStreamParameters  m_scan_input;
+        PaStreamParameters  m_scan_output;
+        bool                m_scanning;
+        thread              m_scanner;
+        DspLatencyProbe     m_probe;
+        DspRecorder         m_recorder;
+        DspWatchdog         m_watchdog;
+        ulong               m_watchdog_buffersize;
+        unique_ptr<Route>   m_route;
+        ulong               m_nroutes;
+        atomic<ulong>       m_active;
+        atomic<ulong>       m_handover;
+        atomic<DeviceNode*> m_handover_node;
+        bool                m_republish;
+        atomic<bool>        m_fadein;
+        bool                m_seamless;
+        DspArena            m_switch_arena;
+        
+        atomic<DeviceNode*> m_node;
+        atomic<ulong>       m_epoch;
+        atomic<ulong>       m_reader;
+        vector<pair<ulong, DeviceNode*>> m_retired;
+        
+        //! Restart the device.
+        /** This function restarts the device or, between beginChanges() and commitChanges(), defers the restart to the commit.
+         */
+        void restart();
+        
+        //! Restart the device after a change of device.
+        /** This function switches to the new devices without gap when the seamless switch is possible, otherwise it restarts the device.
+         */
+        void reroute();
+        
+        //! Switch to the new devices without gap.
+        /** This function opens and starts a stream on the new devices while the current stream is still running. The new stream outputs silence until the current one ticks a last block with a fade out and hands the dsp over at the block boundary, then the new stream ticks the dsp with a fade in and the previous stream is closed.
+         @return True if the switch has been done, false if the seamless switch isn't possible.
+         */
+        bool handover();
+        
+        //! Split an arena in the matrices.
+        /** This function reserves the memory of the matrices of the dsp, sized for the largest oversampling ratio so the ratio can change while the stream runs, followed by the matrices at the rate of the device used when the dsp is oversampled.
+         @param arena The arena.
+         */
+        void split(DspArena& arena);
+        
+        //! Invalidate the capabilities.
+        /** This function invalidates the cached capabilities and asks the scanner to refill them with a copy of the current parameters. It never waits for a scan, a scan still running is discarded when it ends.
+         @param devices True if the list of devices changed, false if only the sample rates must be probed again.
+         */
+        void invalidate(const bool devices);
+        
+        //! Refill the capabilities in the background.
+        /** This function runs on the scanner thread until the manager is destroyed. It probes the devices without any lock and only commits the result if no other invalidation happened meanwhile.
+         */
+        void scanner();
+        
+        //! Fill the capabilities.
+        /** This function probes the driver and the devices. It doesn't lock anything and only reads its parameters.
+         @param capabilities The capabilities to fill.
+         @param devices True if the list of devices must be filled, false if only the sample rates must be probed.
+         @param driver The driver.
+         @param input The input parameters.
+         @param output The output parameters.
+         */
+        static void scan(Capabilities& capabilities, const bool devices, const PaHostApiIndex driver, PaStreamParameters const& input, PaStreamParameters const& output);
+        
+        //! Retrieve the capabilities.
+        /** This function waits until the scanner has filled the cache for the last invalidation then locks it.
+         @return The lock of the capabilities.
+         */
+        unique_lock<mutex> getCapabilities() const;
         
         inline void tick() const noexcept
         {
             DspDeviceManager::tick();
         }
         
-        static int callback(const void *inputBuffer, void *outputBuffer, ulong framesPerBuffer, const PaStreamCallbackTimeInfo* timeInfo, PaStreamCallbackFlags statusFlags, void *userData);
+        //! Tick the dsp for a device node.
+        /** This function ticks the dsp then the contexts of the node, in parallel if the node has a thread pool. It skips the non-critical contexts or the whole dsp when the watchdog degrades the processing, the outputs are cleared before so they stay silent.
+         @param node The device node.
+         */
+        inline void tick(DeviceNode const* node) const noexcept
+        {
+            const DspWatchdog::Level level = m_watchdog.getLevel();
+            if(level == DspWatchdog::Silent)
+            {
+                return;
+            }
+            const DspDenormalsGuard guard(m_denormals.load(memory_order_relaxed));
+            DspDeviceManager::tick();
+            vector<sDspContext> const& contexts = level == DspWatchdog::Reduced ? node->critical : node->contexts;
+            if(node->pool)
+            {
+                node->pool->process(contexts);
+            }
+            else
+            {
+                for(auto const& context : contexts)
+                {
+                    context->tick();
+                }
+            }
+        }
         
-        static void finish(void *userData);
+        //! Tick the dsp at the rate of the dsp.
+        /** This function upsamples the inputs of the node to the matrices of the dsp, ticks the dsp then downsamples the outputs to the node. Without oversampling, the node already uses the matrices of the dsp and it only ticks the dsp. The duration of the filters is added to the profiler.
+         @param node The device node.
+         */
+        inline void render(DeviceNode const* node) noexcept
+        {
+            DspOversampler* const oversampler = node->oversampler.get();
+            if(!oversampler)
+            {
+                tick(node);
+                return;
+            }
+            const ulong vectorsize  = node->vectorsize;
+            const ulong size        = vectorsize * oversampler->getRatio();
+            DspProfiler::clock::time_point start = DspProfiler::clock::now();
+            for(ulong i : node->active_ins)
+            {
+                oversampler->upsample(i, node->inputs + i * vectorsize, node->matrix_ins + i * size);
+            }
+            for(ulong i : node->active_outs)
+            {
+                Signal::vclear(size, node->matrix_outs + i * size);
+            }
+            m_profiler.addFilter(start);
+            tick(node);
+            start = DspProfiler::clock::now();
+            for(ulong i : node->active_outs)
+            {
+                oversampler->downsample(i, node->matrix_outs + i * size, node->outputs + i * vectorsize);
+            }
+            m_profiler.addFilter(start);
+        }
+        
+        //! Retrieve the active channels.
+        /** This function retrieves the indices of the active channels of a mask.
+         @param mask The mask, empty if all the channels are active.
+         @param nchannels The number of channels of the stream.
+         @return The indices of the active channels.
+         */
+        static vector<ulong> getActiveChannels(vector<bool> const& mask, const ulong nchannels);
+        
+        //! Publish a new device node.
+        /** This function atomically replaces the node read by the audio thread and retires the previous one. It must be called from the control thread.
+         @param node The new node or nullptr.
+         */
+        void publish(DeviceNode* node);
+        
+        //! Publish a node for the current state.
+        /** This function publishes a new node if the stream runs. While a handover is pending the publication is deferred, the handover publishes the node once the new stream owns the dsp. It must be called with the mutex locked.
+         */
+        void republish();
+        
+        //! Reclaim the retired device nodes.
+        /** This function deletes the retired nodes that the audio thread can no longer reach. A node retired at a given epoch is reclaimed once the audio thread is idle or has entered a later epoch.
+         */
+        void reclaim();
+        
+        //! Tick the dsp through the fifos.
+        /** This function exchanges the buffers of the stream with the fifos and ticks the dsp each time a full vector is available. It is used when the stream doesn't deliver buffers of the vector size.
+         @param node The device node.
+         @param nframes The number of frames of the buffers.
+         @param inputs The interleaved input buffer.
+         @param outputs The interleaved output buffer.
+         @return True if the output fifo was short of frames.
+         */
+        bool tick(DeviceNode const* node, const ulong nframes, float const* inputs, float* outputs) noexcept;
+        
+        //! Tick the dsp through the resamplers.
+        /** This function converts the buffers of the stream to the rate of the dsp, exchanges them with the fifos and ticks the dsp each time a full vector is available, then converts the outputs back to the rate of the device. The buffers are processed by chunks of a vector of the device.
+         @param node The device node.
+         @param nframes The number of frames of the buffers.
+         @param inputs The interleaved input buffer.
+         @param outputs The interleaved output buffer.
+         @return True if the output fifo was short of frames.
+         */
+        bool resample(DeviceNode const* node, const ulong nframes, float const* inputs, float* outputs) noexcept;
+        
+        //! Retrieve if the stream is resampled.
+        /** This function retrieves if the dsp runs at another rate than the device.
+         @return True if the stream is resampled.
+         */
+        inline bool isResampling() const noexcept
+        {
+            return m_engine_samplerate && m_engine_samplerate != m_samplerate;
+        }
+        
+        //! Retrieve if the stream goes through the fifos.
+        /** This function retrieves if the buffers of the stream are adapted to the vectors of the dsp, either because the buffer adapter is enabled or because the watchdog has raised the buffer size.
+         @return True if the stream goes through the fifos.
+         */
+        inline bool isAdapting() const noexcept
+        {
+            return (m_adapter && !m_blocking) || m_watchdog_buffersize;
+        }
+        
+        //! Retrieve the buffer size of the stream.
+        /** This function retrieves the number of frames the stream is opened with, the vector size or the buffer size raised by the watchdog.
+         @return The buffer size.
+         */
+        inline ulong getBufferSize() const noexcept
+        {
+            return m_watchdog_buffersize ? m_watchdog_buffersize : m_vectorsize;
+        }
+        
+        //! Process a buffer of the stream.
+        /** This function ticks the dsp for an interleaved buffer of the stream, directly or through the fifos. It is shared by the callback and the blocking modes.
+         @param nframes The number of frames of the buffers.
+         @param inputs The interleaved input buffer.
+         @param outputs The interleaved output buffer.
+         @return The profiler flags raised by the processing.
+         */
+        ulong process(const ulong nframes, float const* inputs, float* outputs) noexcept;
+        
+        //! Process a non-interleaved buffer of the stream.
+        /** This function ticks the dsp for the per-channel buffers of the stream. In the float build, the dsp reads and writes the buffers of the stream directly during the tick.
+         @param nframes The number of frames of the buffers.
+         @param inputs The input buffers.
+         @param outputs The output buffers.
+         @return The profiler flags raised by the processing.
+         */
+        ulong process(const ulong nframes, float const* const* inputs, float* const* outputs) noexcept;
+        
+        //! Transfer a buffer of the stream.
+        /** This function converts a buffer of the stream from its sample format to floats, processes it then converts the result back. The conversions are done by chunks so the buffer can be larger than the conversion buffers.
+         @param nframes The number of frames of the buffers.
+         @param inputs The interleaved input buffer in the format of the stream.
+         @param outputs The interleaved output buffer in the format of the stream.
+         @return The profiler flags raised by the processing.
+         */
+        ulong transfer(const ulong nframes, void const* inputs, void* outputs) noexcept;
+        
+        //! Run the blocking mode.
+        /** This function reads, processes and writes the buffers of the stream on the real-time thread of the device until the device stops.
+         @param vectorsize The number of frames of the buffers.
+         */
+        void run(const ulong vectorsize) noexcept;
+        
+        static int callback(const void *inputBuffer, void *outputBuffer, ulong framesPerBuffer, const PaStreamCallbackTimeInfo* timeInfo, PaStreamCallbackFlags statusFlags, void *userData);
         
     public:
         //! Constructor
@@ -182,6 +560,191 @@ namespace Kiwi
          */
         void setSampleRate(ulong const samplerate) override;
         
+        //! Set the blocking mode.
+        /** This function enables or disables the blocking mode. In the blocking mode, the device doesn't use the callback of the driver but reads and writes the stream with Pa_ReadStream() and Pa_WriteStream() from its own thread. This thread is pinned to a core, runs with a real-time priority and its buffers are locked in memory when the system allows it. The buffer adapter is ignored in this mode.
+         @param state True to enable the blocking mode, false to use the callback.
+         */
+        void setBlockingMode(const bool state);
+        
+        //! Retrieve if the blocking mode is enabled.
+        /** This function retrieves if the blocking mode is enabled.
+         @return True if the blocking mode is enabled, otherwise false.
+         */
+        bool hasBlockingMode() const noexcept;
+        
+        //! Set the sample format.
+        /** This function sets the sample format of the stream. With an integer format the conversions are done by the device manager with the vectorized kernels instead of the generic converters of PortAudio. If the devices don't support the format when the device starts, this stream falls back to Float32 while the requested format is kept for the next start. The time spent in the conversions is reported by the statistics.
+         @param format The sample format.
+         */
+        void setSampleFormat(const SampleFormat format);
+        
+        //! Retrieve the sample format.
+        /** This function retrieves the requested sample format, the stream may run in Float32 if the devices don't support it.
+         @return The sample format.
+         */
+        SampleFormat getSampleFormat() const noexcept;
+        
+        //! Set the non-interleaved mode.
+        /** This function enables or disables the non-interleaved mode. In this mode the stream is opened with one buffer per channel. In the float build, getInputsSamples() and getOutputsSamples() return the buffers of the stream during the tick so the callback doesn't copy the samples, the dsp must then retrieve the pointers at each tick. In the double build, the buffers are only converted. The mode is ignored with the buffer adapter, the blocking mode and the integer formats.
+         @param state True to enable the non-interleaved mode, false to disable it.
+         */
+        void setNonInterleaved(const bool state);
+        
+        //! Retrieve if the non-interleaved mode is enabled.
+        /** This function retrieves if the non-interleaved mode is enabled.
+         @return True if the non-interleaved mode is enabled, otherwise false.
+         */
+        bool isNonInterleaved() const noexcept;
+        
+        //! Set the dither.
+        /** This function enables or disables the triangular dither of the outputs for the 16 and 24 bits formats.
+         @param state True to enable the dither, false to disable it.
+         */
+        void setDither(const bool state) noexcept;
+        
+        //! Retrieve if the dither is enabled.
+        /** This function retrieves if the dither of the outputs is enabled.
+         @return True if the dither is enabled, otherwise false.
+         */
+        bool hasDither() const noexcept;
+        
+        //! Set the protection against the denormals.
+        /** This function enables or disables the flush-to-zero and denormals-are-zero modes of the floating-point unit while the dsp and the contexts are ticked, on the audio thread and on the threads of the pool. The protection is enabled by default.
+         @param state True to enable the protection, false to disable it.
+         */
+        void setDenormalsProtection(const bool state);
+        
+        //! Retrieve if the protection against the denormals is enabled.
+        /** This function retrieves if the protection against the denormals is enabled.
+         @return True if the protection is enabled, otherwise false.
+         */
+        bool hasDenormalsProtection() const noexcept;
+        
+        //! Set the seamless switch.
+        /** This function enables or disables the seamless switch of devices. When it is enabled, a change of input or output device outside of a set of changes opens the new devices while the current ones are still running and hands the dsp over at a block boundary with a crossfade of one block. It only applies to Float32 streams driven by the callback without the buffer adapter, the other changes restart the device.
+         @param state True to enable the seamless switch, false to disable it.
+         */
+        void setSeamlessSwitch(const bool state) noexcept;
+        
+        //! Retrieve if the seamless switch is enabled.
+        /** This function retrieves if the seamless switch of devices is enabled.
+         @return True if the seamless switch is enabled, otherwise false.
+         */
+        bool hasSeamlessSwitch() const noexcept;
+        
+        //! Set the oversampling ratio.
+        /** This function sets the ratio between the rate of the dsp and the rate of the device. The dsp is ticked once per vector of the device with vectors ratio times larger, so the contexts must be compiled with a sample rate of getSampleRate() * getOversampling() and a vector size of getVectorSize() * getOversampling(). The inputs are upsampled and the outputs downsampled by cascaded half-band filters. The ratio can change while the stream runs, the new filters replace the current ones at a block boundary without reopening the device. The filters are only built again when the ratio or the stream changes, adding or removing contexts keeps their state. The ratio 1, the default, disables the oversampling.
+         @param ratio The ratio, 1, 2, 4 or 8.
+         */
+        void setOversampling(const ulong ratio);
+        
+        //! Retrieve the oversampling ratio.
+        /** This function retrieves the ratio between the rate of the dsp and the rate of the device. While the stream runs it is the ratio the dsp is ticked with, a new ratio is only reported once it is applied.
+         @return The ratio.
+         */
+        ulong getOversampling() const noexcept;
+        
+        //! Retrieve the latency of the oversampling.
+        /** This function retrieves the delay that the filters of the oversampling add between the inputs and the outputs. It isn't included in the latencies reported by the device.
+         @return The latency in samples at the rate of the device.
+         */
+        ulong getOversamplingLatency() const noexcept;
+        
+        //! Set the sample rate of the engine.
+        /** This function sets a fixed sample rate for the dsp whatever the sample rate of the device is. When the rates differ, the buffers of the stream are converted by streaming resamplers and a fifo feeds the dsp with vectors of the vector size, so the contexts must be compiled with getEngineSampleRate(). The resampling adds the delay of the filters and up to a vector. The rate 0, the default, runs the dsp at the rate of the device.
+         @param samplerate The sample rate or 0.
+         */
+        void setEngineSampleRate(const ulong samplerate);
+        
+        //! Retrieve the sample rate of the engine.
+        /** This function retrieves the sample rate the dsp runs at.
+         @return The fixed sample rate of the engine or the sample rate of the device.
+         */
+        ulong getEngineSampleRate() const noexcept;
+        
+        //! Set the quality of the resampling.
+        /** This function sets the filters of the resampling between the rate of the device and the rate of the engine. The fast quality has a short filter with a low latency and a moderate rejection, the high quality a long filter that keeps the band and the noise floor of the signal. The change restarts the device if the stream is resampled.
+         @param quality The quality.
+         */
+        void setResamplerQuality(const DspResampler::Quality quality);
+        
+        //! Retrieve the quality of the resampling.
+        /** This function retrieves the filters of the resampling between the rate of the device and the rate of the engine.
+         @return The quality.
+         */
+        DspResampler::Quality getResamplerQuality() const noexcept;
+        
+        //! Set the active input channels.
+        /** This function sets the input channels the dsp uses. The stream opens the channels of the device up to the last active one and only the active channels are converted, the other ones are reported as missing so getInputsSamples() returns nullptr for them. An empty mask, the default, opens the first two channels. The change restarts the device, or waits for the commit inside a set of changes.
+         @param mask The state of each channel, true if the channel is active.
+         */
+        void setActiveInputs(vector<bool> const& mask);
+        
+        //! Set the active output channels.
+        /** This function sets the output channels the dsp uses. The stream opens the channels of the device up to the last active one and only the active channels are cleared and converted, the other ones are silent and getOutputsSamples() returns nullptr for them. An empty mask, the default, opens the first two channels. The change restarts the device, or waits for the commit inside a set of changes.
+         @param mask The state of each channel, true if the channel is active.
+         */
+        void setActiveOutputs(vector<bool> const& mask);
+        
+        //! Retrieve if an input channel is active.
+        /** This function retrieves if an input channel is in the mask of the active inputs.
+         @param channel The index of the channel.
+         @return True if the channel is active, otherwise false.
+         */
+        bool isInputActive(const ulong channel) const noexcept;
+        
+        //! Retrieve if an output channel is active.
+        /** This function retrieves if an output channel is in the mask of the active outputs.
+         @param channel The index of the channel.
+         @return True if the channel is active, otherwise false.
+         */
+        bool isOutputActive(const ulong channel) const noexcept;
+        
+        //! Set the rules of the watchdog.
+        /** This function sets how the device reacts when several consecutive callbacks run past their budget: skip the non-critical contexts, output silence instead of ticking the dsp, raise the buffer size of the stream to the next available vector size, or any combination. The processing and the buffer size are restored when the load drops again. The buffer size is only changed by pollWatchdog() so the application must call it regularly from its control thread to follow the requests. The vector size of the dsp never changes, the larger buffers are cut into vectors by the fifos of the buffer adapter, so the contexts don't need to be compiled again. No rule, the default, disables the watchdog.
+         @param rules The combination of DspWatchdog::Rule.
+         */
+        void setWatchdogRules(const ulong rules);
+        
+        //! Retrieve the rules of the watchdog.
+        /** This function retrieves the rules of the watchdog.
+         @return The combination of DspWatchdog::Rule.
+         */
+        ulong getWatchdogRules() const noexcept;
+        
+        //! Retrieve the level of the watchdog.
+        /** This function retrieves the current degradation of the processing.
+         @return The level.
+         */
+        DspWatchdog::Level getWatchdogLevel() const noexcept;
+        
+        //! Follow the requests of the watchdog.
+        /** This function raises the buffer size of the stream when the watchdog has detected an overload and lowers it back to the vector size when the load stays low, the stream restarts when the buffer size changes. It must be called periodically by the control thread, every 100 milliseconds for example, while the rule RaiseVectorSize is set.
+         */
+        void pollWatchdog();
+        
+        //! Refresh the capabilities.
+        /** This function drops the cached devices and sample rates and probes them again in the background. PortAudio doesn't notify the hot-plugs so it must be called when the application knows that the devices changed.
+         */
+        void refreshCapabilities();
+        
+        //! Begin a set of changes.
+        /** This function defers the restart of the device until the matching call to commitChanges(), so several parameters can be changed with only one restart. The calls can be nested.
+         */
+        void beginChanges() noexcept;
+        
+        //! Commit a set of changes.
+        /** This function ends a set of changes started with beginChanges() and restarts the device once if a parameter changed.
+         */
+        void commitChanges();
+        
+        //! Apply a setup.
+        /** This function changes the driver, the devices, the sample rate and the vector size then restarts the device once. The parameters are validated in this order so each one is checked against the ones before.
+         @param setup The setup.
+         @return True if all the parameters have been applied, false if some were not available.
+         */
+        bool applySetup(DspDeviceSetup const& setup);
+        
         //! Retrieve the inputs sample matrix.
         /** This function retrieves the inputs sample matrix.
          @param channel the index of the channel.
@@ -196,6 +759,102 @@ namespace Kiwi
          */
         sample* getOutputsSamples(const ulong channel) const noexcept override;
         
+        //! Add a context to tick.
+        /** This function adds a context that the device ticks after the dsp at each block. The contexts added this way can be ticked in parallel so they must be independent, they must not share signals nor write the same outputs. The non-critical contexts are skipped when the watchdog degrades the processing.
+         @param context The context.
+         @param critical False if the context can be skipped during an overload.
+         */
+        void addContext(sDspContext context, const bool critical = true);
+        
+        //! Remove a context to tick.
+        /** This function removes a context added with addContext.
+         @param context The context.
+         */
+        void removeContext(sDspContext context);
+        
+        //! Set the number of threads.
+        /** This function sets the number of threads used to tick the contexts, including the audio thread. One, the default, means that the contexts are ticked serially on the audio thread, zero means one thread per core.
+         @param nthreads The number of threads.
+         */
+        void setNumberOfThreads(ulong const nthreads);
+        
+        //! Retrieve the number of threads.
+        /** This function retrieves the number of threads used to tick the contexts.
+         @return The number of threads.
+         */
+        ulong getNumberOfThreads() const noexcept;
+        
+        //! Retrieve the number of managers.
+        /** This function retrieves the number of managers that currently hold PortAudio in the process.
+         @return The number of managers.
+         */
+        static ulong getNumberOfManagers() noexcept;
+        
+        //! Set the buffer adapter.
+        /** This function enables or disables the buffer adapter. When it is enabled, the stream lets the driver choose the size of its buffers and a fifo feeds the dsp with vectors of the vector size. As the driver may change the size of its buffers, the fifo adds a latency of the vector size minus one frame when the stream starts, which avoids the underflows for any buffer size.
+         @param state True to enable the adapter, false to disable it.
+         */
+        void setBufferAdapter(const bool state);
+        
+        //! Retrieve if the buffer adapter is enabled.
+        /** This function retrieves if the buffer adapter is enabled.
+         @return True if the adapter is enabled, otherwise false.
+         */
+        bool hasBufferAdapter() const noexcept;
+        
+        //! Retrieve the statistics of the callback.
+        /** This function retrieves a snapshot of the durations, the loads and the xruns of the callback since the device started or since the last reset.
+         @return The statistics.
+         */
+        DspProfiler::Statistics getStatistics() const noexcept;
+        
+        //! Reset the statistics of the callback.
+        /** This function resets the statistics of the callback.
+         */
+        void resetStatistics() noexcept;
+        
+        //! Retrieve the input latency.
+        /** This function retrieves the input latency reported by the driver for the current stream.
+         @return The input latency in samples or zero if the stream isn't open.
+         */
+        ulong getInputLatency() const noexcept;
+        
+        //! Retrieve the output latency.
+        /** This function retrieves the output latency reported by the driver for the current stream.
+         @return The output latency in samples or zero if the stream isn't open.
+         */
+        ulong getOutputLatency() const noexcept;
+        
+        //! Measure the round-trip latency.
+        /** This function plays a stimulus on an output channel, records an input channel and finds the stimulus in the recording. The channels must be connected with a loopback cable and the stream must be running. The function blocks until the measure is done and the stimulus replaces the output of the dsp on the output channel meanwhile.
+         @param input The index of the input channel.
+         @param output The index of the output channel.
+         @param stimulus The stimulus.
+         @return The round-trip latency in samples or -1 if the measure failed.
+         */
+        long measureLatency(const ulong input, const ulong output, const DspLatencyProbe::Stimulus stimulus = DspLatencyProbe::Sequence);
+        
+        //! Start a recording.
+        /** This function records input channels of the device and output channels of the dsp to a file while the device plays. The audio thread copies the channels to a ring buffer and a writer thread streams them to the file, so the callback never waits for the disk. The recording goes on through the restarts of the device until stopRecording() is called.
+         @param path The path of the file.
+         @param inputs The indices of the input channels.
+         @param outputs The indices of the output channels, written after the inputs.
+         @param format The format of the file.
+         @return True if the recording has started, false if the device isn't playing, a channel doesn't exist or the file can't be opened.
+         */
+        bool startRecording(string const& path, vector<ulong> const& inputs, vector<ulong> const& outputs, const DspRecorder::Format format = DspRecorder::Wave64);
+        
+        //! Stop the recording.
+        /** This function stops the recording, writes the remaining frames and closes the file.
+         */
+        void stopRecording();
+        
+        //! Retrieve the counters of the recording.
+        /** This function retrieves the number of frames written and the buffers dropped because the disk fell behind.
+         @return The counters.
+         */
+        DspRecorder::Counters getRecordingCounters() const noexcept;
+        
         //! Start the device.
         /** This function starts the device.
          */
@@ -0,0 +1,768 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+*/
+
+#ifdef __KIWI_PORTAUDIO_MOCK__
+
+#include "KiwiDspPortAudioMock.h"
+#include <deque>
+
+namespace Kiwi
+{
+    //! A stream of the mock.
+    struct MockStream
+    {
+        PaStreamParameters      input;
+        PaStreamParameters      output;
+        double                  samplerate;
+        ulong                   framesPerBuffer;
+        PaStreamFlags           streamFlags;
+        PaStreamCallback*       callback;
+        void*                   userData;
+        bool                    active;
+        PaStreamInfo            info;
+        PaTime                  time;
+        ulong                   credit;
+        PaStreamCallbackFlags   flags;
+        vector<char>            inputs;
+        vector<char>            outputs;
+        vector<void*>           channels_ins;
+        vector<void*>           channels_outs;
+    };
+    
+    //! The state of the mock.
+    struct MockState
+    {
+        mutex                   guard;
+        mutex                   processing;
+        condition_variable      condition;
+        ulong                   ninits = 0;
+        deque<string>           names;
+        deque<PaHostApiInfo>    drivers;
+        deque<PaDeviceInfo>     devices;
+        vector<vector<ulong>>   samplerates;
+        vector<PaSampleFormat>  formats;
+        vector<ulong>           buffersizes;
+        vector<MockStream*>     streams;
+        ulong                   nopens = 0;
+        ulong                   nbuffers = 0;
+    };
+    
+    static MockState& getState()
+    {
+        static MockState state;
+        return state;
+    }
+    
+    static ulong getSampleSize(const PaSampleFormat format) noexcept
+    {
+        switch(format & ~paNonInterleaved)
+        {
+            case paFloat32: return 4;
+            case paInt32:   return 4;
+            case paInt24:   return 3;
+            case paInt16:   return 2;
+            default:        return 0;
+        }
+    }
+    
+    static PaError check(MockState const& state, const PaStreamParameters* params, const double samplerate, const bool input)
+    {
+        if(!params)
+        {
+            return paNoError;
+        }
+        if(params->device < 0 || params->device >= PaDeviceIndex(state.devices.size()))
+        {
+            return paInvalidDevice;
+        }
+        PaDeviceInfo const& info = state.devices[params->device];
+        if(params->channelCount <= 0 || params->channelCount > (input ? info.maxInputChannels : info.maxOutputChannels))
+        {
+            return paInvalidChannelCount;
+        }
+        const PaSampleFormat format = params->sampleFormat & ~paNonInterleaved;
+        if(!getSampleSize(format) || !(state.formats[params->device] & format))
+        {
+            return paSampleFormatNotSupported;
+        }
+        vector<ulong> const& rates = state.samplerates[params->device];
+        if(find(rates.begin(), rates.end(), ulong(samplerate)) == rates.end() || double(ulong(samplerate)) != samplerate)
+        {
+            return paInvalidSampleRate;
+        }
+        return paNoError;
+    }
+    
+    static MockStream* getActiveStream(MockState const& state) noexcept
+    {
+        for(auto it = state.streams.rbegin(); it != state.streams.rend(); ++it)
+        {
+            if((*it)->active)
+            {
+                return *it;
+            }
+        }
+        return nullptr;
+    }
+    
+    static ulong getBufferSize(MockState const& state, MockStream const* stream) noexcept
+    {
+        if(stream->framesPerBuffer != paFramesPerBufferUnspecified)
+        {
+            return stream->framesPerBuffer;
+        }
+        const PaDeviceIndex device = stream->output.channelCount ? stream->output.device : stream->input.device;
+        return state.buffersizes[device];
+    }
+    
+    static void prepare(vector<char>& buffer, vector<void*>& channels, PaStreamParameters const& params, const ulong nframes)
+    {
+        const ulong size = getSampleSize(params.sampleFormat);
+        buffer.assign(ulong(params.channelCount) * nframes * size, 0);
+        channels.resize(ulong(params.channelCount));
+        for(ulong i = 0; i < channels.size(); i++)
+        {
+            channels[i] = buffer.data() + i * nframes * size;
+        }
+    }
+    
+    void DspPortAudioMock::reset()
+    {
+        MockState& state = getState();
+        lock_guard<mutex> lock(state.processing);
+        lock_guard<mutex> guard(state.guard);
+        for(auto stream : state.streams)
+        {
+            delete stream;
+        }
+        state.streams.clear();
+        state.names.clear();
+        state.drivers.clear();
+        state.devices.clear();
+        state.samplerates.clear();
+        state.formats.clear();
+        state.buffersizes.clear();
+        state.nopens    = 0;
+        state.nbuffers  = 0;
+        state.condition.notify_all();
+    }
+    
+    PaHostApiIndex DspPortAudioMock::addDriver(string const& name)
+    {
+        MockState& state = getState();
+        lock_guard<mutex> guard(state.guard);
+        state.names.push_back(name);
+        PaHostApiInfo info;
+        info.structVersion          = 1;
+        info.type                   = paInDevelopment;
+        info.name                   = state.names.back().c_str();
+        info.deviceCount            = 0;
+        info.defaultInputDevice     = paNoDevice;
+        info.defaultOutputDevice    = paNoDevice;
+        state.drivers.push_back(info);
+        return PaHostApiIndex(state.drivers.size() - 1);
+    }
+    
+    PaDeviceIndex DspPortAudioMock::addDevice(const PaHostApiIndex driver, Device const& device)
+    {
+        MockState& state = getState();
+        lock_guard<mutex> guard(state.guard);
+        if(driver < 0 || driver >= PaHostApiIndex(state.drivers.size()))
+        {
+            return paNoDevice;
+        }
+        const PaDeviceIndex index = PaDeviceIndex(state.devices.size());
+        state.names.push_back(device.name);
+        PaDeviceInfo info;
+        info.structVersion              = 2;
+        info.name                       = state.names.back().c_str();
+        info.hostApi                    = driver;
+        info.maxInputChannels           = int(device.ninputs);
+        info.maxOutputChannels          = int(device.noutputs);
+        info.defaultLowInputLatency     = device.latency;
+        info.defaultLowOutputLatency    = device.latency;
+        info.defaultHighInputLatency    = device.latency;
+        info.defaultHighOutputLatency   = device.latency;
+        info.defaultSampleRate          = device.samplerates.empty() ? 0. : double(device.samplerates[0]);
+        state.devices.push_back(info);
+        state.samplerates.push_back(device.samplerates);
+        state.formats.push_back(device.formats);
+        state.buffersizes.push_back(max(device.buffersize, 1ul));
+        
+        PaHostApiInfo& host = state.drivers[driver];
+        host.deviceCount++;
+        if(device.ninputs && host.defaultInputDevice == paNoDevice)
+        {
+            host.defaultInputDevice = index;
+        }
+        if(device.noutputs && host.defaultOutputDevice == paNoDevice)
+        {
+            host.defaultOutputDevice = index;
+        }
+        return index;
+    }
+    
+    static void process(MockState& state, MockStream* stream, const ulong nframes, const PaStreamCallbackFlags flags, void const* inputs, void* outputs, unique_lock<mutex>& guard)
+    {
+        const ulong size = nframes ? nframes : getBufferSize(state, stream);
+        if(!stream->callback)
+        {
+            // The blocking reads wait for the credit, the writes keep the
+            // last buffer.
+            stream->credit += size;
+            stream->flags  |= flags;
+            if(outputs && !stream->outputs.empty())
+            {
+                memcpy(outputs, stream->outputs.data(), min(stream->outputs.size(), ulong(stream->output.channelCount) * size * getSampleSize(stream->output.sampleFormat)));
+            }
+            state.condition.notify_all();
+            return;
+        }
+        
+        const bool planar = (stream->output.sampleFormat & paNonInterleaved) != 0;
+        prepare(stream->inputs, stream->channels_ins, stream->input, size);
+        prepare(stream->outputs, stream->channels_outs, stream->output, size);
+        if(inputs)
+        {
+            if(planar)
+            {
+                const ulong bytes = size * getSampleSize(stream->input.sampleFormat);
+                for(ulong i = 0; i < stream->channels_ins.size(); i++)
+                {
+                    memcpy(stream->channels_ins[i], ((void const* const*)inputs)[i], bytes);
+                }
+            }
+            else
+            {
+                memcpy(stream->inputs.data(), inputs, stream->inputs.size());
+            }
+        }
+        PaStreamCallbackTimeInfo time;
+        time.inputBufferAdcTime     = stream->time - stream->info.inputLatency;
+        time.currentTime            = stream->time;
+        time.outputBufferDacTime    = stream->time + stream->info.outputLatency;
+        stream->time += double(size) / stream->samplerate;
+        state.nbuffers++;
+        guard.unlock();
+        
+        void const* ins = stream->input.channelCount ? (planar ? (void const*)stream->channels_ins.data() : (void const*)stream->inputs.data()) : nullptr;
+        void* outs = stream->output.channelCount ? (planar ? (void*)stream->channels_outs.data() : (void*)stream->outputs.data()) : nullptr;
+        const int result = stream->callback(ins, outs, size, &time, flags, stream->userData);
+        
+        if(outputs)
+        {
+            if(planar)
+            {
+                const ulong bytes = size * getSampleSize(stream->output.sampleFormat);
+                for(ulong i = 0; i < stream->channels_outs.size(); i++)
+                {
+                    memcpy(((void* const*)outputs)[i], stream->channels_outs[i], bytes);
+                }
+            }
+            else
+            {
+                memcpy(outputs, stream->outputs.data(), stream->outputs.size());
+            }
+        }
+        guard.lock();
+        if(result != paContinue)
+        {
+            stream->active = false;
+        }
+    }
+    
+    bool DspPortAudioMock::step(const ulong nframes, const PaStreamCallbackFlags flags, void const* inputs, void* outputs)
+    {
+        MockState& state = getState();
+        lock_guard<mutex> lock(state.processing);
+        unique_lock<mutex> guard(state.guard);
+        MockStream* primary = getActiveStream(state);
+        if(!primary)
+        {
+            return false;
+        }
+        
+        // The devices run in parallel, the buffers are given to the last
+        // stream started.
+        vector<MockStream*> streams;
+        for(auto stream : state.streams)
+        {
+            if(stream->active)
+            {
+                streams.push_back(stream);
+            }
+        }
+        for(auto stream : streams)
+        {
+            process(state, stream, nframes, flags, stream == primary ? inputs : nullptr, stream == primary ? outputs : nullptr, guard);
+        }
+        return true;
+    }
+    
+    ulong DspPortAudioMock::play(vector<Step> const& script)
+    {
+        ulong nsteps = 0;
+        chrono::steady_clock::time_point next = chrono::steady_clock::now();
+        for(auto const& step : script)
+        {
+            if(step.interval > 0.)
+            {
+                next += chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(step.interval));
+                this_thread::sleep_until(next);
+            }
+            else
+            {
+                next = chrono::steady_clock::now();
+            }
+            if(!DspPortAudioMock::step(step.nframes, step.flags))
+            {
+                break;
+            }
+            nsteps++;
+        }
+        return nsteps;
+    }
+    
+    bool DspPortAudioMock::isStreamActive()
+    {
+        MockState& state = getState();
+        lock_guard<mutex> guard(state.guard);
+        return getActiveStream(state) != nullptr;
+    }
+    
+    bool DspPortAudioMock::getStreamParameters(PaStreamParameters& input, PaStreamParameters& output, double& samplerate, ulong& framesPerBuffer)
+    {
+        MockState& state = getState();
+        lock_guard<mutex> guard(state.guard);
+        MockStream const* stream = getActiveStream(state);
+        if(stream)
+        {
+            input           = stream->input;
+            output          = stream->output;
+            samplerate      = stream->samplerate;
+            framesPerBuffer = stream->framesPerBuffer;
+        }
+        return stream != nullptr;
+    }
+    
+    PaStreamFlags DspPortAudioMock::getStreamFlags()
+    {
+        MockState& state = getState();
+        lock_guard<mutex> guard(state.guard);
+        MockStream const* stream = getActiveStream(state);
+        return stream ? stream->streamFlags : paNoFlag;
+    }
+    
+    ulong DspPortAudioMock::getNumberOfOpens()
+    {
+        MockState& state = getState();
+        lock_guard<mutex> guard(state.guard);
+        return state.nopens;
+    }
+    
+    ulong DspPortAudioMock::getNumberOfStreams()
+    {
+        MockState& state = getState();
+        lock_guard<mutex> guard(state.guard);
+        return state.streams.size();
+    }
+    
+    ulong DspPortAudioMock::getNumberOfBuffers()
+    {
+        MockState& state = getState();
+        lock_guard<mutex> guard(state.guard);
+        return state.nbuffers;
+    }
+}
+
+using namespace Kiwi;
+
+extern "C"
+{
+    PaError Pa_Initialize(void)
+    {
+        MockState& state = getState();
+        if(!state.ninits++)
+        {
+            bool empty;
+            {
+                lock_guard<mutex> guard(state.guard);
+                empty = state.drivers.empty();
+            }
+            if(empty)
+            {
+                const PaHostApiIndex driver = DspPortAudioMock::addDriver("Mock");
+                DspPortAudioMock::addDevice(driver, {"Mock Device", 2, 2, {44100, 48000, 88200, 96000}, paFloat32 | paInt32 | paInt24 | paInt16, 256, 0.005});
+            }
+        }
+        return paNoError;
+    }
+    
+    PaError Pa_Terminate(void)
+    {
+        MockState& state = getState();
+        if(!state.ninits)
+        {
+            return paNotInitialized;
+        }
+        state.ninits--;
+        return paNoError;
+    }
+    
+    const char* Pa_GetErrorText(PaError errorCode)
+    {
+        switch(errorCode)
+        {
+            case paNoError:                             return "Success";
+            case paNotInitialized:                      return "PortAudio not initialized";
+            case paInvalidChannelCount:                 return "Invalid number of channels";
+            case paInvalidSampleRate:                   return "Invalid sample rate";
+            case paInvalidDevice:                       return "Invalid device";
+            case paSampleFormatNotSupported:            return "Sample format not supported";
+            case paBadStreamPtr:                        return "Invalid stream pointer";
+            case paTimedOut:                            return "Wait timed out";
+            case paStreamIsStopped:                     return "Stream is stopped";
+            case paStreamIsNotStopped:                  return "Stream is not stopped";
+            case paInputOverflowed:                     return "Input overflowed";
+            case paOutputUnderflowed:                   return "Output underflowed";
+            case paInvalidHostApi:                      return "Invalid host API";
+            case paCanNotReadFromACallbackStream:       return "Can't read from a callback stream";
+            case paCanNotWriteToACallbackStream:        return "Can't write to a callback stream";
+            case paCanNotReadFromAnOutputOnlyStream:    return "Can't read from an output only stream";
+            case paCanNotWriteToAnInputOnlyStream:      return "Can't write to an input only stream";
+            default:                                    return "Illegal error number";
+        }
+    }
+    
+    PaHostApiIndex Pa_GetHostApiCount(void)
+    {
+        MockState& state = getState();
+        lock_guard<mutex> guard(state.guard);
+        return PaHostApiIndex(state.drivers.size());
+    }
+    
+    PaHostApiIndex Pa_GetDefaultHostApi(void)
+    {
+        MockState& state = getState();
+        lock_guard<mutex> guard(state.guard);
+        return state.drivers.empty() ? paHostApiNotFound : 0;
+    }
+    
+    const PaHostApiInfo* Pa_GetHostApiInfo(PaHostApiIndex hostApi)
+    {
+        MockState& state = getState();
+        lock_guard<mutex> guard(state.guard);
+        return (hostApi >= 0 && hostApi < PaHostApiIndex(state.drivers.size())) ? &state.drivers[hostApi] : nullptr;
+    }
+    
+    PaDeviceIndex Pa_HostApiDeviceIndexToDeviceIndex(PaHostApiIndex hostApi, int hostApiDeviceIndex)
+    {
+        MockState& state = getState();
+        lock_guard<mutex> guard(state.guard);
+        if(hostApi < 0 || hostApi >= PaHostApiIndex(state.drivers.size()))
+        {
+            return paInvalidHostApi;
+        }
+        for(PaDeviceIndex i = 0; i < PaDeviceIndex(state.devices.size()); i++)
+        {
+            if(state.devices[i].hostApi == hostApi && !hostApiDeviceIndex--)
+            {
+                return i;
+            }
+        }
+        return paInvalidDevice;
+    }
+    
+    PaDeviceIndex Pa_GetDeviceCount(void)
+    {
+        MockState& state = getState();
+        lock_guard<mutex> guard(state.guard);
+        return PaDeviceIndex(state.devices.size());
+    }
+    
+    PaDeviceIndex Pa_GetDefaultInputDevice(void)
+    {
+        MockState& state = getState();
+        lock_guard<mutex> guard(state.guard);
+        return state.drivers.empty() ? paNoDevice : state.drivers[0].defaultInputDevice;
+    }
+    
+    PaDeviceIndex Pa_GetDefaultOutputDevice(void)
+    {
+        MockState& state = getState();
+        lock_guard<mutex> guard(state.guard);
+        return state.drivers.empty() ? paNoDevice : state.drivers[0].defaultOutputDevice;
+    }
+    
+    const PaDeviceInfo* Pa_GetDeviceInfo(PaDeviceIndex device)
+    {
+        MockState& state = getState();
+        lock_guard<mutex> guard(state.guard);
+        return (device >= 0 && device < PaDeviceIndex(state.devices.size())) ? &state.devices[device] : nullptr;
+    }
+    
+    PaError Pa_IsFormatSupported(const PaStreamParameters* inputParameters, const PaStreamParameters* outputParameters, double sampleRate)
+    {
+        MockState& state = getState();
+        lock_guard<mutex> guard(state.guard);
+        PaError err = check(state, inputParameters, sampleRate, true);
+        if(err == paNoError)
+        {
+            err = check(state, outputParameters, sampleRate, false);
+        }
+        return err == paNoError ? paFormatIsSupported : err;
+    }
+    
+    PaError Pa_OpenStream(PaStream** stream, const PaStreamParameters* inputParameters, const PaStreamParameters* outputParameters, double sampleRate, unsigned long framesPerBuffer, PaStreamFlags streamFlags, PaStreamCallback* streamCallback, void* userData)
+    {
+        MockState& state = getState();
+        lock_guard<mutex> guard(state.guard);
+        if(!state.ninits)
+        {
+            return paNotInitialized;
+        }
+        if(!stream)
+        {
+            return paBadStreamPtr;
+        }
+        if(!inputParameters && !outputParameters)
+        {
+            return paInvalidDevice;
+        }
+        PaError err = check(state, inputParameters, sampleRate, true);
+        if(err == paNoError)
+        {
+            err = check(state, outputParameters, sampleRate, false);
+        }
+        if(err != paNoError)
+        {
+            return err;
+        }
+        
+        MockStream* mock = new MockStream();
+        mock->input             = inputParameters ? *inputParameters : PaStreamParameters{paNoDevice, 0, paFloat32, 0., nullptr};
+        mock->output            = outputParameters ? *outputParameters : PaStreamParameters{paNoDevice, 0, paFloat32, 0., nullptr};
+        mock->samplerate        = sampleRate;
+        mock->framesPerBuffer   = framesPerBuffer;
+        mock->streamFlags       = streamFlags;
+        mock->callback          = streamCallback;
+        mock->userData          = userData;
+        mock->active            = false;
+        mock->time              = 0.;
+        mock->credit            = 0;
+        mock->flags             = 0;
+        
+        const double buffer = double(getBufferSize(state, mock)) / sampleRate;
+        mock->info.structVersion    = 1;
+        mock->info.inputLatency     = inputParameters ? state.devices[inputParameters->device].defaultLowInputLatency + buffer : 0.;
+        mock->info.outputLatency    = outputParameters ? state.devices[outputParameters->device].defaultLowOutputLatency + buffer : 0.;
+        mock->info.sampleRate       = sampleRate;
+        state.streams.push_back(mock);
+        state.nopens++;
+        *stream = mock;
+        return paNoError;
+    }
+    
+    PaError Pa_CloseStream(PaStream* stream)
+    {
+        MockState& state = getState();
+        lock_guard<mutex> lock(state.processing);
+        lock_guard<mutex> guard(state.guard);
+        auto it = find(state.streams.begin(), state.streams.end(), (MockStream *)stream);
+        if(it == state.streams.end())
+        {
+            return paBadStreamPtr;
+        }
+        delete *it;
+        state.streams.erase(it);
+        state.condition.notify_all();
+        return paNoError;
+    }
+    
+    PaError Pa_StartStream(PaStream* stream)
+    {
+        MockState& state = getState();
+        lock_guard<mutex> guard(state.guard);
+        auto it = find(state.streams.begin(), state.streams.end(), (MockStream *)stream);
+        if(it == state.streams.end())
+        {
+            return paBadStreamPtr;
+        }
+        if((*it)->active)
+        {
+            return paStreamIsNotStopped;
+        }
+        (*it)->active = true;
+        return paNoError;
+    }
+    
+    PaError Pa_StopStream(PaStream* stream)
+    {
+        // Waits for the callback in progress.
+        MockState& state = getState();
+        lock_guard<mutex> lock(state.processing);
+        lock_guard<mutex> guard(state.guard);
+        auto it = find(state.streams.begin(), state.streams.end(), (MockStream *)stream);
+        if(it == state.streams.end())
+        {
+            return paBadStreamPtr;
+        }
+        if(!(*it)->active)
+        {
+            return paStreamIsStopped;
+        }
+        (*it)->active = false;
+        state.condition.notify_all();
+        return paNoError;
+    }
+    
+    PaError Pa_AbortStream(PaStream* stream)
+    {
+        return Pa_StopStream(stream);
+    }
+    
+    PaError Pa_IsStreamStopped(PaStream* stream)
+    {
+        MockState& state = getState();
+        lock_guard<mutex> guard(state.guard);
+        auto it = find(state.streams.begin(), state.streams.end(), (MockStream *)stream);
+        return it == state.streams.end() ? paBadStreamPtr : ((*it)->active ? 0 : 1);
+    }
+    
+    PaError Pa_IsStreamActive(PaStream* stream)
+    {
+        MockState& state = getState();
+        lock_guard<mutex> guard(state.guard);
+        auto it = find(state.streams.begin(), state.streams.end(), (MockStream *)stream);
+        return it == state.streams.end() ? paBadStreamPtr : ((*it)->active ? 1 : 0);
+    }
+    
+    const PaStreamInfo* Pa_GetStreamInfo(PaStream* stream)
+    {
+        MockState& state = getState();
+        lock_guard<mutex> guard(state.guard);
+        auto it = find(state.streams.begin(), state.streams.end(), (MockStream *)stream);
+        return it == state.streams.end() ? nullptr : &(*it)->info;
+    }
+    
+    PaTime Pa_GetStreamTime(PaStream* stream)
+    {
+        MockState& state = getState();
+        lock_guard<mutex> guard(state.guard);
+        auto it = find(state.streams.begin(), state.streams.end(), (MockStream *)stream);
+        return it == state.streams.end() ? 0. : (*it)->time;
+    }
+    
+    PaError Pa_ReadStream(PaStream* stream, void* buffer, unsigned long frames)
+    {
+        MockState& state = getState();
+        unique_lock<mutex> guard(state.guard);
+        auto it = find(state.streams.begin(), state.streams.end(), (MockStream *)stream);
+        if(it == state.streams.end())
+        {
+            return paBadStreamPtr;
+        }
+        MockStream* mock = *it;
+        if(mock->callback)
+        {
+            return paCanNotReadFromACallbackStream;
+        }
+        if(!mock->input.channelCount)
+        {
+            return paCanNotReadFromAnOutputOnlyStream;
+        }
+        
+        // The reader can't wait forever because the manager only checks if
+        // it must stop between two buffers.
+        const bool ready = state.condition.wait_for(guard, chrono::milliseconds(100), [&state, mock, frames]()
+        {
+            return find(state.streams.begin(), state.streams.end(), mock) == state.streams.end() || !mock->active || mock->credit >= frames;
+        });
+        memset(buffer, 0, ulong(mock->input.channelCount) * frames * getSampleSize(mock->input.sampleFormat));
+        if(!ready)
+        {
+            return paTimedOut;
+        }
+        if(find(state.streams.begin(), state.streams.end(), mock) == state.streams.end() || !mock->active)
+        {
+            return paStreamIsStopped;
+        }
+        mock->credit -= frames;
+        mock->time   += double(frames) / mock->samplerate;
+        state.nbuffers++;
+        if(mock->flags & paInputOverflow)
+        {
+            mock->flags &= ~paInputOverflow;
+            return paInputOverflowed;
+        }
+        return paNoError;
+    }
+    
+    PaError Pa_WriteStream(PaStream* stream, const void* buffer, unsigned long frames)
+    {
+        MockState& state = getState();
+        lock_guard<mutex> guard(state.guard);
+        auto it = find(state.streams.begin(), state.streams.end(), (MockStream *)stream);
+        if(it == state.streams.end())
+        {
+            return paBadStreamPtr;
+        }
+        MockStream* mock = *it;
+        if(mock->callback)
+        {
+            return paCanNotWriteToACallbackStream;
+        }
+        if(!mock->output.channelCount)
+        {
+            return paCanNotWriteToAnInputOnlyStream;
+        }
+        const ulong size = ulong(mock->output.channelCount) * frames * getSampleSize(mock->output.sampleFormat);
+        mock->outputs.assign((char const*)buffer, (char const*)buffer + size);
+        if(!mock->input.channelCount)
+        {
+            mock->time += double(frames) / mock->samplerate;
+            state.nbuffers++;
+        }
+        if(mock->flags & paOutputUnderflow)
+        {
+            mock->flags &= ~paOutputUnderflow;
+            return paOutputUnderflowed;
+        }
+        return paNoError;
+    }
+    
+    PaError Pa_GetSampleSize(PaSampleFormat format)
+    {
+        const ulong size = getSampleSize(format);
+        return size ? PaError(size) : paSampleFormatNotSupported;
+    }
+    
+    void Pa_Sleep(long msec)
+    {
+        this_thread::sleep_for(chrono::milliseconds(msec));
+    }
+}
+
+#endif
+
+
@@ -0,0 +1,150 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+ */
+
+#ifdef __KIWI_PORTAUDIO_MOCK__
+
+#ifndef __DEF_KIWI_DSP_PORTAUDIO_MOCK__
+#define __DEF_KIWI_DSP_PORTAUDIO_MOCK__
+
+#include "../KiwiDsp/KiwiDsp.h"
+#include <portaudio.h>
+
+namespace Kiwi
+{
+    // ================================================================================ //
+    //                                  PORTAUDIO MOCK                                  //
+    // ================================================================================ //
+    
+    //! The deterministic stand-in of the PortAudio library.
+    /** The mock implements the functions of PortAudio used by the wrapper and is linked instead of the library, so the device manager can run on machines without audio hardware. It exposes virtual drivers and devices with configurable channels, sample rates and formats. The streams never run by themselves, the calling thread drives them with step() or play() that call the callback of the stream, or feed the blocking reads and writes, with a given number of frames and the xrun flags to report. Without configuration, Pa_Initialize() creates a driver "Mock" with a duplex stereo device.
+     */
+    class DspPortAudioMock
+    {
+    public:
+    
+        //! The description of a virtual device.
+        struct Device
+        {
+            string          name;
+            ulong           ninputs;
+            ulong           noutputs;
+            vector<ulong>   samplerates;
+            PaSampleFormat  formats;
+            ulong           buffersize;
+            double          latency;
+        };
+        
+        //! A step of a script.
+        /** The step processes a number of frames, zero for the buffer size of the stream, with the xrun flags to report. The interval is the time in seconds between the beginning of the previous step and the beginning of this one, zero to play the step immediately.
+         */
+        struct Step
+        {
+            ulong                   nframes;
+            PaStreamCallbackFlags   flags;
+            double                  interval;
+        };
+        
+        //! Reset the mock.
+        /** This function aborts the streams and removes all the drivers and the devices. It must be called while no device manager exists.
+         */
+        static void reset();
+        
+        //! Add a driver.
+        /** This function adds a virtual driver.
+         @param name The name of the driver.
+         @return The index of the driver.
+         */
+        static PaHostApiIndex addDriver(string const& name);
+        
+        //! Add a device.
+        /** This function adds a virtual device to a driver. The first device with inputs and the first device with outputs of a driver are its default devices.
+         @param driver The index of the driver.
+         @param device The description of the device.
+         @return The index of the device or paNoDevice if the driver doesn't exist.
+         */
+        static PaDeviceIndex addDevice(const PaHostApiIndex driver, Device const& device);
+        
+        //! Process a buffer.
+        /** This function calls the callback of each active stream once or, for a blocking stream, makes a buffer available to the reads and the writes. The buffers are exchanged with the last stream started and follow its format, they are silent when they aren't given. For a blocking stream the outputs receive the last buffer written.
+         @param nframes The number of frames or zero for the buffer size of the stream.
+         @param flags The xrun flags to report.
+         @param inputs The input buffer or nullptr.
+         @param outputs The output buffer or nullptr.
+         @return True if a stream was active, otherwise false.
+         */
+        static bool step(const ulong nframes = 0, const PaStreamCallbackFlags flags = 0, void const* inputs = nullptr, void* outputs = nullptr);
+        
+        //! Play a script.
+        /** This function plays the steps of a script at their pace and stops when the script ends or when no stream is active.
+         @param script The steps.
+         @return The number of steps played.
+         */
+        static ulong play(vector<Step> const& script);
+        
+        //! Retrieve if a stream is active.
+        /** This function retrieves if a stream has been started and not stopped.
+         @return True if a stream is active, otherwise false.
+         */
+        static bool isStreamActive();
+        
+        //! Retrieve the parameters of the active stream.
+        /** This function retrieves the parameters the last active stream started has been opened with.
+         @param input The input parameters.
+         @param output The output parameters.
+         @param samplerate The sample rate.
+         @param framesPerBuffer The number of frames per buffer requested.
+         @return True if a stream is active, otherwise false.
+         */
+        static bool getStreamParameters(PaStreamParameters& input, PaStreamParameters& output, double& samplerate, ulong& framesPerBuffer);
+        
+        //! Retrieve the flags of the active stream.
+        /** This function retrieves the flags the last active stream started has been opened with.
+         @return The flags or paNoFlag if no stream is active.
+         */
+        static PaStreamFlags getStreamFlags();
+        
+        //! Retrieve the number of streams opened.
+        /** This function retrieves the number of streams opened since the last reset.
+         @return The number of streams.
+         */
+        static ulong getNumberOfOpens();
+        
+        //! Retrieve the number of streams still open.
+        /** This function retrieves the number of streams opened and not closed yet.
+         @return The number of streams.
+         */
+        static ulong getNumberOfStreams();
+        
+        //! Retrieve the number of buffers processed.
+        /** This function retrieves the number of callbacks and blocking reads since the last reset.
+         @return The number of buffers.
+         */
+        static ulong getNumberOfBuffers();
+    };
+}
+
+#endif
+
+#endif
+
+
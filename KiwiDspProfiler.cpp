@@ -0,0 +1,187 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+*/
+
+#include "KiwiDspProfiler.h"
+
+namespace Kiwi
+{
+    static inline void increment(atomic<uint64_t>& value, const uint64_t amount = 1) noexcept
+    {
+        value.store(value.load(memory_order_relaxed) + amount, memory_order_relaxed);
+    }
+    
+    static inline void maximize(atomic<uint64_t>& value, const uint64_t candidate) noexcept
+    {
+        if(candidate > value.load(memory_order_relaxed))
+        {
+            value.store(candidate, memory_order_relaxed);
+        }
+    }
+    
+    DspProfiler::DspProfiler() noexcept :
+    m_samplerate(44100),
+    m_reset(false),
+    m_previousbudget(0),
+    m_conversion(0),
+    m_filter(0)
+    {
+        clear();
+    }
+    
+    DspProfiler::~DspProfiler()
+    {
+        ;
+    }
+    
+    void DspProfiler::clear() noexcept
+    {
+        m_ncallbacks.store(0, memory_order_relaxed);
+        m_last.store(0, memory_order_relaxed);
+        m_total.store(0, memory_order_relaxed);
+        m_max.store(0, memory_order_relaxed);
+        m_totalbudget.store(0, memory_order_relaxed);
+        m_maxload.store(0, memory_order_relaxed);
+        m_jitter.store(0, memory_order_relaxed);
+        m_nlates.store(0, memory_order_relaxed);
+        for(ulong i = 0; i < 4; i++)
+        {
+            m_nflags[i].store(0, memory_order_relaxed);
+        }
+        for(ulong i = 0; i < histogram_size; i++)
+        {
+            m_histogram[i].store(0, memory_order_relaxed);
+        }
+        m_conversiontotal.store(0, memory_order_relaxed);
+        m_conversionmax.store(0, memory_order_relaxed);
+        m_filtertotal.store(0, memory_order_relaxed);
+        m_filtermax.store(0, memory_order_relaxed);
+        m_previousbudget = 0;
+        m_conversion     = 0;
+        m_filter         = 0;
+    }
+    
+    void DspProfiler::prepare(const ulong samplerate) noexcept
+    {
+        m_samplerate.store(max(samplerate, 1ul));
+        m_reset.store(true);
+    }
+    
+    void DspProfiler::reset() noexcept
+    {
+        m_reset.store(true);
+    }
+    
+    DspProfiler::Statistics DspProfiler::getStatistics() const noexcept
+    {
+        Statistics stats;
+        const uint64_t ncallbacks   = m_ncallbacks.load(memory_order_relaxed);
+        const uint64_t total        = m_total.load(memory_order_relaxed);
+        const uint64_t totalbudget  = m_totalbudget.load(memory_order_relaxed);
+        stats.ncallbacks        = ulong(ncallbacks);
+        stats.lastduration      = double(m_last.load(memory_order_relaxed)) * 1e-9;
+        stats.meanduration      = ncallbacks ? double(total) * 1e-9 / double(ncallbacks) : 0.;
+        stats.maxduration       = double(m_max.load(memory_order_relaxed)) * 1e-9;
+        stats.meanload          = totalbudget ? double(total) / double(totalbudget) : 0.;
+        stats.maxload           = double(m_maxload.load(memory_order_relaxed)) * 1e-6;
+        stats.jitter            = double(m_jitter.load(memory_order_relaxed)) * 1e-9;
+        stats.meanconversion    = ncallbacks ? double(m_conversiontotal.load(memory_order_relaxed)) * 1e-9 / double(ncallbacks) : 0.;
+        stats.maxconversion     = double(m_conversionmax.load(memory_order_relaxed)) * 1e-9;
+        stats.meanfilter        = ncallbacks ? double(m_filtertotal.load(memory_order_relaxed)) * 1e-9 / double(ncallbacks) : 0.;
+        stats.maxfilter         = double(m_filtermax.load(memory_order_relaxed)) * 1e-9;
+        stats.nlates            = ulong(m_nlates.load(memory_order_relaxed));
+        stats.ninputunderflows  = ulong(m_nflags[0].load(memory_order_relaxed));
+        stats.ninputoverflows   = ulong(m_nflags[1].load(memory_order_relaxed));
+        stats.noutputunderflows = ulong(m_nflags[2].load(memory_order_relaxed));
+        stats.noutputoverflows  = ulong(m_nflags[3].load(memory_order_relaxed));
+        for(ulong i = 0; i < histogram_size; i++)
+        {
+            stats.histogram[i] = ulong(m_histogram[i].load(memory_order_relaxed));
+        }
+        return stats;
+    }
+    
+    DspProfiler::clock::time_point DspProfiler::begin() noexcept
+    {
+        if(m_reset.load(memory_order_relaxed))
+        {
+            m_reset.store(false, memory_order_relaxed);
+            clear();
+        }
+        return clock::now();
+    }
+    
+    void DspProfiler::addConversion(clock::time_point const& start) noexcept
+    {
+        m_conversion += uint64_t(chrono::duration_cast<chrono::nanoseconds>(clock::now() - start).count());
+    }
+    
+    void DspProfiler::addFilter(clock::time_point const& start) noexcept
+    {
+        m_filter += uint64_t(chrono::duration_cast<chrono::nanoseconds>(clock::now() - start).count());
+    }
+    
+    double DspProfiler::end(clock::time_point const& start, const ulong nsamples, const ulong flags) noexcept
+    {
+        const uint64_t duration = uint64_t(chrono::duration_cast<chrono::nanoseconds>(clock::now() - start).count());
+        const uint64_t budget   = max(uint64_t(nsamples) * uint64_t(1000000000) / m_samplerate.load(memory_order_relaxed), uint64_t(1));
+        const uint64_t load     = duration * uint64_t(1000000) / budget;
+        
+        increment(m_ncallbacks);
+        increment(m_total, duration);
+        increment(m_totalbudget, budget);
+        m_last.store(duration, memory_order_relaxed);
+        maximize(m_max, duration);
+        maximize(m_maxload, load);
+        increment(m_histogram[min(ulong(load / uint64_t(100000)), histogram_size - 1)]);
+        increment(m_conversiontotal, m_conversion);
+        maximize(m_conversionmax, m_conversion);
+        m_conversion = 0;
+        increment(m_filtertotal, m_filter);
+        maximize(m_filtermax, m_filter);
+        m_filter = 0;
+        
+        if(m_previousbudget)
+        {
+            const int64_t period    = chrono::duration_cast<chrono::nanoseconds>(start - m_previous).count();
+            const int64_t deviation = period - int64_t(m_previousbudget);
+            maximize(m_jitter, uint64_t(deviation < 0 ? -deviation : deviation));
+            if(period > int64_t(m_previousbudget * 2))
+            {
+                increment(m_nlates);
+            }
+        }
+        m_previous       = start;
+        m_previousbudget = budget;
+        
+        for(ulong i = 0; i < 4; i++)
+        {
+            if(flags & (1ul << i))
+            {
+                increment(m_nflags[i]);
+            }
+        }
+        return double(load) / 1000000.;
+    }
+}
+
+
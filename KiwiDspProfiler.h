@@ -0,0 +1,161 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+ */
+
+#ifndef __DEF_KIWI_DSP_PROFILER__
+#define __DEF_KIWI_DSP_PROFILER__
+
+#include "../KiwiDsp/KiwiDsp.h"
+
+namespace Kiwi
+{
+    // ================================================================================ //
+    //                                   DSP PROFILER                                   //
+    // ================================================================================ //
+    
+    //! The profiler of the audio callbacks.
+    /** The profiler measures the duration of the callbacks of a device, compares it to the duration of the block and counts the xruns. The audio thread is the only writer and only uses relaxed atomic operations, the control thread can retrieve the statistics or ask for a reset at any time without disturbing it.
+     */
+    class DspProfiler
+    {
+    public:
+        typedef chrono::steady_clock clock;
+        
+        enum Flag : ulong
+        {
+            InputUnderflow  = 1 << 0,
+            InputOverflow   = 1 << 1,
+            OutputUnderflow = 1 << 2,
+            OutputOverflow  = 1 << 3
+        };
+        
+        static const ulong histogram_size = 20;
+        
+        //! The statistics of the profiler.
+        /** The durations are in seconds and the loads are the ratios of the durations of the callbacks to the durations of the blocks. The conversion durations are the parts of the callbacks spent converting the formats of the driver and the filter durations the parts spent upsampling and downsampling the vectors when the dsp is oversampled. The histogram counts the callbacks per load with a resolution of 10%, the last bin counts the callbacks that took more than 190% of the block.
+         */
+        struct Statistics
+        {
+            ulong   ncallbacks;
+            double  lastduration;
+            double  meanduration;
+            double  maxduration;
+            double  meanload;
+            double  maxload;
+            double  jitter;
+            double  meanconversion;
+            double  maxconversion;
+            double  meanfilter;
+            double  maxfilter;
+            ulong   nlates;
+            ulong   ninputunderflows;
+            ulong   ninputoverflows;
+            ulong   noutputunderflows;
+            ulong   noutputoverflows;
+            ulong   histogram[histogram_size];
+        };
+    
+    private:
+        atomic<ulong>       m_samplerate;
+        atomic<bool>        m_reset;
+        atomic<uint64_t>    m_ncallbacks;
+        atomic<uint64_t>    m_last;
+        atomic<uint64_t>    m_total;
+        atomic<uint64_t>    m_max;
+        atomic<uint64_t>    m_totalbudget;
+        atomic<uint64_t>    m_maxload;
+        atomic<uint64_t>    m_jitter;
+        atomic<uint64_t>    m_nlates;
+        atomic<uint64_t>    m_nflags[4];
+        atomic<uint64_t>    m_histogram[histogram_size];
+        atomic<uint64_t>    m_conversiontotal;
+        atomic<uint64_t>    m_conversionmax;
+        atomic<uint64_t>    m_filtertotal;
+        atomic<uint64_t>    m_filtermax;
+        clock::time_point   m_previous;
+        uint64_t            m_previousbudget;
+        uint64_t            m_conversion;
+        uint64_t            m_filter;
+        
+        void clear() noexcept;
+    
+    public:
+    
+        //! Constructor
+        /**
+         */
+        DspProfiler() noexcept;
+        
+        //! Destructor
+        /**
+         */
+        ~DspProfiler();
+        
+        //! Prepare the profiler.
+        /** This function sets the sample rate of the device and resets the statistics. It should be called before the stream starts.
+         @param samplerate The sample rate.
+         */
+        void prepare(const ulong samplerate) noexcept;
+        
+        //! Reset the statistics.
+        /** This function asks the audio thread to reset the statistics at the beginning of the next callback.
+         */
+        void reset() noexcept;
+        
+        //! Retrieve the statistics.
+        /** This function retrieves a snapshot of the statistics.
+         @return The statistics.
+         */
+        Statistics getStatistics() const noexcept;
+        
+        //! Begin the measure of a callback.
+        /** This function must be called by the audio thread at the beginning of the callback.
+         @return The time of the beginning of the callback.
+         */
+        clock::time_point begin() noexcept;
+        
+        //! Add a conversion to the current callback.
+        /** This function must be called by the audio thread after a format conversion, the time elapsed since the start of the conversion is added to the conversion duration of the current callback.
+         @param start The time of the start of the conversion.
+         */
+        void addConversion(clock::time_point const& start) noexcept;
+        
+        //! Add a filter to the current callback.
+        /** This function must be called by the audio thread after an oversampling filter, the time elapsed since the start of the filter is added to the filter duration of the current callback.
+         @param start The time of the start of the filter.
+         */
+        void addFilter(clock::time_point const& start) noexcept;
+        
+        //! End the measure of a callback.
+        /** This function must be called by the audio thread at the end of the callback.
+         @param start The time returned by begin().
+         @param nsamples The number of samples of the block.
+         @param flags The xrun flags reported by the driver.
+         @return The load of the callback.
+         */
+        double end(clock::time_point const& start, const ulong nsamples, const ulong flags) noexcept;
+    };
+}
+
+#endif
+
+
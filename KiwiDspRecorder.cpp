@@ -0,0 +1,310 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+ */
+
+
+#include "KiwiDspRecorder.h"
+
+namespace Kiwi
+{
+    static inline void writeLittleEndian(ofstream& file, const uint64_t value, const ulong nbytes)
+    {
+        for(ulong i = 0; i < nbytes; i++)
+        {
+            file.put(char((value >> (i * 8)) & 0xff));
+        }
+    }
+    
+    // The GUIDs of the chunks of a Wave64 file.
+    static const char w64_riff[16] = {'r', 'i', 'f', 'f', '\x2E', '\x91', '\xCF', '\x11', '\xA5', '\xD6', '\x28', '\xDB', '\x04', '\xC1', '\x00', '\x00'};
+    static const char w64_wave[16] = {'w', 'a', 'v', 'e', '\xF3', '\xAC', '\xD3', '\x11', '\x8C', '\xD1', '\x00', '\xC0', '\x4F', '\x8E', '\xDB', '\x8A'};
+    static const char w64_fmt[16]  = {'f', 'm', 't', ' ', '\xF3', '\xAC', '\xD3', '\x11', '\x8C', '\xD1', '\x00', '\xC0', '\x4F', '\x8E', '\xDB', '\x8A'};
+    static const char w64_data[16] = {'d', 'a', 't', 'a', '\xF3', '\xAC', '\xD3', '\x11', '\x8C', '\xD1', '\x00', '\xC0', '\x4F', '\x8E', '\xDB', '\x8A'};
+    
+    // The largest data chunk of a WAV file.
+    static const uint64_t wave_limit = 0xFFFFFFFFull - 36ull;
+    
+    DspRecorder::DspRecorder() noexcept :
+    m_nchannels(0),
+    m_capacity(0),
+    m_write(0),
+    m_read(0),
+    m_state(Idle),
+    m_draining(false),
+    m_nframes(0),
+    m_noverruns(0),
+    m_ndropped(0),
+    m_format(Wave64),
+    m_samplerate(0),
+    m_nbytes(0)
+    {
+        ;
+    }
+    
+    DspRecorder::~DspRecorder()
+    {
+        stop();
+    }
+    
+    void DspRecorder::cancel() noexcept
+    {
+        // Waits for the audio thread to release the ring buffer.
+        int state = m_state.load();
+        while(state == Processing || !m_state.compare_exchange_weak(state, Idle))
+        {
+            this_thread::yield();
+            state = m_state.load();
+        }
+    }
+    
+    bool DspRecorder::start(string const& path, vector<ulong> const& inputs, vector<ulong> const& outputs, const ulong samplerate, const Format format, const double buffering)
+    {
+        stop();
+        if(inputs.empty() && outputs.empty())
+        {
+            return false;
+        }
+        m_file.open(path.c_str(), ios::binary | ios::trunc);
+        if(!m_file.is_open())
+        {
+            cout << "Recorder error: can't open " << path << endl;
+            return false;
+        }
+        m_inputs        = inputs;
+        m_outputs       = outputs;
+        m_nchannels     = inputs.size() + outputs.size();
+        m_format        = format;
+        m_samplerate    = samplerate;
+        m_nbytes        = 0;
+        // The capacity is a power of two so the positions stay continuous
+        // when the counters wrap.
+        m_capacity      = 8192;
+        while(double(m_capacity) < buffering * double(samplerate))
+        {
+            m_capacity *= 2;
+        }
+        m_ring.assign(m_capacity * m_nchannels, 0.f);
+        m_write.store(0);
+        m_read.store(0);
+        m_nframes.store(0);
+        m_noverruns.store(0);
+        m_ndropped.store(0);
+        m_draining.store(false);
+        writeHeader();
+        m_thread = thread(&DspRecorder::run, this);
+        m_state.store(Running);
+        return true;
+    }
+    
+    void DspRecorder::stop()
+    {
+        cancel();
+        if(m_thread.joinable())
+        {
+            m_draining.store(true);
+            m_thread.join();
+        }
+        if(m_file.is_open())
+        {
+            // The chunks of a Wave64 file are aligned on 8 bytes.
+            if(m_format == Wave64 && (m_nbytes % 8))
+            {
+                writeLittleEndian(m_file, 0, 8 - (m_nbytes % 8));
+            }
+            m_file.seekp(0, ios::beg);
+            writeHeader();
+            m_file.close();
+        }
+        m_ring.clear();
+        m_ring.shrink_to_fit();
+    }
+    
+    DspRecorder::Counters DspRecorder::getCounters() const noexcept
+    {
+        return {m_nframes.load(), m_noverruns.load(), m_ndropped.load()};
+    }
+    
+    void DspRecorder::writeHeader()
+    {
+        const ulong blockalign = m_nchannels * sizeof(float);
+        if(m_format == Wave)
+        {
+            m_file.write("RIFF", 4);
+            writeLittleEndian(m_file, 36 + m_nbytes, 4);
+            m_file.write("WAVE", 4);
+            m_file.write("fmt ", 4);
+            writeLittleEndian(m_file, 16, 4);
+        }
+        else
+        {
+            m_file.write(w64_riff, 16);
+            writeLittleEndian(m_file, 104 + m_nbytes + ((8 - (m_nbytes % 8)) % 8), 8);
+            m_file.write(w64_wave, 16);
+            m_file.write(w64_fmt, 16);
+            writeLittleEndian(m_file, 40, 8);
+        }
+        writeLittleEndian(m_file, 3, 2);
+        writeLittleEndian(m_file, m_nchannels, 2);
+        writeLittleEndian(m_file, m_samplerate, 4);
+        writeLittleEndian(m_file, m_samplerate * blockalign, 4);
+        writeLittleEndian(m_file, blockalign, 2);
+        writeLittleEndian(m_file, 32, 2);
+        if(m_format == Wave)
+        {
+            m_file.write("data", 4);
+            writeLittleEndian(m_file, m_nbytes, 4);
+        }
+        else
+        {
+            m_file.write(w64_data, 16);
+            writeLittleEndian(m_file, 24 + m_nbytes, 8);
+        }
+    }
+    
+    void DspRecorder::run()
+    {
+        const ulong block       = m_capacity / 8;
+        const ulong framesize   = m_nchannels * sizeof(float);
+        for(;;)
+        {
+            const bool draining = m_draining.load();
+            const ulong read    = m_read.load(memory_order_relaxed);
+            const ulong write   = m_write.load(memory_order_acquire);
+            if(write == read || (!draining && write - read < block))
+            {
+                if(draining)
+                {
+                    return;
+                }
+                this_thread::sleep_for(chrono::milliseconds(10));
+                continue;
+            }
+            
+            // The frames are written up to the end of the ring buffer, the
+            // rest is written by the next iteration.
+            const ulong position = read & (m_capacity - 1);
+            const ulong nframes  = min(write - read, m_capacity - position);
+            ulong nwrite = nframes;
+            if(m_format == Wave && m_nbytes + nframes * framesize > wave_limit)
+            {
+                nwrite = (wave_limit - m_nbytes) / framesize;
+                m_ndropped.fetch_add(nframes - nwrite);
+            }
+            if(nwrite && m_file.write((char const*)(m_ring.data() + position * m_nchannels), nwrite * framesize))
+            {
+                m_nbytes += nwrite * framesize;
+                m_nframes.fetch_add(nwrite);
+            }
+            else if(nwrite)
+            {
+                // The disk is full or failing, the frames are lost.
+                m_ndropped.fetch_add(nwrite);
+            }
+            m_read.store(read + nframes, memory_order_release);
+        }
+    }
+    
+    bool DspRecorder::reserve(const ulong nframes, ulong& position) noexcept
+    {
+        int state = Running;
+        if(!m_state.compare_exchange_strong(state, Processing, memory_order_acquire))
+        {
+            // Another callback is recording, during the switch of a device.
+            if(state == Processing)
+            {
+                m_noverruns.fetch_add(1, memory_order_relaxed);
+                m_ndropped.fetch_add(nframes, memory_order_relaxed);
+            }
+            return false;
+        }
+        const ulong write = m_write.load(memory_order_relaxed);
+        if(m_capacity - (write - m_read.load(memory_order_acquire)) < nframes)
+        {
+            m_noverruns.fetch_add(1, memory_order_relaxed);
+            m_ndropped.fetch_add(nframes, memory_order_relaxed);
+            m_state.store(Running, memory_order_release);
+            return false;
+        }
+        position = write & (m_capacity - 1);
+        return true;
+    }
+    
+    void DspRecorder::commit(const ulong nframes) noexcept
+    {
+        m_write.store(m_write.load(memory_order_relaxed) + nframes, memory_order_release);
+        m_state.store(Running, memory_order_release);
+    }
+    
+    void DspRecorder::process(const ulong nframes, float const* inputs, const ulong nins, float const* outputs, const ulong nouts) noexcept
+    {
+        ulong position;
+        if(!reserve(nframes, position))
+        {
+            return;
+        }
+        for(ulong i = 0; i < nframes; i++)
+        {
+            float* frame = m_ring.data() + position * m_nchannels;
+            for(ulong j = 0; j < m_inputs.size(); j++)
+            {
+                *frame++ = inputs && m_inputs[j] < nins ? inputs[i * nins + m_inputs[j]] : 0.f;
+            }
+            for(ulong j = 0; j < m_outputs.size(); j++)
+            {
+                *frame++ = outputs && m_outputs[j] < nouts ? outputs[i * nouts + m_outputs[j]] : 0.f;
+            }
+            if(++position == m_capacity)
+            {
+                position = 0;
+            }
+        }
+        commit(nframes);
+    }
+    
+    void DspRecorder::process(const ulong nframes, float const* const* inputs, const ulong nins, float const* const* outputs, const ulong nouts) noexcept
+    {
+        ulong position;
+        if(!reserve(nframes, position))
+        {
+            return;
+        }
+        for(ulong i = 0; i < nframes; i++)
+        {
+            float* frame = m_ring.data() + position * m_nchannels;
+            for(ulong j = 0; j < m_inputs.size(); j++)
+            {
+                *frame++ = m_inputs[j] < nins && inputs[m_inputs[j]] ? inputs[m_inputs[j]][i] : 0.f;
+            }
+            for(ulong j = 0; j < m_outputs.size(); j++)
+            {
+                *frame++ = m_outputs[j] < nouts && outputs[m_outputs[j]] ? outputs[m_outputs[j]][i] : 0.f;
+            }
+            if(++position == m_capacity)
+            {
+                position = 0;
+            }
+        }
+        commit(nframes);
+    }
+}
+
+
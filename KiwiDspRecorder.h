@@ -0,0 +1,177 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+ */
+
+
+#ifndef __DEF_KIWI_DSP_RECORDER__
+#define __DEF_KIWI_DSP_RECORDER__
+
+#include "../KiwiDsp/KiwiDsp.h"
+#include <fstream>
+
+namespace Kiwi
+{
+    // ================================================================================ //
+    //                                  DSP RECORDER                                    //
+    // ================================================================================ //
+    
+    //! The recording tap of a device.
+    /** The recorder copies selected input and output channels of the device to a ring buffer from the audio thread, and a writer thread streams the ring buffer to a 32 bits float WAV or Wave64 file. The audio thread never waits for the disk and never allocates: when the ring buffer is full, the buffer is dropped and counted as an overrun. The writer drains the ring buffer by large blocks so the file is written sequentially. The control thread starts and stops the recording, the header of the file is completed when the recording stops.
+     */
+    class DspRecorder
+    {
+    public:
+        enum Format
+        {
+            Wave        = 0,
+            Wave64      = 1
+        };
+        
+        //! The counters of a recording.
+        struct Counters
+        {
+            ulong   nframes;
+            ulong   noverruns;
+            ulong   ndropped;
+        };
+    
+    private:
+        enum State
+        {
+            Idle        = 0,
+            Running     = 1,
+            Processing  = 2
+        };
+        
+        vector<ulong>   m_inputs;
+        vector<ulong>   m_outputs;
+        ulong           m_nchannels;
+        vector<float>   m_ring;
+        ulong           m_capacity;
+        atomic<ulong>   m_write;
+        atomic<ulong>   m_read;
+        atomic<int>     m_state;
+        atomic<bool>    m_draining;
+        atomic<ulong>   m_nframes;
+        atomic<ulong>   m_noverruns;
+        atomic<ulong>   m_ndropped;
+        ofstream        m_file;
+        Format          m_format;
+        ulong           m_samplerate;
+        uint64_t        m_nbytes;
+        thread          m_thread;
+        
+        void cancel() noexcept;
+        
+        //! Write the header of the file.
+        /** This function writes the header of the file at the current position with the current size of the data.
+         */
+        void writeHeader();
+        
+        //! Stream the ring buffer to the file.
+        /** This function is the loop of the writer thread. It writes the frames of the ring buffer by blocks of an eighth of the ring buffer and returns when the recording is stopped and the ring buffer is empty.
+         */
+        void run();
+        
+        //! Reserve room in the ring buffer.
+        /** This function locks the tap for the audio thread and checks that the ring buffer has room for the frames. The buffer is dropped and counted otherwise.
+         @param nframes The number of frames.
+         @param position The first frame of the room in the ring buffer.
+         @return True if the frames can be copied, otherwise false.
+         */
+        bool reserve(const ulong nframes, ulong& position) noexcept;
+        
+        //! Publish the frames copied to the ring buffer.
+        /** This function hands the frames over to the writer thread and unlocks the tap.
+         @param nframes The number of frames.
+         */
+        void commit(const ulong nframes) noexcept;
+    
+    public:
+    
+        //! Constructor
+        /**
+         */
+        DspRecorder() noexcept;
+        
+        //! Destructor
+        /** The destructor stops the recording.
+         */
+        ~DspRecorder();
+        
+        //! Start a recording.
+        /** This function stops the current recording, opens the file, allocates the ring buffer and starts the writer thread. It must be called by the control thread.
+         @param path The path of the file.
+         @param inputs The indices of the input channels to record.
+         @param outputs The indices of the output channels to record, written after the inputs.
+         @param samplerate The sample rate of the device.
+         @param format The format of the file, Wave64 has no size limit, Wave stops at 4 GB.
+         @param buffering The duration of the ring buffer in seconds.
+         @return True if the recording has started, false if the file can't be opened or there is no channel.
+         */
+        bool start(string const& path, vector<ulong> const& inputs, vector<ulong> const& outputs, const ulong samplerate, const Format format = Wave64, const double buffering = 2.);
+        
+        //! Stop the recording.
+        /** This function stops the tap, waits for the writer thread to write the ring buffer then completes and closes the file. It must be called by the control thread.
+         */
+        void stop();
+        
+        //! Retrieve the counters of the recording.
+        /** This function retrieves the number of frames written to the file, the number of buffers dropped because the ring buffer was full and the number of frames they held. The counters are kept after the recording stops.
+         @return The counters.
+         */
+        Counters getCounters() const noexcept;
+        
+        //! Record an interleaved buffer.
+        /** This function copies the selected channels of the buffers to the ring buffer. It must be called by the audio thread after the tick. It does nothing if no recording is running. The channels that the buffers don't have are silent.
+         @param nframes The number of frames.
+         @param inputs The interleaved input buffer or nullptr.
+         @param nins The number of channels of the input buffer.
+         @param outputs The interleaved output buffer or nullptr.
+         @param nouts The number of channels of the output buffer.
+         */
+        void process(const ulong nframes, float const* inputs, const ulong nins, float const* outputs, const ulong nouts) noexcept;
+        
+        //! Record buffers per channel.
+        /** This function copies the selected channels of the buffers to the ring buffer. It must be called by the audio thread after the tick. It does nothing if no recording is running. The channels that the buffers don't have are silent.
+         @param nframes The number of frames.
+         @param inputs The input buffers.
+         @param nins The number of input buffers.
+         @param outputs The output buffers.
+         @param nouts The number of output buffers.
+         */
+        void process(const ulong nframes, float const* const* inputs, const ulong nins, float const* const* outputs, const ulong nouts) noexcept;
+        
+        //! Retrieve if a recording is running.
+        /** This function retrieves if the audio thread must call process().
+         @return True if a recording is running, otherwise false.
+         */
+        inline bool isRunning() const noexcept
+        {
+            return m_state.load(memory_order_acquire) != Idle;
+        }
+    };
+}
+
+#endif
+
+
@@ -0,0 +1,193 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+*/
+
+
+#include "KiwiDspResampler.h"
+
+namespace Kiwi
+{
+    //! The modified Bessel function of the first kind of order zero.
+    static double bessel(const double x) noexcept
+    {
+        double sum = 1., term = 1.;
+        for(ulong k = 1; term > sum * 1e-12; k++)
+        {
+            const double factor = x / (2. * double(k));
+            term *= factor * factor;
+            sum  += term;
+        }
+        return sum;
+    }
+    
+    DspResampler::DspResampler(const ulong nchannels, const ulong inrate, const ulong outrate, const Quality quality, const ulong maxinputs) :
+    m_nchannels(nchannels),
+    m_inrate(max(inrate, 1ul)),
+    m_outrate(max(outrate, 1ul))
+    {
+        ulong a = m_inrate, b = m_outrate;
+        while(b)
+        {
+            const ulong r = a % b;
+            a = b;
+            b = r;
+        }
+        m_inrate  /= a;
+        m_outrate /= a;
+        
+        // The cutoff follows the lowest rate, the filter is widened when it
+        // decimates so it keeps the same number of zero crossings.
+        const double pi         = 3.14159265358979323846;
+        const double ratio      = min(double(m_outrate) / double(m_inrate), 1.);
+        const double rolloff    = quality == High ? 0.94 : 0.85;
+        const double beta       = quality == High ? 9. : 5.;
+        const double cutoff     = ratio * rolloff;
+        m_half      = ulong(ceil(double(quality == High ? 24 : 4) / ratio));
+        m_nphases   = quality == High ? 512 : 64;
+        
+        const ulong ntaps = 2 * m_half;
+        m_table.resize((m_nphases + 1) * ntaps);
+        for(ulong p = 0; p <= m_nphases; p++)
+        {
+            float* row  = m_table.data() + p * ntaps;
+            double sum  = 0.;
+            vector<double> taps(ntaps);
+            for(ulong k = 0; k < ntaps; k++)
+            {
+                const double offset = double(p) / double(m_nphases) + double(m_half) - 1. - double(k);
+                const double x      = offset / double(m_half);
+                const double window = x * x < 1. ? bessel(beta * sqrt(1. - x * x)) / bessel(beta) : 0.;
+                const double arg    = pi * cutoff * offset;
+                taps[k] = (arg != 0. ? sin(arg) / arg : 1.) * window;
+                sum += taps[k];
+            }
+            for(ulong k = 0; k < ntaps; k++)
+            {
+                row[k] = float(taps[k] / sum);
+            }
+        }
+        m_coefficients.assign(ntaps, 0.f);
+        m_capacity = maxinputs + 4 * m_half + 2;
+        m_history.assign(m_nchannels * m_capacity, 0.f);
+        clear();
+    }
+    
+    DspResampler::~DspResampler()
+    {
+        ;
+    }
+    
+    void DspResampler::clear() noexcept
+    {
+        fill(m_history.begin(), m_history.end(), 0.f);
+        m_count     = m_half;
+        m_time      = m_half - 1;
+        m_fraction  = 0;
+    }
+    
+    ulong DspResampler::getMaximumOutput(const ulong ninputs) const noexcept
+    {
+        return ulong((uint64_t(ninputs) * uint64_t(m_outrate) + uint64_t(m_inrate) - 1) / uint64_t(m_inrate)) + 1;
+    }
+    
+    ulong DspResampler::getRequiredInput(const ulong noutputs) const noexcept
+    {
+        if(!noutputs)
+        {
+            return 0;
+        }
+        const uint64_t last = uint64_t(m_time) + (uint64_t(m_fraction) + uint64_t(noutputs - 1) * uint64_t(m_inrate)) / uint64_t(m_outrate);
+        const uint64_t need = last + m_half + 1;
+        return need > m_count ? ulong(need - m_count) : 0ul;
+    }
+    
+    ulong DspResampler::process(const ulong ninputs, float const* inputs, const ulong maxoutputs, float* outputs) noexcept
+    {
+        const ulong n = min(ninputs, m_capacity - m_count);
+        for(ulong i = 0; i < m_nchannels; i++)
+        {
+            float* history = m_history.data() + i * m_capacity + m_count;
+            for(ulong j = 0; j < n; j++)
+            {
+                history[j] = inputs[j * m_nchannels + i];
+            }
+        }
+        m_count += n;
+        
+        const ulong ntaps   = 2 * m_half;
+        float* coefficients = m_coefficients.data();
+        ulong produced = 0;
+        while(produced < maxoutputs && m_time + m_half < m_count)
+        {
+            const uint64_t position = uint64_t(m_fraction) * uint64_t(m_nphases);
+            const ulong phase       = ulong(position / m_outrate);
+            const float weight      = float(position % m_outrate) / float(m_outrate);
+            float const* low        = m_table.data() + phase * ntaps;
+            float const* high       = low + ntaps;
+            for(ulong k = 0; k < ntaps; k++)
+            {
+                coefficients[k] = low[k] + weight * (high[k] - low[k]);
+            }
+            
+            const ulong first = m_time + 1 - m_half;
+            for(ulong i = 0; i < m_nchannels; i++)
+            {
+                // Four partial sums break the dependency between the
+                // products so they can be vectorized without reordering.
+                float const* history = m_history.data() + i * m_capacity + first;
+                float sum[4] = {0.f, 0.f, 0.f, 0.f};
+                ulong k = 0;
+                for(; k + 4 <= ntaps; k += 4)
+                {
+                    sum[0] += history[k] * coefficients[k];
+                    sum[1] += history[k + 1] * coefficients[k + 1];
+                    sum[2] += history[k + 2] * coefficients[k + 2];
+                    sum[3] += history[k + 3] * coefficients[k + 3];
+                }
+                for(; k < ntaps; k++)
+                {
+                    sum[k & 3] += history[k] * coefficients[k];
+                }
+                outputs[produced * m_nchannels + i] = (sum[0] + sum[1]) + (sum[2] + sum[3]);
+            }
+            produced++;
+            m_fraction += m_inrate;
+            m_time     += m_fraction / m_outrate;
+            m_fraction %= m_outrate;
+        }
+        
+        // The history keeps the frames the next output still needs.
+        const ulong shift = min(m_time + 1 - m_half, m_count);
+        if(shift)
+        {
+            for(ulong i = 0; i < m_nchannels; i++)
+            {
+                float* history = m_history.data() + i * m_capacity;
+                copy(history + shift, history + m_count, history);
+            }
+            m_count -= shift;
+            m_time  -= shift;
+        }
+        return produced;
+    }
+}
+
@@ -0,0 +1,121 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+ */
+
+
+#ifndef __DEF_KIWI_DSP_RESAMPLER__
+#define __DEF_KIWI_DSP_RESAMPLER__
+
+#include "../KiwiDsp/KiwiDsp.h"
+
+namespace Kiwi
+{
+    // ================================================================================ //
+    //                                   DSP RESAMPLER                                  //
+    // ================================================================================ //
+    
+    //! The streaming sample rate converter between a device and the dsp.
+    /** The resampler converts interleaved float frames from one rate to another with a windowed sinc filter. The filter is tabulated for a number of fractional positions and interpolated between them, the coefficients are computed once per output frame and shared by the channels, the history of each channel is contiguous and the products are accumulated in four partial sums so the compiler can vectorize them. The ratio is kept as a fraction of the two rates so the position never drifts. The fast quality uses a short filter with a low latency, the high quality a long filter with a steep transition band. The memory is allocated by the constructor so process() can be called from the audio thread.
+     */
+    class DspResampler
+    {
+    public:
+        enum Quality
+        {
+            Fast    = 0,
+            High    = 1
+        };
+    
+    private:
+        const ulong     m_nchannels;
+        ulong           m_inrate;
+        ulong           m_outrate;
+        ulong           m_half;
+        ulong           m_nphases;
+        ulong           m_capacity;
+        vector<float>   m_table;
+        vector<float>   m_coefficients;
+        vector<float>   m_history;
+        ulong           m_count;
+        ulong           m_time;
+        ulong           m_fraction;
+    
+    public:
+    
+        //! Constructor
+        /** The constructor designs the filter and allocates the history of the channels.
+         @param nchannels The number of channels.
+         @param inrate The sample rate of the input.
+         @param outrate The sample rate of the output.
+         @param quality The quality.
+         @param maxinputs The maximum number of frames of an input buffer, without the frames of the filter.
+         */
+        DspResampler(const ulong nchannels, const ulong inrate, const ulong outrate, const Quality quality, const ulong maxinputs);
+        
+        //! Destructor
+        /**
+         */
+        ~DspResampler();
+        
+        //! Clear the history.
+        /** This function clears the history of the channels and restarts the position.
+         */
+        void clear() noexcept;
+        
+        //! Retrieve the latency.
+        /** This function retrieves the number of input frames the filter looks ahead.
+         @return The latency in frames at the input rate.
+         */
+        inline ulong getLatency() const noexcept
+        {
+            return m_half;
+        }
+        
+        //! Retrieve the maximum number of output frames.
+        /** This function retrieves the maximum number of frames that an input buffer can produce.
+         @param ninputs The number of input frames.
+         @return The number of output frames.
+         */
+        ulong getMaximumOutput(const ulong ninputs) const noexcept;
+        
+        //! Retrieve the number of input frames required.
+        /** This function retrieves the number of input frames process() needs to produce exactly a number of output frames.
+         @param noutputs The number of output frames.
+         @return The number of input frames.
+         */
+        ulong getRequiredInput(const ulong noutputs) const noexcept;
+        
+        //! Convert a buffer.
+        /** This function appends an interleaved buffer to the history of the channels then produces the output frames the history allows, up to a maximum. The frames that couldn't be produced are produced by the next call.
+         @param ninputs The number of input frames.
+         @param inputs The interleaved input buffer.
+         @param maxoutputs The maximum number of output frames.
+         @param outputs The interleaved output buffer.
+         @return The number of output frames produced.
+         */
+        ulong process(const ulong ninputs, float const* inputs, const ulong maxoutputs, float* outputs) noexcept;
+    };
+}
+
+#endif
+
+
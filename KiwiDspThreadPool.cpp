@@ -0,0 +1,209 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+*/
+
+#include "KiwiDspThreadPool.h"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#define __KIWI_PAUSE__() _mm_pause()
+#else
+#define __KIWI_PAUSE__()
+#endif
+
+namespace Kiwi
+{
+    static inline void pause(ulong& spins) noexcept
+    {
+        if(++spins & 0xff)
+        {
+            __KIWI_PAUSE__();
+        }
+        else
+        {
+            this_thread::yield();
+        }
+    }
+    
+    void DspThreadPool::setRealTime(thread& worker, const ulong core) noexcept
+    {
+#if defined(__linux__)
+        // The number of cores is zero when it isn't known.
+        const unsigned ncores = max(thread::hardware_concurrency(), 1u);
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(int(core % ncores), &cpus);
+        pthread_setaffinity_np(worker.native_handle(), sizeof(cpu_set_t), &cpus);
+        sched_param param;
+        param.sched_priority = sched_get_priority_max(SCHED_FIFO) - 1;
+        pthread_setschedparam(worker.native_handle(), SCHED_FIFO, &param);
+#elif defined(_WIN32)
+        const unsigned ncores = max(thread::hardware_concurrency(), 1u);
+        SetThreadAffinityMask(worker.native_handle(), DWORD_PTR(1) << (core % ncores));
+        SetThreadPriority(worker.native_handle(), THREAD_PRIORITY_TIME_CRITICAL);
+#endif
+    }
+    
+    DspThreadPool::DspThreadPool(const ulong nthreads) :
+    m_nthreads(max(nthreads, 1ul)),
+    m_slices(new Slice[m_nthreads]),
+    m_running(true),
+    m_generation(0),
+    m_pending(0),
+    m_contexts(nullptr),
+    m_nsleepers(0),
+    m_denormals(false)
+    {
+        for(ulong i = 0; i < m_nthreads; i++)
+        {
+            m_slices[i].next.store(0);
+            m_slices[i].end.store(0);
+        }
+        for(ulong i = 1; i < m_nthreads; i++)
+        {
+            m_threads.push_back(thread(&DspThreadPool::work, this, i));
+            setRealTime(m_threads.back(), i);
+        }
+    }
+    
+    DspThreadPool::~DspThreadPool()
+    {
+        {
+            lock_guard<mutex> guard(m_mutex);
+            m_running.store(false);
+        }
+        m_condition.notify_all();
+        for(auto& worker : m_threads)
+        {
+            worker.join();
+        }
+    }
+    
+    ulong DspThreadPool::getNumberOfThreads() const noexcept
+    {
+        return m_nthreads;
+    }
+    
+    void DspThreadPool::run(const ulong index, const uint64_t generation) noexcept
+    {
+        const uint64_t tag = generation << 32;
+        for(ulong i = 0; i < m_nthreads; i++)
+        {
+            Slice& slice = m_slices[(index + i) % m_nthreads];
+            const uint64_t end = slice.end.load(memory_order_acquire);
+            if((end & ~0xffffffffull) != tag)
+            {
+                return;
+            }
+            uint64_t next = slice.next.load(memory_order_acquire);
+            while((next & ~0xffffffffull) == tag && next < end)
+            {
+                if(slice.next.compare_exchange_weak(next, next + 1, memory_order_acq_rel))
+                {
+                    m_contexts.load(memory_order_acquire)[next & 0xffffffffull]->tick();
+                    m_pending.fetch_sub(1, memory_order_acq_rel);
+                    next = slice.next.load(memory_order_acquire);
+                }
+            }
+        }
+    }
+    
+    void DspThreadPool::work(const ulong index) noexcept
+    {
+        uint64_t generation = 0;
+        ulong spins = 0;
+        while(m_running.load(memory_order_relaxed))
+        {
+            const uint64_t current = m_generation.load(memory_order_acquire);
+            if(current != generation)
+            {
+                generation = current;
+                const DspDenormalsGuard guard(m_denormals.load(memory_order_relaxed));
+                run(index, generation);
+                spins = 0;
+            }
+            else if(spins < 4096)
+            {
+                pause(spins);
+            }
+            else
+            {
+                unique_lock<mutex> lock(m_mutex);
+                m_nsleepers++;
+                m_condition.wait_for(lock, chrono::milliseconds(10), [this, generation]()
+                {
+                    return !m_running.load() || m_generation.load() != generation;
+                });
+                m_nsleepers--;
+                spins = 0;
+            }
+        }
+    }
+    
+    void DspThreadPool::setDenormalsProtection(const bool state) noexcept
+    {
+        m_denormals.store(state, memory_order_relaxed);
+    }
+    
+    void DspThreadPool::process(vector<sDspContext> const& contexts) noexcept
+    {
+        const ulong size = contexts.size();
+        if(m_nthreads == 1 || size < 2)
+        {
+            for(ulong i = 0; i < size; i++)
+            {
+                contexts[i]->tick();
+            }
+            return;
+        }
+        
+        const uint64_t generation = (m_generation.load(memory_order_relaxed) + 1) & 0xffffffffull;
+        const uint64_t tag = generation << 32;
+        m_contexts.store(contexts.data(), memory_order_release);
+        m_pending.store(size, memory_order_release);
+        for(ulong i = 0; i < m_nthreads; i++)
+        {
+            m_slices[i].next.store(tag | (size * i / m_nthreads), memory_order_release);
+            m_slices[i].end.store(tag | (size * (i + 1) / m_nthreads), memory_order_release);
+        }
+        m_generation.store(generation, memory_order_release);
+        if(m_nsleepers.load(memory_order_relaxed))
+        {
+            m_condition.notify_all();
+        }
+        
+        run(0, generation);
+        ulong spins = 0;
+        while(m_pending.load(memory_order_acquire))
+        {
+            pause(spins);
+        }
+    }
+}
+
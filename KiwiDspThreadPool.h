@@ -0,0 +1,107 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+ */
+
+#ifndef __DEF_KIWI_DSP_THREAD_POOL__
+#define __DEF_KIWI_DSP_THREAD_POOL__
+
+#include "../KiwiDsp/KiwiDsp.h"
+#include "KiwiDspDenormals.h"
+
+namespace Kiwi
+{
+    // ================================================================================ //
+    //                                  DSP THREAD POOL                                 //
+    // ================================================================================ //
+    
+    //! The pool of threads that ticks the dsp contexts in parallel.
+    /** The pool owns a set of real-time worker threads pinned to the cores. For each block, the calling thread distributes the contexts in one slice per thread, each thread ticks its own slice then steals the remaining contexts of the other slices, and the calling thread waits on a lock-free barrier until all the contexts have been ticked. The calling thread never waits for an idle worker, a worker that wakes up too late for a block simply finds nothing to steal. The contexts must be independent, they must not share signals nor write the same outputs.
+     */
+    class DspThreadPool
+    {
+    private:
+        struct Slice
+        {
+            atomic<uint64_t>    next;
+            atomic<uint64_t>    end;
+            char                padding[64 - 2 * sizeof(atomic<uint64_t>)];
+        };
+        
+        const ulong                 m_nthreads;
+        unique_ptr<Slice[]>         m_slices;
+        vector<thread>              m_threads;
+        atomic<bool>                m_running;
+        atomic<uint64_t>            m_generation;
+        atomic<ulong>               m_pending;
+        atomic<sDspContext const*>  m_contexts;
+        atomic<ulong>               m_nsleepers;
+        atomic<bool>                m_denormals;
+        mutex                       m_mutex;
+        condition_variable          m_condition;
+        
+        void run(const ulong index, const uint64_t generation) noexcept;
+        
+        void work(const ulong index) noexcept;
+    
+    public:
+    
+        //! Constructor
+        /** The function creates the worker threads. The calling thread takes part in the processing so the pool creates one worker less than the number of threads.
+         @param nthreads The number of threads including the calling thread.
+         */
+        DspThreadPool(const ulong nthreads);
+        
+        //! Destructor
+        /** The function stops and joins the worker threads.
+         */
+        ~DspThreadPool();
+        
+        //! Retrieve the number of threads.
+        /** This function retrieves the number of threads including the calling thread.
+         @return The number of threads.
+         */
+        ulong getNumberOfThreads() const noexcept;
+        
+        //! Tick the contexts.
+        /** This function ticks all the contexts in parallel and returns when all of them have been ticked. It must always be called from the same thread.
+         @param contexts The contexts.
+         */
+        void process(vector<sDspContext> const& contexts) noexcept;
+        
+        //! Set the protection against the denormals.
+        /** This function enables or disables the flush of the denormals on the worker threads while they tick the contexts. The calling thread keeps its own mode.
+         @param state True to enable the protection, false to disable it.
+         */
+        void setDenormalsProtection(const bool state) noexcept;
+        
+        //! Give real-time properties to a thread.
+        /** This function pins a thread to a core and raises its priority to the real-time class of the system when the process is allowed to.
+         @param worker The thread.
+         @param core The index of the core.
+         */
+        static void setRealTime(thread& worker, const ulong core) noexcept;
+    };
+}
+
+#endif
+
+
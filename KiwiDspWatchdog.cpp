@@ -0,0 +1,154 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+*/
+
+#include "KiwiDspWatchdog.h"
+
+namespace Kiwi
+{
+    DspWatchdog::DspWatchdog() noexcept :
+    m_rules(0),
+    m_level(Normal),
+    m_request(None),
+    m_ndegradations(0),
+    m_noverruns(0),
+    m_nrecoveries(0),
+    m_nidles(0)
+    {
+        ;
+    }
+    
+    DspWatchdog::~DspWatchdog()
+    {
+        ;
+    }
+    
+    void DspWatchdog::prepare() noexcept
+    {
+        m_level.store(Normal);
+        m_request.store(None);
+        m_ndegradations.store(0);
+        m_noverruns     = 0;
+        m_nrecoveries   = 0;
+        m_nidles        = 0;
+    }
+    
+    void DspWatchdog::setRules(const ulong rules) noexcept
+    {
+        m_rules.store(rules);
+        if(!(rules & Silence) && getLevel() == Silent)
+        {
+            m_level.store((rules & SkipContexts) ? Reduced : Normal);
+        }
+        if(!(rules & SkipContexts) && getLevel() == Reduced)
+        {
+            m_level.store(Normal);
+        }
+    }
+    
+    ulong DspWatchdog::getRules() const noexcept
+    {
+        return m_rules.load();
+    }
+    
+    ulong DspWatchdog::getNumberOfDegradations() const noexcept
+    {
+        return ulong(m_ndegradations.load());
+    }
+    
+    DspWatchdog::Request DspWatchdog::poll() noexcept
+    {
+        return Request(m_request.exchange(None));
+    }
+    
+    void DspWatchdog::update(const double load) noexcept
+    {
+        const ulong rules = m_rules.load(memory_order_relaxed);
+        if(!rules)
+        {
+            return;
+        }
+        
+        ulong level = m_level.load(memory_order_relaxed);
+        if(load > 1.)
+        {
+            m_nrecoveries   = 0;
+            m_nidles        = 0;
+            if(++m_noverruns >= overruns_limit)
+            {
+                m_noverruns = 0;
+                if(rules & RaiseVectorSize)
+                {
+                    m_request.store(Raise, memory_order_relaxed);
+                }
+                if(level < Reduced && (rules & SkipContexts))
+                {
+                    level = Reduced;
+                }
+                else if(level < Silent && (rules & Silence))
+                {
+                    level = Silent;
+                }
+                else
+                {
+                    return;
+                }
+                m_level.store(level, memory_order_relaxed);
+                m_ndegradations.store(m_ndegradations.load(memory_order_relaxed) + 1, memory_order_relaxed);
+            }
+            return;
+        }
+        
+        m_noverruns = 0;
+        if(load >= 0.5)
+        {
+            m_nrecoveries   = 0;
+            m_nidles        = 0;
+            return;
+        }
+        if(level != Normal)
+        {
+            // A silent device always looks idle, it retries the previous
+            // level after a while and degrades again if it overruns.
+            if(++m_nrecoveries >= recoveries_limit)
+            {
+                m_nrecoveries = 0;
+                level = (level == Silent && (rules & SkipContexts)) ? Reduced : Normal;
+                m_level.store(level, memory_order_relaxed);
+            }
+        }
+        else if((rules & RaiseVectorSize) && load < 0.25)
+        {
+            if(++m_nidles >= recoveries_limit * 4)
+            {
+                m_nidles = 0;
+                m_request.store(Lower, memory_order_relaxed);
+            }
+        }
+        else
+        {
+            m_nidles = 0;
+        }
+    }
+}
+
+
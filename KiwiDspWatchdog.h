@@ -0,0 +1,134 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+ */
+
+#ifndef __DEF_KIWI_DSP_WATCHDOG__
+#define __DEF_KIWI_DSP_WATCHDOG__
+
+#include "../KiwiDsp/KiwiDsp.h"
+
+namespace Kiwi
+{
+    // ================================================================================ //
+    //                                   DSP WATCHDOG                                   //
+    // ================================================================================ //
+    
+    //! The watchdog of the overloads of a device.
+    /** The watchdog follows the loads of the callbacks measured by the profiler and degrades the processing when several consecutive callbacks run past their budget. The rules define the degradations: the device can first skip the non-critical contexts, then output silence instead of ticking the dsp, and it can ask the control thread to raise the vector size. The processing is restored one level at a time when the load stays low, a silent device retries to tick the dsp after a while so it recovers by itself when the cause of the overload disappears. The audio thread updates the watchdog with relaxed atomic operations, the control thread polls the requests of vector size.
+     */
+    class DspWatchdog
+    {
+    public:
+        enum Rule : ulong
+        {
+            SkipContexts    = 1 << 0,
+            Silence         = 1 << 1,
+            RaiseVectorSize = 1 << 2
+        };
+        
+        enum Level : ulong
+        {
+            Normal  = 0,
+            Reduced = 1,
+            Silent  = 2
+        };
+        
+        enum Request : int
+        {
+            Lower   = -1,
+            None    = 0,
+            Raise   = 1
+        };
+        
+        static const ulong overruns_limit   = 3;
+        static const ulong recoveries_limit = 256;
+    
+    private:
+        atomic<ulong>       m_rules;
+        atomic<ulong>       m_level;
+        atomic<int>         m_request;
+        atomic<uint64_t>    m_ndegradations;
+        ulong               m_noverruns;
+        ulong               m_nrecoveries;
+        ulong               m_nidles;
+    
+    public:
+    
+        //! Constructor
+        /**
+         */
+        DspWatchdog() noexcept;
+        
+        //! Destructor
+        /**
+         */
+        ~DspWatchdog();
+        
+        //! Prepare the watchdog.
+        /** This function restores the normal processing and clears the counters and the request. It should be called before the stream starts.
+         */
+        void prepare() noexcept;
+        
+        //! Set the rules.
+        /** This function sets the degradations the watchdog is allowed to apply. Without rules the watchdog does nothing.
+         @param rules The combination of rules.
+         */
+        void setRules(const ulong rules) noexcept;
+        
+        //! Retrieve the rules.
+        /** This function retrieves the degradations the watchdog is allowed to apply.
+         @return The combination of rules.
+         */
+        ulong getRules() const noexcept;
+        
+        //! Retrieve the number of degradations.
+        /** This function retrieves the number of times the watchdog has degraded the processing since the device started.
+         @return The number of degradations.
+         */
+        ulong getNumberOfDegradations() const noexcept;
+        
+        //! Retrieve and clear the request of vector size.
+        /** This function retrieves if the audio thread asked for a larger vector size after an overload or for a smaller one after a long time without overload. It must be called by the control thread.
+         @return The request.
+         */
+        Request poll() noexcept;
+        
+        //! Update the watchdog.
+        /** This function must be called by the audio thread after each callback with the load measured by the profiler.
+         @param load The ratio of the duration of the callback to the duration of the block.
+         */
+        void update(const double load) noexcept;
+        
+        //! Retrieve the level.
+        /** This function retrieves the current degradation of the processing.
+         @return The level.
+         */
+        inline Level getLevel() const noexcept
+        {
+            return Level(m_level.load(memory_order_relaxed));
+        }
+    };
+}
+
+#endif
+
+
@@ -29,12 +29,35 @@ namespace Kiwi
 {
     KiwiJuceDspDeviceManager::KiwiJuceDspDeviceManager() :
     m_driver_name(""),
-    m_input_matrix(nullptr),
-    m_output_matrix(nullptr)
+    m_adapter(false),
+    m_vectorsize(64),
+    m_stride(0),
+    m_changes(0),
+    m_pending(false),
+    m_host_ins(nullptr),
+    m_host_outs(nullptr),
+    m_denormals(true),
+    m_watchdog_buffersize(0),
+    m_seamless(false),
+    m_fade(FadeNone),
+    m_oversampling(1),
+    m_stage_ins(nullptr),
+    m_stage_outs(nullptr),
+    m_stage_stride(0),
+    m_engine_samplerate(0),
+    m_resampler_quality(DspResampler::High),
+    m_chunk(0),
+    m_masked(false)
     {
+        m_capabilities.devices = false;
+        m_capabilities.formats = false;
         m_setup.sampleRate = 44100;
         juce::AudioDeviceManager manager;
         manager.createAudioDeviceTypes(m_drivers);
+        for(int i = 0; i < m_drivers.size(); ++i)
+        {
+            m_drivers.getUnchecked(i)->addListener(this);
+        }
         if(m_drivers.size())
         {
             setDriver(m_drivers[0]->getTypeName().toStdString());
@@ -43,6 +66,11 @@ namespace Kiwi
     
     KiwiJuceDspDeviceManager::~KiwiJuceDspDeviceManager()
     {
+        stopTimer();
+        for(int i = 0; i < m_drivers.size(); ++i)
+        {
+            m_drivers.getUnchecked(i)->removeListener(this);
+        }
         close();
     }
     
@@ -74,32 +102,14 @@ namespace Kiwi
     
     void KiwiJuceDspDeviceManager::getAvailableInputDevices(vector<string>& devices) const
     {
-        devices.clear();
-        juce::AudioIODeviceType* driver = getDriver();
-        if(driver)
-        {
-            driver->scanForDevices();
-            juce::StringArray deviceNames = driver->getDeviceNames(true);
-            for(int j = 0; j < deviceNames.size(); ++j)
-            {
-                devices.push_back(deviceNames[j].toStdString());
-            }
-        }
+        scan();
+        devices = m_capabilities.inputs;
     }
     
     void KiwiJuceDspDeviceManager::getAvailableOutputDevices(vector<string>& devices) const
     {
-        devices.clear();
-        juce::AudioIODeviceType* driver = getDriver();
-        if(driver)
-        {
-            driver->scanForDevices();
-            juce::StringArray deviceNames = driver->getDeviceNames(false);
-            for(int j = 0; j < deviceNames.size(); ++j)
-            {
-                devices.push_back(deviceNames[j].toStdString());
-            }
-        }
+        scan();
+        devices = m_capabilities.outputs;
     }
     
     string KiwiJuceDspDeviceManager::getInputDeviceName() const
@@ -124,15 +134,8 @@ namespace Kiwi
     
     void KiwiJuceDspDeviceManager::getAvailableSampleRates(vector<ulong>& samplerates) const
     {
-        samplerates.clear();
-        if(m_device)
-        {
-            juce::Array<double> array(m_device->getAvailableSampleRates());
-            for(int i = 0; i < array.size(); ++i)
-            {
-                samplerates.push_back((ulong)array[i]);
-            }
-        }
+        scan();
+        samplerates = m_capabilities.samplerates;
     }
     
     ulong KiwiJuceDspDeviceManager::getSampleRate() const
@@ -143,19 +146,23 @@ namespace Kiwi
     void KiwiJuceDspDeviceManager::getAvailableVectorSizes(vector<ulong>& vectorsizes) const
     {
         vectorsizes.clear();
-        if(m_device)
+        if(m_adapter)
         {
-            juce::Array<int> array(m_device->getAvailableBufferSizes());
-            for(int i = 0; i < array.size(); ++i)
+            for(ulong i = 1; i <= 8192; i *= 2)
             {
-                vectorsizes.push_back((ulong)array[i]);
+                vectorsizes.push_back(i);
             }
         }
+        else
+        {
+            scan();
+            vectorsizes = m_capabilities.buffersizes;
+        }
     }
     
     ulong KiwiJuceDspDeviceManager::getVectorSize() const
     {
-        return (ulong)m_setup.bufferSize;
+        return isAdapting() ? m_vectorsize : (ulong)m_setup.bufferSize;
     }
     
     void KiwiJuceDspDeviceManager::setDriver(string const& driver)
@@ -163,7 +170,8 @@ namespace Kiwi
         if(driver != getDriverName() && isDriverAvailable(driver))
         {
             m_driver_name = driver;
-            initialize();
+            m_capabilities.devices = false;
+            restart();
         }
     }
     
@@ -172,7 +180,7 @@ namespace Kiwi
         if(device != getInputDeviceName() && isInputDeviceAvailable(device))
         {
             m_setup.inputDeviceName = juce::String(device);
-            initialize();
+            reroute();
         }
     }
     
@@ -181,33 +189,360 @@ namespace Kiwi
         if(device != getOutputDeviceName() && isOutputDeviceAvailable(device))
         {
             m_setup.outputDeviceName = juce::String(device);
-            initialize();
+            reroute();
         }
     }
     
     void KiwiJuceDspDeviceManager::setSampleRate(ulong const samplerate)
     {
-        if(samplerate != getSampleRate() && isSampleRateAvailable(samplerate))
+        if(samplerate != getSampleRate() && (m_changes || isSampleRateAvailable(samplerate)))
         {
             m_setup.sampleRate = (double)samplerate;
-            initialize();
+            restart();
         }
     }
     
     void KiwiJuceDspDeviceManager::setVectorSize(ulong const vectorsize)
     {
-        if(vectorsize != getVectorSize() && isVectorSizeAvailable(vectorsize))
+        if(vectorsize != getVectorSize() && ((m_changes && !m_adapter) || isVectorSizeAvailable(vectorsize)))
+        {
+            m_watchdog_buffersize = 0;
+            if(m_adapter)
+            {
+                m_vectorsize = vectorsize;
+            }
+            else
+            {
+                m_setup.bufferSize = (int)vectorsize;
+            }
+            restart();
+        }
+    }
+    
+    void KiwiJuceDspDeviceManager::setBufferAdapter(const bool state)
+    {
+        if(state != m_adapter)
+        {
+            if(state)
+            {
+                m_vectorsize = getVectorSize();
+            }
+            else
+            {
+                m_setup.bufferSize = (int)m_vectorsize;
+            }
+            m_adapter = state;
+            restart();
+        }
+    }
+    
+    bool KiwiJuceDspDeviceManager::hasBufferAdapter() const noexcept
+    {
+        return m_adapter;
+    }
+    
+    void KiwiJuceDspDeviceManager::setDenormalsProtection(const bool state) noexcept
+    {
+        m_denormals.store(state);
+    }
+    
+    bool KiwiJuceDspDeviceManager::hasDenormalsProtection() const noexcept
+    {
+        return m_denormals.load();
+    }
+    
+    void KiwiJuceDspDeviceManager::setSeamlessSwitch(const bool state) noexcept
+    {
+        m_seamless = state;
+    }
+    
+    bool KiwiJuceDspDeviceManager::hasSeamlessSwitch() const noexcept
+    {
+        return m_seamless;
+    }
+    
+    void KiwiJuceDspDeviceManager::setOversampling(const ulong ratio)
+    {
+        if(DspOversampler::isRatioValid(ratio) && ratio != m_oversampling)
+        {
+            // The ratio is read when the stream starts, the device is stopped
+            // before it changes and the matrices and the filters are rebuilt
+            // when the stream starts again.
+            const bool playing = m_device && m_device->isPlaying();
+            if(playing)
+            {
+                m_device->stop();
+            }
+            m_oversampling = ratio;
+            if(playing)
+            {
+                m_device->start(this);
+            }
+        }
+    }
+    
+    ulong KiwiJuceDspDeviceManager::getOversampling() const noexcept
+    {
+        return m_oversampling;
+    }
+    
+    ulong KiwiJuceDspDeviceManager::getOversamplingLatency() const noexcept
+    {
+        return DspOversampler::getLatency(m_oversampling);
+    }
+    
+    void KiwiJuceDspDeviceManager::setEngineSampleRate(const ulong samplerate)
+    {
+        if(samplerate != m_engine_samplerate)
+        {
+            // The resamplers are rebuilt when the stream starts again.
+            const bool playing = m_device && m_device->isPlaying();
+            if(playing)
+            {
+                m_device->stop();
+            }
+            m_engine_samplerate = samplerate;
+            if(playing)
+            {
+                m_device->start(this);
+            }
+        }
+    }
+    
+    ulong KiwiJuceDspDeviceManager::getEngineSampleRate() const noexcept
+    {
+        return m_engine_samplerate ? m_engine_samplerate : getSampleRate();
+    }
+    
+    void KiwiJuceDspDeviceManager::setResamplerQuality(const DspResampler::Quality quality)
+    {
+        if(quality != m_resampler_quality)
+        {
+            const bool playing = m_resampler_ins && m_device && m_device->isPlaying();
+            if(playing)
+            {
+                m_device->stop();
+            }
+            m_resampler_quality = quality;
+            if(playing)
+            {
+                m_device->start(this);
+            }
+        }
+    }
+    
+    DspResampler::Quality KiwiJuceDspDeviceManager::getResamplerQuality() const noexcept
+    {
+        return m_resampler_quality;
+    }
+    
+    void KiwiJuceDspDeviceManager::setActiveInputs(vector<bool> const& mask)
+    {
+        if(mask != m_active_ins)
+        {
+            // The audio thread reads the channels opened by the device, the
+            // mask only applies when the device starts again.
+            m_active_ins = mask;
+            restart();
+        }
+    }
+    
+    void KiwiJuceDspDeviceManager::setActiveOutputs(vector<bool> const& mask)
+    {
+        if(mask != m_active_outs)
+        {
+            m_active_outs = mask;
+            restart();
+        }
+    }
+    
+    bool KiwiJuceDspDeviceManager::isInputActive(const ulong channel) const noexcept
+    {
+        return m_active_ins.empty() || (channel < m_active_ins.size() && m_active_ins[channel]);
+    }
+    
+    bool KiwiJuceDspDeviceManager::isOutputActive(const ulong channel) const noexcept
+    {
+        return m_active_outs.empty() || (channel < m_active_outs.size() && m_active_outs[channel]);
+    }
+    
+    void KiwiJuceDspDeviceManager::setWatchdogRules(const ulong rules)
+    {
+        m_watchdog.setRules(rules & ~ulong(DspWatchdog::SkipContexts));
+        if(rules & DspWatchdog::RaiseVectorSize)
+        {
+            startTimer(100);
+        }
+        else
+        {
+            stopTimer();
+        }
+    }
+    
+    ulong KiwiJuceDspDeviceManager::getWatchdogRules() const noexcept
+    {
+        return m_watchdog.getRules();
+    }
+    
+    DspWatchdog::Level KiwiJuceDspDeviceManager::getWatchdogLevel() const noexcept
+    {
+        return m_watchdog.getLevel();
+    }
+    
+    void KiwiJuceDspDeviceManager::timerCallback()
+    {
+        const DspWatchdog::Request request = m_watchdog.poll();
+        if(request == DspWatchdog::None || !m_device)
+        {
+            return;
+        }
+        
+        // Only the buffers of the device change, the fifos keep ticking the
+        // dsp with the vector size it has been compiled for.
+        scan();
+        vector<ulong> const& buffersizes = m_capabilities.buffersizes;
+        const ulong vectorsize  = getVectorSize();
+        const ulong original    = m_adapter ? ulong(m_device->getDefaultBufferSize()) : vectorsize;
+        const ulong current     = ulong(m_setup.bufferSize);
+        ulong buffersize = current;
+        if(request == DspWatchdog::Raise)
+        {
+            auto it = upper_bound(buffersizes.begin(), buffersizes.end(), current);
+            if(it != buffersizes.end())
+            {
+                buffersize = *it;
+            }
+        }
+        else if(m_watchdog_buffersize)
+        {
+            auto it = lower_bound(buffersizes.begin(), buffersizes.end(), current);
+            if(it != buffersizes.begin())
+            {
+                buffersize = max(*(it - 1), original);
+            }
+        }
+        if(buffersize != current)
+        {
+            m_vectorsize = vectorsize;
+            m_watchdog_buffersize = buffersize != original ? buffersize : 0;
+            m_setup.bufferSize = int(buffersize);
+            restart();
+        }
+    }
+    
+    void KiwiJuceDspDeviceManager::restart()
+    {
+        if(m_changes)
+        {
+            m_pending = true;
+        }
+        else
+        {
+            initialize();
+        }
+    }
+    
+    void KiwiJuceDspDeviceManager::reroute()
+    {
+        if(m_changes)
+        {
+            m_pending = true;
+        }
+        else if(!handover())
         {
-            m_setup.bufferSize = (int)vectorsize;
             initialize();
         }
     }
     
+    bool KiwiJuceDspDeviceManager::handover()
+    {
+        juce::AudioIODeviceType* driver = getDriver();
+        if(!m_seamless || isAdapting() || !driver || !m_device || !m_device->isPlaying())
+        {
+            return false;
+        }
+        juce::ScopedPointer<juce::AudioIODevice> device(driver->createDevice(m_setup.outputDeviceName, m_setup.inputDeviceName));
+        if(!device)
+        {
+            return false;
+        }
+        juce::BigInteger inputs, outputs;
+        setChannels(inputs, m_active_ins, device->getInputChannelNames().size());
+        setChannels(outputs, m_active_outs, device->getOutputChannelNames().size());
+        if(device->open(inputs, outputs, m_setup.sampleRate, m_setup.bufferSize).isNotEmpty())
+        {
+            return false;
+        }
+        
+        // The current device fades its last buffer out then outputs silence.
+        m_fade.store(FadeOut, memory_order_release);
+        const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        while(m_fade.load(memory_order_acquire) != Faded && chrono::steady_clock::now() - start < chrono::milliseconds(200))
+        {
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+        // The new device only starts once the current one is closed, the gap
+        // lasts as long as its start.
+        close();
+        m_device = device.release();
+        m_capabilities.formats = false;
+        m_fade.store(FadeIn, memory_order_release);
+        m_device->start(this);
+        return true;
+    }
+    
+    void KiwiJuceDspDeviceManager::beginChanges() noexcept
+    {
+        m_changes++;
+    }
+    
+    void KiwiJuceDspDeviceManager::commitChanges()
+    {
+        if(m_changes && !--m_changes && m_pending)
+        {
+            m_pending = false;
+            initialize();
+        }
+    }
+    
+    bool KiwiJuceDspDeviceManager::applySetup(DspDeviceSetup const& setup)
+    {
+        beginChanges();
+        if(!setup.driver.empty())
+        {
+            setDriver(setup.driver);
+        }
+        if(!setup.input.empty())
+        {
+            setInputDevice(setup.input);
+        }
+        if(!setup.output.empty())
+        {
+            setOutputDevice(setup.output);
+        }
+        if(setup.samplerate)
+        {
+            setSampleRate(setup.samplerate);
+        }
+        if(setup.vectorsize)
+        {
+            setVectorSize(setup.vectorsize);
+        }
+        commitChanges();
+        
+        return (setup.driver.empty() || setup.driver == getDriverName()) &&
+        (setup.input.empty() || setup.input == getInputDeviceName()) &&
+        (setup.output.empty() || setup.output == getOutputDeviceName()) &&
+        (!setup.samplerate || setup.samplerate == getSampleRate()) &&
+        (!setup.vectorsize || setup.vectorsize == getVectorSize());
+    }
+    
     sample const* KiwiJuceDspDeviceManager::getInputsSamples(const ulong channel) const noexcept
     {
-        if(m_input_matrix && channel < getNumberOfInputs())
+        sample const* const* host = m_host_ins.load(memory_order_relaxed);
+        if(channel < m_input_matrix.size() && channel < getNumberOfInputs() && binary_search(m_opened_ins.begin(), m_opened_ins.end(), channel))
         {
-            return m_input_matrix[channel];
+            return host ? host[channel] : m_input_matrix[channel];
         }
         else
         {
@@ -217,9 +552,10 @@ namespace Kiwi
     
     sample* KiwiJuceDspDeviceManager::getOutputsSamples(const ulong channel) const noexcept
     {
-        if(m_output_matrix && channel < getNumberOfOutputs())
+        sample* const* host = m_host_outs.load(memory_order_relaxed);
+        if(channel < m_output_matrix.size() && channel < getNumberOfOutputs() && binary_search(m_opened_outs.begin(), m_opened_outs.end(), channel))
         {
-            return m_output_matrix[channel];
+            return host ? host[channel] : m_output_matrix[channel];
         }
         else
         {
@@ -227,6 +563,60 @@ namespace Kiwi
         }
     }
     
+    void KiwiJuceDspDeviceManager::scan() const
+    {
+        if(!m_capabilities.devices)
+        {
+            m_capabilities.inputs.clear();
+            m_capabilities.outputs.clear();
+            juce::AudioIODeviceType* driver = getDriver();
+            if(driver)
+            {
+                driver->scanForDevices();
+                juce::StringArray inputNames = driver->getDeviceNames(true);
+                for(int i = 0; i < inputNames.size(); ++i)
+                {
+                    m_capabilities.inputs.push_back(inputNames[i].toStdString());
+                }
+                juce::StringArray outputNames = driver->getDeviceNames(false);
+                for(int i = 0; i < outputNames.size(); ++i)
+                {
+                    m_capabilities.outputs.push_back(outputNames[i].toStdString());
+                }
+            }
+            m_capabilities.devices = true;
+        }
+        if(!m_capabilities.formats)
+        {
+            m_capabilities.samplerates.clear();
+            m_capabilities.buffersizes.clear();
+            m_capabilities.ninputs  = 0;
+            m_capabilities.noutputs = 0;
+            if(m_device)
+            {
+                juce::Array<double> rates(m_device->getAvailableSampleRates());
+                for(int i = 0; i < rates.size(); ++i)
+                {
+                    m_capabilities.samplerates.push_back((ulong)rates[i]);
+                }
+                juce::Array<int> sizes(m_device->getAvailableBufferSizes());
+                for(int i = 0; i < sizes.size(); ++i)
+                {
+                    m_capabilities.buffersizes.push_back((ulong)sizes[i]);
+                }
+                m_capabilities.ninputs  = m_device->getInputChannelNames().size();
+                m_capabilities.noutputs = m_device->getOutputChannelNames().size();
+            }
+            m_capabilities.formats = true;
+        }
+    }
+    
+    void KiwiJuceDspDeviceManager::audioDeviceListChanged()
+    {
+        m_capabilities.devices = false;
+        m_capabilities.formats = false;
+    }
+    
     void KiwiJuceDspDeviceManager::close()
     {
         if(m_device)
@@ -239,33 +629,9 @@ namespace Kiwi
             {
                 m_device->close();
             }
-            if(m_input_matrix)
-            {
-                for(int i = 0; i < m_device->getInputChannelNames().size(); i++)
-                {
-                    if(m_input_matrix[i])
-                    {
-                        delete [] m_input_matrix[i];
-                    }
-                    m_input_matrix[i] = nullptr;
-                }
-                delete [] m_input_matrix;
-            }
-            m_input_matrix = nullptr;
-            if(m_output_matrix)
-            {
-                for(int i = 0; i < m_device->getOutputChannelNames().size(); i++)
-                {
-                    if(m_output_matrix[i])
-                    {
-                        delete [] m_output_matrix[i];
-                    }
-                    m_output_matrix[i] = nullptr;
-                }
-                delete [] m_output_matrix;
-            }
-            m_output_matrix = nullptr;
         }
+        m_input_matrix.clear();
+        m_output_matrix.clear();
     }
     
     void KiwiJuceDspDeviceManager::initialize()
@@ -273,13 +639,12 @@ namespace Kiwi
         juce::AudioIODeviceType* driver = getDriver();
         if(driver)
         {
-            driver->scanForDevices();
+            scan();
             if(!isOutputDeviceAvailable(m_setup.outputDeviceName.toStdString()))
             {
-                juce::StringArray deviceNames = driver->getDeviceNames(false);
-                if(deviceNames.size())
+                if(!m_capabilities.outputs.empty())
                 {
-                    m_setup.outputDeviceName = deviceNames[0];
+                    m_setup.outputDeviceName = juce::String(m_capabilities.outputs[0]);
                 }
                 else
                 {
@@ -288,10 +653,9 @@ namespace Kiwi
             }
             if(!isInputDeviceAvailable(m_setup.inputDeviceName.toStdString()))
             {
-                juce::StringArray deviceNames = driver->getDeviceNames(true);
-                if(deviceNames.size())
+                if(!m_capabilities.inputs.empty())
                 {
-                    m_setup.inputDeviceName = deviceNames[0];
+                    m_setup.inputDeviceName = juce::String(m_capabilities.inputs[0]);
                 }
                 else
                 {
@@ -302,26 +666,31 @@ namespace Kiwi
             close();
 
             m_device = driver->createDevice(m_setup.outputDeviceName, m_setup.inputDeviceName);
+            m_capabilities.formats = false;
+            scan();
             if(m_device)
             {
                 if(!isSampleRateAvailable(m_setup.sampleRate))
                 {
-                    juce::Array<double> array(m_device->getAvailableSampleRates());
-                    if(array.size())
+                    if(!m_capabilities.samplerates.empty())
                     {
-                        m_setup.sampleRate = array[0];
+                        m_setup.sampleRate = (double)m_capabilities.samplerates[0];
                     }
                     else
                     {
                         m_setup.sampleRate = 0;
                     }
                 }
-                if(!isVectorSizeAvailable(m_setup.bufferSize))
+                if(m_watchdog_buffersize)
+                {
+                    m_setup.bufferSize = int(m_watchdog_buffersize);
+                }
+                else if(m_adapter || !isVectorSizeAvailable(m_setup.bufferSize))
                 {
                     m_setup.bufferSize = m_device->getDefaultBufferSize();
                 }
-                m_setup.inputChannels.setRange(0, m_device->getInputChannelNames().size(), true);
-                m_setup.outputChannels.setRange(0, m_device->getOutputChannelNames().size(), true);
+                setChannels(m_setup.inputChannels, m_active_ins, m_capabilities.ninputs);
+                setChannels(m_setup.outputChannels, m_active_outs, m_capabilities.noutputs);
             }
             
             if(!m_device->isOpen())
@@ -346,18 +715,85 @@ namespace Kiwi
         m_setup.sampleRate = m_device->getCurrentSampleRate();
         m_setup.inputChannels = m_device->getActiveInputChannels();
         m_setup.outputChannels = m_device->getActiveOutputChannels();
+        m_profiler.prepare((ulong)m_setup.sampleRate);
+        m_watchdog.prepare();
         
-        m_input_matrix = new sample*[m_setup.inputChannels.getHighestBit() + 1];
-        for(int i = 0; i < m_setup.inputChannels.getHighestBit() + 1; i++)
+        const ulong nins    = ulong(m_setup.inputChannels.getHighestBit() + 1);
+        const ulong nouts   = ulong(m_setup.outputChannels.getHighestBit() + 1);
+        const ulong stride  = DspArena::align(getVectorSize() * m_oversampling);
+        const ulong stage   = m_oversampling > 1 ? DspArena::align(getVectorSize()) : 0ul;
+        sample* memory      = m_arena.reserve((nins + nouts) * (stride + stage));
+        Signal::vclear((nins + nouts) * (stride + stage), memory);
+        m_stride = stride;
+        m_stage_stride  = stage;
+        m_stage_ins     = memory + (nins + nouts) * stride;
+        m_stage_outs    = m_stage_ins + nins * stage;
+        m_oversampler.reset(m_oversampling > 1 ? new DspOversampler(nins, nouts, getVectorSize(), m_oversampling) : nullptr);
+        m_resampler_ins.reset();
+        m_resampler_outs.reset();
+        const ulong samplerate = ulong(m_setup.sampleRate);
+        if(m_engine_samplerate && m_engine_samplerate != samplerate)
+        {
+            // The chunks are a vector at the rate of the device, the output
+            // fifo starts with the frames the filters and the vectors hold
+            // back.
+            const ulong vectorsize = getVectorSize();
+            m_chunk = max((vectorsize * samplerate) / m_engine_samplerate, 1ul);
+            m_resampler_ins.reset(new DspResampler(nins, samplerate, m_engine_samplerate, m_resampler_quality, m_chunk));
+            const ulong maxframes = m_resampler_ins->getMaximumOutput(m_chunk);
+            m_resampler_outs.reset(new DspResampler(nouts, m_engine_samplerate, samplerate, m_resampler_quality, maxframes));
+            const ulong latency = vectorsize + m_resampler_ins->getMaximumOutput(m_resampler_ins->getLatency()) + m_resampler_outs->getLatency() + 2;
+            m_interleaved.assign(max(nins, nouts) * m_chunk, 0.f);
+            m_resampled_ins.assign(nins * maxframes, 0.f);
+            m_resampled_outs.assign(nouts * (maxframes + 4 * m_resampler_outs->getLatency() + 2), 0.f);
+            m_fifo_ins.prepare(nins, vectorsize + maxframes);
+            m_fifo_outs.prepare(nouts, latency + vectorsize * 2 + maxframes);
+            m_fifo_outs.clear(latency);
+        }
+        else if(isAdapting())
+        {
+            // The output fifo is primed once with the delay the buffer size
+            // of the device requires.
+            m_fifo_ins.prepare(nins, m_vectorsize);
+            m_fifo_outs.prepare(nouts, m_vectorsize * 2);
+            m_fifo_outs.clear(DspFifo::getLatency(ulong(m_setup.bufferSize), m_vectorsize));
+        }
+        m_input_matrix.resize(nins);
+        for(ulong i = 0; i < nins; i++)
         {
-            m_input_matrix[i] = new sample[m_setup.bufferSize];
+            m_input_matrix[i] = memory + i * stride;
         }
-        m_output_matrix = new sample*[m_setup.outputChannels.getHighestBit() + 1];
-        for(int i = 0; i < m_setup.outputChannels.getHighestBit() + 1; i++)
+        m_output_matrix.resize(nouts);
+        for(ulong i = 0; i < nouts; i++)
         {
-            m_output_matrix[i] = new sample[m_setup.bufferSize];
-            Signal::vclear(m_setup.bufferSize, m_output_matrix[i]);
+            m_output_matrix[i] = memory + (nins + i) * stride;
         }
+        
+        // JUCE packs the buffers of the opened channels, the callback puts
+        // them back at the index of their channel. The closed channels read
+        // silence and write to a buffer that is never played.
+        m_opened_ins.clear();
+        for(ulong i = 0; i < nins; i++)
+        {
+            if(m_setup.inputChannels[int(i)])
+            {
+                m_opened_ins.push_back(i);
+            }
+        }
+        m_opened_outs.clear();
+        for(ulong i = 0; i < nouts; i++)
+        {
+            if(m_setup.outputChannels[int(i)])
+            {
+                m_opened_outs.push_back(i);
+            }
+        }
+        const ulong nframes = max(ulong(m_setup.bufferSize), getVectorSize());
+        m_silence.assign(nframes, 0.f);
+        m_discard.assign(nframes, 0.f);
+        m_expanded_ins.assign(nins, m_silence.data());
+        m_expanded_outs.assign(nouts, m_discard.data());
+        m_masked = m_opened_ins.size() != nins || m_opened_outs.size() != nouts;
     }
     
     void KiwiJuceDspDeviceManager::audioDeviceStopped()
@@ -365,47 +801,306 @@ namespace Kiwi
         ;
     }
     
-    void KiwiJuceDspDeviceManager::audioDeviceIOCallback(const float** inputChannelData, int numInputChannels, float** outputChannelData, int numOutputChannels, int numSamples)
+    DspProfiler::Statistics KiwiJuceDspDeviceManager::getStatistics() const noexcept
+    {
+        return m_profiler.getStatistics();
+    }
+    
+    void KiwiJuceDspDeviceManager::resetStatistics() noexcept
+    {
+        m_profiler.reset();
+    }
+    
+    ulong KiwiJuceDspDeviceManager::getInputLatency() const noexcept
+    {
+        return m_device ? ulong(max(m_device->getInputLatencyInSamples(), 0)) : 0ul;
+    }
+    
+    ulong KiwiJuceDspDeviceManager::getOutputLatency() const noexcept
+    {
+        return m_device ? ulong(max(m_device->getOutputLatencyInSamples(), 0)) : 0ul;
+    }
+    
+    long KiwiJuceDspDeviceManager::measureLatency(const ulong input, const ulong output, const DspLatencyProbe::Stimulus stimulus)
     {
-#ifdef __KIWI_DSP_DOUBLE__
-        for(int i = 0; i < numInputChannels; i++)
+        if(!m_device || !m_device->isPlaying())
         {
-            sample* input = m_input_matrix[i];
-            float* real = inputChannelData[i];
-            for(int j = 0; j < numSamples; j++)
+            return -1;
+        }
+        const ulong samplerate = ulong(m_device->getCurrentSampleRate());
+        m_probe.prepare(input, output, stimulus, samplerate);
+        const chrono::milliseconds timeout((m_probe.getDuration() * 1000) / samplerate + 1000);
+        const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        while(!m_probe.isDone() && chrono::steady_clock::now() - start < timeout)
+        {
+            this_thread::sleep_for(chrono::milliseconds(10));
+        }
+        return m_probe.analyze();
+    }
+    
+    bool KiwiJuceDspDeviceManager::startRecording(string const& path, vector<ulong> const& inputs, vector<ulong> const& outputs, const DspRecorder::Format format)
+    {
+        if(!m_device || !m_device->isPlaying())
+        {
+            return false;
+        }
+        for(ulong i = 0; i < inputs.size(); i++)
+        {
+            if(inputs[i] >= m_input_matrix.size())
             {
-                *(input++) = *(real++);
+                return false;
             }
         }
-        for(int i = 0; i < numOutputChannels; i++)
+        for(ulong i = 0; i < outputs.size(); i++)
         {
-            Signal::vclear(numSamples, m_output_matrix[i]);
+            if(outputs[i] >= m_output_matrix.size())
+            {
+                return false;
+            }
         }
+        return m_recorder.start(path, inputs, outputs, ulong(m_device->getCurrentSampleRate()), format);
+    }
+    
+    void KiwiJuceDspDeviceManager::stopRecording()
+    {
+        m_recorder.stop();
+    }
+    
+    DspRecorder::Counters KiwiJuceDspDeviceManager::getRecordingCounters() const noexcept
+    {
+        return m_recorder.getCounters();
+    }
+    
+    void KiwiJuceDspDeviceManager::render() noexcept
+    {
+        if(!m_oversampler)
+        {
+            tick();
+            return;
+        }
+        const ulong vectorsize = getVectorSize();
+        DspProfiler::clock::time_point start = DspProfiler::clock::now();
+        for(ulong i = 0; i < m_opened_ins.size(); i++)
+        {
+            const ulong c = m_opened_ins[i];
+            m_oversampler->upsample(c, m_stage_ins + c * m_stage_stride, m_input_matrix[c]);
+        }
+        for(ulong i = 0; i < m_opened_outs.size(); i++)
+        {
+            Signal::vclear(vectorsize * m_oversampler->getRatio(), m_output_matrix[m_opened_outs[i]]);
+        }
+        m_profiler.addFilter(start);
         tick();
-        for(int i = 0; i < numOutputChannels; i++)
+        start = DspProfiler::clock::now();
+        for(ulong i = 0; i < m_opened_outs.size(); i++)
+        {
+            const ulong c = m_opened_outs[i];
+            m_oversampler->downsample(c, m_output_matrix[c], m_stage_outs + c * m_stage_stride);
+        }
+        m_profiler.addFilter(start);
+    }
+    
+    void KiwiJuceDspDeviceManager::tick(const float** inputs, float** outputs, const ulong nframes) noexcept
+    {
+        const ulong nouts = m_output_matrix.size();
+        // With the oversampling, the fifos exchange the vectors of the
+        // device with the stage matrices.
+        const ulong stride  = m_oversampler ? m_stage_stride : m_stride;
+        sample* matrix_ins  = m_oversampler ? m_stage_ins : m_arena.data();
+        sample* matrix_outs = m_oversampler ? m_stage_outs : matrix_ins + m_input_matrix.size() * m_stride;
+        for(ulong done = 0; done < nframes;)
+        {
+            const ulong n = min(nframes - done, m_vectorsize - m_fifo_ins.getSize());
+            m_fifo_ins.write(n, inputs, done);
+            if(m_fifo_ins.getSize() == m_vectorsize)
+            {
+                m_fifo_ins.pull(m_vectorsize, matrix_ins, stride);
+                for(ulong i = 0; i < nouts; i++)
+                {
+                    Signal::vclear(m_vectorsize, matrix_outs + i * stride);
+                }
+                render();
+                m_fifo_outs.push(m_vectorsize, matrix_outs, stride);
+            }
+            m_fifo_outs.read(n, outputs, done);
+            done += n;
+        }
+    }
+    
+    void KiwiJuceDspDeviceManager::resample(const float** inputs, float** outputs, const ulong nframes) noexcept
+    {
+        const ulong nins        = m_input_matrix.size();
+        const ulong nouts       = m_output_matrix.size();
+        const ulong vectorsize  = getVectorSize();
+        const ulong maxframes   = m_resampler_ins->getMaximumOutput(m_chunk);
+        const ulong stride      = m_oversampler ? m_stage_stride : m_stride;
+        sample* matrix_ins      = m_oversampler ? m_stage_ins : m_arena.data();
+        sample* matrix_outs     = m_oversampler ? m_stage_outs : matrix_ins + nins * m_stride;
+        float* frames           = m_interleaved.data();
+        
+        for(ulong done = 0; done < nframes;)
         {
-            sample* output = m_output_matrix[i];
-            float* real = outputChannelData[i];
-            for(int j = 0; j < numSamples; j++)
+            const ulong n = min(nframes - done, m_chunk);
+            for(ulong i = 0; i < nins; i++)
             {
-                *(real++) = *(output++);
+                for(ulong j = 0; j < n; j++)
+                {
+                    frames[j * nins + i] = inputs[i][done + j];
+                }
+            }
+            DspProfiler::clock::time_point start = DspProfiler::clock::now();
+            const ulong produced = m_resampler_ins->process(n, frames, maxframes, m_resampled_ins.data());
+            m_profiler.addConversion(start);
+            m_fifo_ins.write(produced, m_resampled_ins.data());
+            while(m_fifo_ins.getSize() >= vectorsize)
+            {
+                m_fifo_ins.pull(vectorsize, matrix_ins, stride);
+                for(ulong i = 0; i < nouts; i++)
+                {
+                    Signal::vclear(vectorsize, matrix_outs + i * stride);
+                }
+                render();
+                m_fifo_outs.push(vectorsize, matrix_outs, stride);
             }
+            const ulong required = m_resampler_outs->getRequiredInput(n);
+            m_fifo_outs.read(required, m_resampled_outs.data());
+            start = DspProfiler::clock::now();
+            m_resampler_outs->process(required, m_resampled_outs.data(), n, frames);
+            m_profiler.addConversion(start);
+            for(ulong i = 0; i < nouts; i++)
+            {
+                for(ulong j = 0; j < n; j++)
+                {
+                    outputs[i][done + j] = frames[j * nouts + i];
+                }
+            }
+            done += n;
         }
-#else
-        for(int i = 0; i < numInputChannels; i++)
+    }
+    
+    void KiwiJuceDspDeviceManager::fade(float** outputs, const int nchannels, const int nframes, const bool in) noexcept
+    {
+        const float step = 1.f / float(nframes);
+        for(int i = 0; i < nchannels; i++)
         {
-            Signal::vcopy(numSamples, inputChannelData[i], m_input_matrix[i]);
+            for(int j = 0; j < nframes; j++)
+            {
+                outputs[i][j] *= in ? float(j + 1) * step : float(nframes - j - 1) * step;
+            }
         }
-        tick();
-        for(int i = 0; i < numOutputChannels; i++)
+    }
+    
+    void KiwiJuceDspDeviceManager::setChannels(juce::BigInteger& channels, vector<bool> const& mask, const int nchannels)
+    {
+        channels.clear();
+        if(mask.empty())
+        {
+            channels.setRange(0, nchannels, true);
+        }
+        else
+        {
+            for(int i = 0; i < nchannels && i < int(mask.size()); i++)
+            {
+                channels.setBit(i, mask[i]);
+            }
+        }
+    }
+    
+    void KiwiJuceDspDeviceManager::audioDeviceIOCallback(const float** inputChannelData, int numInputChannels, float** outputChannelData, int numOutputChannels, int numSamples)
+    {
+        const int state = m_fade.load(memory_order_acquire);
+        if(state == Faded)
+        {
+            for(int i = 0; i < numOutputChannels; i++)
+            {
+                Signal::vclear(numSamples, outputChannelData[i]);
+            }
+            return;
+        }
+        const DspProfiler::clock::time_point start = m_profiler.begin();
+        const float** ins   = inputChannelData;
+        float** outs        = outputChannelData;
+        ulong nins          = ulong(numInputChannels);
+        ulong nouts         = ulong(numOutputChannels);
+        if(m_masked)
+        {
+            for(ulong i = 0; i < m_opened_ins.size() && i < ulong(numInputChannels); i++)
+            {
+                m_expanded_ins[m_opened_ins[i]] = inputChannelData[i];
+            }
+            for(ulong i = 0; i < m_opened_outs.size() && i < ulong(numOutputChannels); i++)
+            {
+                m_expanded_outs[m_opened_outs[i]] = outputChannelData[i];
+            }
+            ins     = m_expanded_ins.data();
+            outs    = m_expanded_outs.data();
+            nins    = m_expanded_ins.size();
+            nouts   = m_expanded_outs.size();
+        }
+        if(m_resampler_ins)
         {
-            Signal::vcopy(numSamples, m_output_matrix[i], outputChannelData[i]);
+            resample(ins, outs, (ulong)numSamples);
         }
-        for(int i = 0; i < numOutputChannels; i++)
+        else if(isAdapting() && (ulong(numSamples) != m_vectorsize || m_fifo_ins.getSize() || m_fifo_outs.getSize()))
         {
-            Signal::vclear(numSamples, m_output_matrix[i]);
+            tick(ins, outs, (ulong)numSamples);
         }
+        else
+        {
+#ifndef __KIWI_DSP_DOUBLE__
+            if(!m_oversampler)
+            {
+                for(int i = 0; i < numOutputChannels; i++)
+                {
+                    Signal::vclear(numSamples, outputChannelData[i]);
+                }
+                m_host_ins.store(ins, memory_order_relaxed);
+                m_host_outs.store(outs, memory_order_relaxed);
+                tick();
+                m_host_ins.store(nullptr, memory_order_relaxed);
+                m_host_outs.store(nullptr, memory_order_relaxed);
+            }
+            else
 #endif
+            {
+                for(ulong i = 0; i < m_opened_ins.size(); i++)
+                {
+                    const ulong c = m_opened_ins[i];
+                    Kernels::fromFloat(numSamples, ins[c], m_oversampler ? m_stage_ins + c * m_stage_stride : m_input_matrix[c]);
+                }
+                for(ulong i = 0; i < m_opened_outs.size(); i++)
+                {
+                    const ulong c = m_opened_outs[i];
+                    Signal::vclear(numSamples, m_oversampler ? m_stage_outs + c * m_stage_stride : m_output_matrix[c]);
+                }
+                render();
+                for(ulong i = 0; i < m_opened_outs.size(); i++)
+                {
+                    const ulong c = m_opened_outs[i];
+                    Kernels::toFloat(numSamples, m_oversampler ? m_stage_outs + c * m_stage_stride : m_output_matrix[c], outs[c]);
+                }
+            }
+        }
+        if(m_probe.isRunning())
+        {
+            const ulong in = m_probe.getInputChannel(), out = m_probe.getOutputChannel();
+            m_probe.process((ulong)numSamples, in < nins ? ins[in] : nullptr, 1, out < nouts ? outs[out] : nullptr, 1);
+        }
+        if(m_recorder.isRunning())
+        {
+            m_recorder.process((ulong)numSamples, ins, nins, outs, nouts);
+        }
+        if(state == FadeOut)
+        {
+            fade(outputChannelData, numOutputChannels, numSamples, false);
+            m_fade.store(Faded, memory_order_release);
+        }
+        else if(state == FadeIn)
+        {
+            fade(outputChannelData, numOutputChannels, numSamples, true);
+            m_fade.store(FadeNone, memory_order_release);
+        }
+        m_watchdog.update(m_profiler.end(start, (ulong)numSamples, 0ul));
     }
     
     void KiwiJuceDspDeviceManager::stop()
@@ -27,29 +27,186 @@
 #define __DEF_KIWI_DSP_JUCE_DEVICE__
 
 #include "../../KiwiDsp/KiwiDsp.h"
+#include "../KiwiDspKernels.h"
+#include "../KiwiDspProfiler.h"
+#include "../KiwiDspArena.h"
+#include "../KiwiDspFifo.h"
+#include "../KiwiDspDeviceSetup.h"
+#include "../KiwiDspLatency.h"
+#include "../KiwiDspDenormals.h"
+#include "../KiwiDspWatchdog.h"
+#include "../KiwiDspOversampler.h"
+#include "../KiwiDspResampler.h"
+#include "../KiwiDspRecorder.h"
 #include <JuceHeader.h>
 
 namespace Kiwi
 {
-    class KiwiJuceDspDeviceManager : public DspDeviceManager, public juce::AudioIODeviceCallback
+    class KiwiJuceDspDeviceManager : public DspDeviceManager, public juce::AudioIODeviceCallback, public juce::AudioIODeviceType::Listener, private juce::Timer
     {
+        //! The capabilities of the current driver and device.
+        struct Capabilities
+        {
+            bool            devices;
+            bool            formats;
+            vector<string>  inputs;
+            vector<string>  outputs;
+            vector<ulong>   samplerates;
+            vector<ulong>   buffersizes;
+            int             ninputs;
+            int             noutputs;
+        };
+        
         juce::OwnedArray<juce::AudioIODeviceType>   m_drivers;
         string                                      m_driver_name;
         juce::ScopedPointer<juce::AudioIODevice>    m_device;
         juce::AudioDeviceManager::AudioDeviceSetup  m_setup;
-        sample**                                    m_input_matrix;
-        sample**                                    m_output_matrix;
+        DspArena                                    m_arena;
+        vector<sample*>                             m_input_matrix;
+        vector<sample*>                             m_output_matrix;
+        DspProfiler                                 m_profiler;
+        bool                                        m_adapter;
+        ulong                                       m_vectorsize;
+        ulong                                       m_stride;
+        DspFifo                                     m_fifo_ins;
+        DspFifo                                     m_fifo_outs;
+        ulong                                       m_changes;
+        bool                                        m_pending;
+        mutable Capabilities                        m_capabilities;
+        atomic<sample const* const*>                m_host_ins;
+        atomic<sample* const*>                      m_host_outs;
+        DspLatencyProbe                             m_probe;
+        DspRecorder                                 m_recorder;
+        atomic<bool>                                m_denormals;
+        DspWatchdog                                 m_watchdog;
+        ulong                                       m_watchdog_buffersize;
+        bool                                        m_seamless;
+        atomic<int>                                 m_fade;
+        ulong                                       m_oversampling;
+        unique_ptr<DspOversampler>                  m_oversampler;
+        sample*                                     m_stage_ins;
+        sample*                                     m_stage_outs;
+        ulong                                       m_stage_stride;
+        ulong                                       m_engine_samplerate;
+        DspResampler::Quality                       m_resampler_quality;
+        unique_ptr<DspResampler>                    m_resampler_ins;
+        unique_ptr<DspResampler>                    m_resampler_outs;
+        ulong                                       m_chunk;
+        vector<float>                               m_interleaved;
+        vector<float>                               m_resampled_ins;
+        vector<float>                               m_resampled_outs;
+        vector<bool>                                m_active_ins;
+        vector<bool>                                m_active_outs;
+        vector<ulong>                               m_opened_ins;
+        vector<ulong>                               m_opened_outs;
+        vector<float const*>                        m_expanded_ins;
+        vector<float*>                              m_expanded_outs;
+        vector<float>                               m_silence;
+        vector<float>                               m_discard;
+        bool                                        m_masked;
+        
+        //! The states of the crossfade of a switch.
+        enum Fade
+        {
+            FadeNone    = 0,
+            FadeOut     = 1,
+            Faded       = 2,
+            FadeIn      = 3
+        };
         
         void initialize();
         
         void close();
         
+        //! Fill the capabilities.
+        /** This function fills the parts of the cache that are invalid. The devices are scanned once per driver and the formats once per device.
+         */
+        void scan() const;
+        
+        //! Restart the device.
+        /** This function reinitializes the device or, between beginChanges() and commitChanges(), defers it to the commit.
+         */
+        void restart();
+        
+        //! Switch the devices.
+        /** This function opens the new devices while the current ones are still playing, fades the current ones out, then starts the new ones with a fade in. It falls back on the reinitialization when the switch isn't possible.
+         */
+        void reroute();
+        
+        //! Open the new devices and fade over.
+        /** This function opens the devices of the setup before closing the current ones so only the start of the stream separates them.
+         @return True if the devices have been switched, false if the device must be reinitialized.
+         */
+        bool handover();
+        
+        //! Apply a ramp over the outputs.
+        /** This function multiplies the buffers by a linear ramp that goes up or down over the buffer.
+         @param outputs The output buffers.
+         @param nchannels The number of channels.
+         @param nframes The number of frames.
+         @param in True to fade in, false to fade out.
+         */
+        static void fade(float** outputs, const int nchannels, const int nframes, const bool in) noexcept;
+        
+        //! Select the channels to open.
+        /** This function sets the bits of the channels of a mask that the device has, or all the channels of the device if the mask is empty.
+         @param channels The channels to open.
+         @param mask The state of each channel.
+         @param nchannels The number of channels of the device.
+         */
+        static void setChannels(juce::BigInteger& channels, vector<bool> const& mask, const int nchannels);
+        
         //! Retrieve the current driver.
         /** This function retrieves the current driver.
          @return The current driver.
          */
         juce::AudioIODeviceType* getDriver() const;
         
+        //! Retrieve if the device goes through the fifos.
+        /** This function retrieves if the buffer adapter is enabled or if the watchdog raised the buffer size of the device above the vector size.
+         @return True if the device goes through the fifos.
+         */
+        inline bool isAdapting() const noexcept
+        {
+            return m_adapter || m_watchdog_buffersize;
+        }
+        
+        inline void tick() const noexcept
+        {
+            if(m_watchdog.getLevel() == DspWatchdog::Silent)
+            {
+                return;
+            }
+            const DspDenormalsGuard guard(m_denormals.load(memory_order_relaxed));
+            DspDeviceManager::tick();
+        }
+        
+        //! Tick the dsp at the rate of the dsp.
+        /** This function upsamples the vectors of the device to the matrices of the dsp, ticks the dsp then downsamples the outputs. Without oversampling, it only ticks the dsp. The duration of the filters is added to the profiler.
+         */
+        void render() noexcept;
+        
+        //! Tick the dsp through the fifos.
+        /** This function exchanges the buffers of the device with the fifos and ticks the dsp each time a full vector is available. It is used when the device doesn't deliver buffers of the vector size.
+         @param inputs The input buffers.
+         @param outputs The output buffers.
+         @param nframes The number of frames of the buffers.
+         */
+        void tick(const float** inputs, float** outputs, const ulong nframes) noexcept;
+        
+        //! Tick the dsp through the resamplers.
+        /** This function converts the buffers of the device to the rate of the dsp, exchanges them with the fifos and ticks the dsp each time a full vector is available, then converts the outputs back to the rate of the device. The buffers are processed by chunks of a vector of the device.
+         @param inputs The input buffers.
+         @param outputs The output buffers.
+         @param nframes The number of frames of the buffers.
+         */
+        void resample(const float** inputs, float** outputs, const ulong nframes) noexcept;
+        
+        //! Follow the requests of the watchdog.
+        /** This function raises the buffer size of the device when the watchdog detects an overload and lowers it back when the load stays low. The vector size of the dsp doesn't change, the fifos cut the larger buffers into vectors.
+         */
+        void timerCallback() override;
+        
     public:
         
         //! Constructor
@@ -164,20 +321,212 @@ namespace Kiwi
          */
         void setVectorSize(ulong const vectorsize) override;
         
+        //! Begin a set of changes.
+        /** This function defers the reinitialization of the device until the matching call to commitChanges(), so several parameters can be changed with only one restart. The calls can be nested. Until the commit, the sample rate and the vector size are only validated against the new device by the reinitialization.
+         */
+        void beginChanges() noexcept;
+        
+        //! Commit a set of changes.
+        /** This function ends a set of changes started with beginChanges() and reinitializes the device once if a parameter changed.
+         */
+        void commitChanges();
+        
+        //! Apply a setup.
+        /** This function changes the driver, the devices, the sample rate and the vector size then reinitializes the device once.
+         @param setup The setup.
+         @return True if all the parameters have been applied, false if some were not available.
+         */
+        bool applySetup(DspDeviceSetup const& setup);
+        
         //! Retrieve the inputs sample matrix.
-        /** This function retrieves the inputs sample matrix.
+        /** This function retrieves the inputs sample matrix. In the float build, it returns the buffers of the device during the tick so the dsp must retrieve the pointers at each tick.
          @param channel the index of the channel.
          @return The inputs sample matrix.
          */
         sample const* getInputsSamples(const ulong channel) const noexcept override;
         
         //! Retrieve the outputs sample matrix.
-        /** This function retrieves the outputs sample matrix.
+        /** This function retrieves the outputs sample matrix. In the float build, it returns the buffers of the device during the tick so the dsp must retrieve the pointers at each tick.
          @param channel the index of the channel.
          @return The outputs sample matrix.
          */
         sample* getOutputsSamples(const ulong channel) const noexcept override;
         
+        //! Retrieve the statistics of the callback.
+        /** This function retrieves a snapshot of the durations, the loads and the late callbacks since the device started or since the last reset. JUCE doesn't report the xruns so their counters stay at zero.
+         @return The statistics.
+         */
+        DspProfiler::Statistics getStatistics() const noexcept;
+        
+        //! Reset the statistics of the callback.
+        /** This function resets the statistics of the callback.
+         */
+        void resetStatistics() noexcept;
+        
+        //! Retrieve the input latency.
+        /** This function retrieves the input latency reported by the device.
+         @return The input latency in samples or zero if there is no device.
+         */
+        ulong getInputLatency() const noexcept;
+        
+        //! Retrieve the output latency.
+        /** This function retrieves the output latency reported by the device.
+         @return The output latency in samples or zero if there is no device.
+         */
+        ulong getOutputLatency() const noexcept;
+        
+        //! Measure the round-trip latency.
+        /** This function plays a stimulus on an output channel, records an input channel and finds the stimulus in the recording. The channels must be connected with a loopback cable and the device must be playing. The function blocks until the measure is done.
+         @param input The index of the input channel.
+         @param output The index of the output channel.
+         @param stimulus The stimulus.
+         @return The round-trip latency in samples or -1 if the measure failed.
+         */
+        long measureLatency(const ulong input, const ulong output, const DspLatencyProbe::Stimulus stimulus = DspLatencyProbe::Sequence);
+        
+        //! Start a recording.
+        /** This function records input channels of the device and output channels of the dsp to a file while the device plays. The audio thread copies the channels to a ring buffer and a writer thread streams them to the file, so the callback never waits for the disk. The recording goes on through the restarts of the device until stopRecording() is called.
+         @param path The path of the file.
+         @param inputs The indices of the input channels.
+         @param outputs The indices of the output channels, written after the inputs.
+         @param format The format of the file.
+         @return True if the recording has started, false if the device isn't playing, a channel doesn't exist or the file can't be opened.
+         */
+        bool startRecording(string const& path, vector<ulong> const& inputs, vector<ulong> const& outputs, const DspRecorder::Format format = DspRecorder::Wave64);
+        
+        //! Stop the recording.
+        /** This function stops the recording, writes the remaining frames and closes the file.
+         */
+        void stopRecording();
+        
+        //! Retrieve the counters of the recording.
+        /** This function retrieves the number of frames written and the buffers dropped because the disk fell behind.
+         @return The counters.
+         */
+        DspRecorder::Counters getRecordingCounters() const noexcept;
+        
+        //! Set the buffer adapter.
+        /** This function enables or disables the buffer adapter. When it is enabled, the device uses its preferred buffer size and a fifo feeds the dsp with vectors of the vector size. The fifo adds no latency when the buffer size of the device matches the vector size, otherwise it adds the smallest latency that avoids the underflows for this buffer size. The latency is set when the device starts.
+         @param state True to enable the adapter, false to disable it.
+         */
+        void setBufferAdapter(const bool state);
+        
+        //! Retrieve if the buffer adapter is enabled.
+        /** This function retrieves if the buffer adapter is enabled.
+         @return True if the adapter is enabled, otherwise false.
+         */
+        bool hasBufferAdapter() const noexcept;
+        
+        //! Set the protection against the denormals.
+        /** This function enables or disables the flush-to-zero and denormals-are-zero modes of the floating-point unit while the dsp is ticked. The protection is enabled by default.
+         @param state True to enable the protection, false to disable it.
+         */
+        void setDenormalsProtection(const bool state) noexcept;
+        
+        //! Retrieve if the protection against the denormals is enabled.
+        /** This function retrieves if the protection against the denormals is enabled.
+         @return True if the protection is enabled, otherwise false.
+         */
+        bool hasDenormalsProtection() const noexcept;
+        
+        //! Set the seamless switch.
+        /** This function enables or disables the fades of the switch of devices. When it is enabled, a change of input or output device outside of a set of changes opens the new device before the current one is closed, fades the current one out over one buffer and fades the new one in. Unlike the PortAudio device manager the switch isn't seamless: JUCE can't drive two devices with the same callback, so the manager waits up to 200 milliseconds for the fade out, closes the current device and only then starts the new one. The outputs stay silent for the whole start time of the new device, which depends on the driver and can reach hundreds of milliseconds, the fades only remove the clicks. The switch doesn't apply to the buffer adapter.
+         @param state True to enable the seamless switch, false to disable it.
+         */
+        void setSeamlessSwitch(const bool state) noexcept;
+        
+        //! Retrieve if the seamless switch is enabled.
+        /** This function retrieves if the seamless switch of devices is enabled.
+         @return True if the seamless switch is enabled, otherwise false.
+         */
+        bool hasSeamlessSwitch() const noexcept;
+        
+        //! Set the oversampling ratio.
+        /** This function sets the ratio between the rate of the dsp and the rate of the device. The dsp is ticked once per vector of the device with vectors ratio times larger, so the contexts must be compiled with a sample rate of getSampleRate() * getOversampling() and a vector size of getVectorSize() * getOversampling(). The inputs are upsampled and the outputs downsampled by cascaded half-band filters. The ratio can change while the device plays, the stream is restarted but the device isn't reopened. The ratio 1, the default, disables the oversampling.
+         @param ratio The ratio, 1, 2, 4 or 8.
+         */
+        void setOversampling(const ulong ratio);
+        
+        //! Retrieve the oversampling ratio.
+        /** This function retrieves the ratio between the rate of the dsp and the rate of the device.
+         @return The ratio.
+         */
+        ulong getOversampling() const noexcept;
+        
+        //! Retrieve the latency of the oversampling.
+        /** This function retrieves the delay that the filters of the oversampling add between the inputs and the outputs. It isn't included in the latencies reported by the device.
+         @return The latency in samples at the rate of the device.
+         */
+        ulong getOversamplingLatency() const noexcept;
+        
+        //! Set the sample rate of the engine.
+        /** This function sets a fixed sample rate for the dsp whatever the sample rate of the device is. When the rates differ, the buffers of the device are converted by streaming resamplers and a fifo feeds the dsp with vectors of the vector size, so the contexts must be compiled with getEngineSampleRate(). The resampling adds the delay of the filters and up to a vector. The stream is restarted but the device isn't reopened. The rate 0, the default, runs the dsp at the rate of the device.
+         @param samplerate The sample rate or 0.
+         */
+        void setEngineSampleRate(const ulong samplerate);
+        
+        //! Retrieve the sample rate of the engine.
+        /** This function retrieves the sample rate the dsp runs at.
+         @return The fixed sample rate of the engine or the sample rate of the device.
+         */
+        ulong getEngineSampleRate() const noexcept;
+        
+        //! Set the quality of the resampling.
+        /** This function sets the filters of the resampling between the rate of the device and the rate of the engine. The change restarts the stream if it is resampled.
+         @param quality The quality.
+         */
+        void setResamplerQuality(const DspResampler::Quality quality);
+        
+        //! Retrieve the quality of the resampling.
+        /** This function retrieves the filters of the resampling between the rate of the device and the rate of the engine.
+         @return The quality.
+         */
+        DspResampler::Quality getResamplerQuality() const noexcept;
+        
+        //! Set the active input channels.
+        /** This function sets the input channels the dsp uses. Only the active channels of the device are opened and converted, the other ones are reported as missing so getInputsSamples() returns nullptr for them. An empty mask, the default, opens all the channels. The change reopens the device, or waits for the commit inside a set of changes.
+         @param mask The state of each channel, true if the channel is active.
+         */
+        void setActiveInputs(vector<bool> const& mask);
+        
+        //! Set the active output channels.
+        /** This function sets the output channels the dsp uses. Only the active channels of the device are opened, cleared and converted, getOutputsSamples() returns nullptr for the other ones. An empty mask, the default, opens all the channels. The change reopens the device, or waits for the commit inside a set of changes.
+         @param mask The state of each channel, true if the channel is active.
+         */
+        void setActiveOutputs(vector<bool> const& mask);
+        
+        //! Retrieve if an input channel is active.
+        /** This function retrieves if an input channel is in the mask of the active inputs.
+         @param channel The index of the channel.
+         @return True if the channel is active, otherwise false.
+         */
+        bool isInputActive(const ulong channel) const noexcept;
+        
+        //! Retrieve if an output channel is active.
+        /** This function retrieves if an output channel is in the mask of the active outputs.
+         @param channel The index of the channel.
+         @return True if the channel is active, otherwise false.
+         */
+        bool isOutputActive(const ulong channel) const noexcept;
+        
+        //! Set the rules of the watchdog.
+        /** This function sets how the device reacts when several consecutive callbacks run past their budget: output silence instead of ticking the dsp, raise the buffer size of the device to the next available one, or both. The processing and the buffer size are restored when the load drops again. The buffer size is changed on the message thread. The vector size of the dsp never changes, the larger buffers are cut into vectors by the fifos of the buffer adapter, so the contexts don't need to be compiled again. The device has no non-critical contexts so the rule that skips them is ignored. No rule, the default, disables the watchdog.
+         @param rules The combination of DspWatchdog::Rule.
+         */
+        void setWatchdogRules(const ulong rules);
+        
+        //! Retrieve the rules of the watchdog.
+        /** This function retrieves the rules of the watchdog.
+         @return The combination of DspWatchdog::Rule.
+         */
+        ulong getWatchdogRules() const noexcept;
+        
+        //! Retrieve the level of the watchdog.
+        /** This function retrieves the current degradation of the processing.
+         @return The level.
+         */
+        DspWatchdog::Level getWatchdogLevel() const noexcept;
+        
         //! Start the device.
         /** This function starts the device.
          */
@@ -191,6 +540,7 @@ namespace Kiwi
         void audioDeviceIOCallback(const float** inputChannelData, int numInputChannels, float** outputChannelData, int numOutputChannels, int numSamples) override;
         void audioDeviceAboutToStart(AudioIODevice* device) override;
         void audioDeviceStopped() override;
+        void audioDeviceListChanged() override;
     };
 }
 
@@ -26,6 +26,7 @@
 
 #include "KiwiJuce/KiwiJuce.h"
 #include "KiwiDspPortAudio.h"
+#include "KiwiDspOffline.h"
 
 #endif
 
@@ -0,0 +1,195 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+ */
+
+
+#include "../KiwiDspKernels.h"
+#include "../KiwiDspDenormals.h"
+#include "../KiwiDspResampler.h"
+#include "../KiwiDspPortAudio.h"
+#include "../KiwiDspPortAudioMock.h"
+
+using namespace Kiwi;
+
+// ================================================================================ //
+//                                     BENCHMARK                                    //
+// ================================================================================ //
+
+// The benchmark reports the time per sample of the hot paths of the wrappers.
+// It should be built in release, the numbers only compare the variants of a
+// same section on the same machine.
+
+template <class Function> static double measure(const ulong nruns, Function function)
+{
+    function();
+    const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for(ulong i = 0; i < nruns; i++)
+    {
+        function();
+    }
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count() / double(nruns);
+}
+
+static void report(string const& name, const double duration, const ulong nsamples)
+{
+    cout << "    " << name << ": " << (duration * 1e9) / double(nsamples) << " ns per sample" << endl;
+}
+
+static void benchmarkConversions()
+{
+    const ulong vectorsize  = 256;
+    const ulong nchannels   = 2;
+    const ulong size        = vectorsize * nchannels;
+    const ulong nruns       = 20000;
+    vector<float>   buffer(size, 0.25f);
+    vector<sample>  matrix(size, 0.25);
+    vector<int16_t> int16s(size, 8192);
+    vector<uint8_t> int24s(size * 3, 0);
+    vector<int32_t> int32s(size, 1 << 29);
+    Kernels::Dither dither;
+    
+    cout << "Conversions, " << Kernels::getImplementationName() << " and " << Kernels::getIntegerImplementationName() << endl;
+    report("fromFloat", measure(nruns, [&]() {Kernels::fromFloat(size, buffer.data(), matrix.data());}), size);
+    report("toFloat", measure(nruns, [&]() {Kernels::toFloat(size, matrix.data(), buffer.data());}), size);
+    report("deinterleave", measure(nruns, [&]() {Kernels::deinterleave(vectorsize, nchannels, buffer.data(), matrix.data());}), size);
+    report("interleave", measure(nruns, [&]() {Kernels::interleave(vectorsize, nchannels, matrix.data(), buffer.data());}), size);
+    report("fromInt16", measure(nruns, [&]() {Kernels::fromInt16(size, int16s.data(), buffer.data());}), size);
+    report("toInt16", measure(nruns, [&]() {Kernels::toInt16(size, buffer.data(), int16s.data(), nullptr);}), size);
+    report("toInt16 with dither", measure(nruns, [&]() {Kernels::toInt16(size, buffer.data(), int16s.data(), &dither);}), size);
+    report("fromInt24", measure(nruns, [&]() {Kernels::fromInt24(size, int24s.data(), buffer.data());}), size);
+    report("toInt24", measure(nruns, [&]() {Kernels::toInt24(size, buffer.data(), int24s.data(), nullptr);}), size);
+    report("fromInt32", measure(nruns, [&]() {Kernels::fromInt32(size, int32s.data(), buffer.data());}), size);
+    report("toInt32", measure(nruns, [&]() {Kernels::toInt32(size, buffer.data(), int32s.data());}), size);
+}
+
+// A bank of feedback filters decays toward silence from the smallest normal
+// number, so all its states are denormal numbers unless they are flushed.
+static void benchmarkDenormals()
+{
+    const ulong vectorsize  = 256;
+    const ulong nfilters    = 64;
+    const ulong nruns       = 2000;
+    vector<sample> states(nfilters);
+    vector<sample> outputs(vectorsize * nfilters);
+    
+    cout << "Denormals, guard " << (DspDenormalsGuard::isSupported() ? "supported" : "not supported") << endl;
+    for(const bool enable : {false, true})
+    {
+        const double duration = measure(nruns, [&]()
+        {
+            DspDenormalsGuard guard(enable);
+            fill(states.begin(), states.end(), numeric_limits<sample>::min() * sample(0.5));
+            for(ulong i = 0; i < nfilters; i++)
+            {
+                sample state = states[i];
+                sample* output = outputs.data() + i * vectorsize;
+                for(ulong j = 0; j < vectorsize; j++)
+                {
+                    state = state * sample(0.9999) + output[j] * sample(0.0001);
+                    output[j] = state;
+                }
+                states[i] = state;
+            }
+        });
+        report(enable ? "decaying feedback with the guard" : "decaying feedback without the guard", duration, vectorsize * nfilters);
+    }
+}
+
+// The resamplers alone for the common pairs of rates, then the callback of
+// the PortAudio device driven by the mock with and without an engine rate.
+static void benchmarkResampler()
+{
+    const ulong vectorsize  = 256;
+    const ulong nchannels   = 2;
+    const ulong nruns       = 2000;
+    const ulong rates[][2]  = {{44100, 48000}, {48000, 44100}, {96000, 48000}};
+    vector<float> inputs(vectorsize * nchannels, 0.25f);
+    
+    cout << "Resampler" << endl;
+    for(const DspResampler::Quality quality : {DspResampler::Fast, DspResampler::High})
+    {
+        for(auto const& rate : rates)
+        {
+            DspResampler resampler(nchannels, rate[0], rate[1], quality, vectorsize);
+            const ulong maxoutputs = resampler.getMaximumOutput(vectorsize);
+            vector<float> outputs(maxoutputs * nchannels);
+            const double duration = measure(nruns, [&]()
+            {
+                resampler.process(vectorsize, inputs.data(), maxoutputs, outputs.data());
+            });
+            report(string(quality == DspResampler::Fast ? "fast " : "high ") + to_string(rate[0]) + " to " + to_string(rate[1]) + " Hz", duration, vectorsize * nchannels);
+        }
+    }
+    
+    KiwiPortAudioDeviceManager device;
+    device.setVectorSize(vectorsize);
+    device.setSampleRate(44100);
+    vector<float> outputs(vectorsize * nchannels);
+    for(const ulong samplerate : {0ul, 48000ul})
+    {
+        device.setEngineSampleRate(samplerate);
+        device.start();
+        for(ulong i = 0; i < nruns; i++)
+        {
+            DspPortAudioMock::step(vectorsize, 0, inputs.data(), outputs.data());
+            if(i == nruns / 10)
+            {
+                device.resetStatistics();
+            }
+        }
+        const DspProfiler::Statistics statistics = device.getStatistics();
+        report(samplerate ? "callback with an engine at 48000 Hz" : "callback without engine rate", statistics.meanduration, vectorsize * nchannels);
+        device.stop();
+    }
+}
+
+// The kernels specialized for a number of channels against the generic
+// kernels the callbacks used before.
+static void benchmarkLayouts()
+{
+    const ulong vectorsize  = 256;
+    const ulong nruns       = 20000;
+    
+    cout << "Layouts, " << Kernels::getLayoutImplementationName() << endl;
+    for(const ulong nchannels : {1ul, 2ul, 4ul, 8ul})
+    {
+        const ulong size = vectorsize * nchannels;
+        vector<float>  buffer(size, 0.25f);
+        vector<sample> matrix(size, 0.25);
+        const Kernels::Deinterleaver deinterleaver = Kernels::getDeinterleaver(nchannels);
+        const Kernels::Interleaver interleaver = Kernels::getInterleaver(nchannels);
+        const string channels = to_string(nchannels) + (nchannels > 1 ? " channels" : " channel");
+        report("generic deinterleave of " + channels, measure(nruns, [&]() {Kernels::deinterleave(vectorsize, nchannels, buffer.data(), matrix.data());}), size);
+        report("specialized deinterleave of " + channels, measure(nruns, [&]() {deinterleaver(vectorsize, nchannels, buffer.data(), matrix.data());}), size);
+        report("generic interleave of " + channels, measure(nruns, [&]() {Kernels::interleave(vectorsize, nchannels, matrix.data(), buffer.data());}), size);
+        report("specialized interleave of " + channels, measure(nruns, [&]() {interleaver(vectorsize, nchannels, matrix.data(), buffer.data());}), size);
+    }
+}
+
+int main()
+{
+    benchmarkConversions();
+    benchmarkDenormals();
+    benchmarkResampler();
+    benchmarkLayouts();
+    return 0;
+}
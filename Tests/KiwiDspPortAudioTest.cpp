@@ -0,0 +1,171 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+ */
+
+
+#include "../KiwiDspPortAudio.h"
+#include "../KiwiDspPortAudioMock.h"
+
+using namespace Kiwi;
+
+// ================================================================================ //
+//                                  PORTAUDIO TEST                                  //
+// ================================================================================ //
+
+static ulong nfailures = 0;
+
+static void check(const bool condition, const char* description)
+{
+    if(!condition)
+    {
+        cout << "FAILED: " << description << endl;
+        nfailures++;
+    }
+}
+
+static ulong getFramesPerBuffer()
+{
+    PaStreamParameters input, output;
+    double samplerate;
+    ulong framesPerBuffer = 0;
+    DspPortAudioMock::getStreamParameters(input, output, samplerate, framesPerBuffer);
+    return framesPerBuffer;
+}
+
+static void testStartStop()
+{
+    KiwiPortAudioDeviceManager device;
+    device.setVectorSize(64);
+    device.start();
+    check(DspPortAudioMock::isStreamActive(), "the stream is active after start");
+    check(DspPortAudioMock::step(), "the callback runs");
+    check(getFramesPerBuffer() == 64, "the stream uses the vector size");
+    check(DspPortAudioMock::getStreamFlags() == paClipOff, "the stream doesn't clip the outputs");
+    
+    const ulong nopens = DspPortAudioMock::getNumberOfOpens();
+    device.setVectorSize(128);
+    check(DspPortAudioMock::getNumberOfOpens() == nopens + 1, "a new vector size restarts the stream");
+    check(getFramesPerBuffer() == 128, "the restarted stream uses the new vector size");
+    check(DspPortAudioMock::getNumberOfStreams() == 1, "the restart closes the previous stream");
+    
+    device.stop();
+    check(!DspPortAudioMock::isStreamActive(), "the stream is inactive after stop");
+    check(DspPortAudioMock::getNumberOfStreams() == 0, "stop closes the stream");
+    check(!DspPortAudioMock::step(), "the callback doesn't run after stop");
+    
+    device.start();
+    check(DspPortAudioMock::isStreamActive(), "the stream restarts after stop");
+    device.stop();
+}
+
+static void testXruns()
+{
+    KiwiPortAudioDeviceManager device;
+    device.start();
+    device.resetStatistics();
+    DspPortAudioMock::play({{0, 0, 0.}, {0, paOutputUnderflow, 0.}, {0, paInputOverflow, 0.}, {0, paOutputUnderflow, 0.}});
+    const DspProfiler::Statistics statistics = device.getStatistics();
+    check(statistics.ncallbacks == 4, "the statistics count the callbacks");
+    check(statistics.noutputunderflows == 2, "the statistics count the output underflows");
+    check(statistics.ninputoverflows == 1, "the statistics count the input overflows");
+    device.stop();
+}
+
+static void testReconfiguration()
+{
+    KiwiPortAudioDeviceManager device;
+    device.start();
+    
+    PaStreamParameters input, output;
+    double samplerate;
+    ulong framesPerBuffer;
+    device.setSampleRate(48000);
+    DspPortAudioMock::getStreamParameters(input, output, samplerate, framesPerBuffer);
+    check(samplerate == 48000., "a new sample rate restarts the stream");
+    
+    device.setSampleFormat(KiwiPortAudioDeviceManager::Int16);
+    DspPortAudioMock::getStreamParameters(input, output, samplerate, framesPerBuffer);
+    check((output.sampleFormat & ~paNonInterleaved) == paInt16, "a new sample format restarts the stream");
+    
+    const ulong nopens = DspPortAudioMock::getNumberOfOpens();
+    device.beginChanges();
+    device.setSampleRate(44100);
+    device.setVectorSize(256);
+    device.setSampleFormat(KiwiPortAudioDeviceManager::Float32);
+    device.commitChanges();
+    DspPortAudioMock::getStreamParameters(input, output, samplerate, framesPerBuffer);
+    check(DspPortAudioMock::getNumberOfOpens() == nopens + 1, "a set of changes restarts the stream once");
+    check(samplerate == 44100. && framesPerBuffer == 256 && output.sampleFormat == paFloat32, "a set of changes applies all the changes");
+    check(DspPortAudioMock::step(), "the callback runs after the changes");
+    
+    device.beginChanges();
+    device.setActiveOutputs({false, true});
+    check(DspPortAudioMock::isStreamActive() && device.getOutputsSamples(1), "a mask waits for the commit");
+    device.commitChanges();
+    check(!device.getOutputsSamples(0) && device.getOutputsSamples(1), "a mask applies after the commit");
+    device.stop();
+    check(DspPortAudioMock::getNumberOfStreams() == 0, "no stream stays open after the changes");
+}
+
+static void testMasks()
+{
+    KiwiPortAudioDeviceManager device;
+    device.setActiveInputs({false, false});
+    device.start();
+    
+    PaStreamParameters input, output;
+    double samplerate;
+    ulong framesPerBuffer;
+    check(DspPortAudioMock::getStreamParameters(input, output, samplerate, framesPerBuffer), "a stream without active input starts");
+    check(input.channelCount == 0 && output.channelCount == 2, "the stream opens only the outputs");
+    const ulong nbuffers = DspPortAudioMock::getNumberOfBuffers();
+    check(DspPortAudioMock::step() && DspPortAudioMock::step(), "the callback runs without inputs");
+    check(DspPortAudioMock::getNumberOfBuffers() == nbuffers + 2, "the stream processes the buffers");
+    check(!device.getInputsSamples(0) && device.getOutputsSamples(0), "only the outputs are available");
+    
+    device.setSampleFormat(KiwiPortAudioDeviceManager::Int16);
+    device.setBufferAdapter(true);
+    check(DspPortAudioMock::step(48) && DspPortAudioMock::step(80), "the converted and adapted stream runs without inputs");
+    device.setEngineSampleRate(48000);
+    check(DspPortAudioMock::step() && DspPortAudioMock::step(), "the resampled stream runs without inputs");
+    device.stop();
+}
+
+int main()
+{
+    DspPortAudioMock::reset();
+    const PaHostApiIndex driver = DspPortAudioMock::addDriver("Mock");
+    DspPortAudioMock::addDevice(driver, {"Mock Device", 2, 2, {44100, 48000}, paFloat32 | paInt16, 64, 0.005});
+    
+    testStartStop();
+    testXruns();
+    testReconfiguration();
+    testMasks();
+    
+    if(nfailures)
+    {
+        cout << nfailures << " checks failed" << endl;
+        return 1;
+    }
+    cout << "All the checks passed" << endl;
+    return 0;
+}
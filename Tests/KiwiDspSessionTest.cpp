@@ -0,0 +1,89 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+ */
+
+
+#include "../KiwiDspPortAudio.h"
+#include "../KiwiDspPortAudioMock.h"
+
+using namespace Kiwi;
+
+// ================================================================================ //
+//                                   SESSION TEST                                   //
+// ================================================================================ //
+
+// Several threads create and destroy managers at the same time, each manager
+// must find PortAudio initialized and the count of managers must be back to
+// zero once the threads end.
+
+static const ulong nthreads  = 16;
+static const ulong nmanagers = 32;
+
+int main()
+{
+    atomic<ulong> peak(0);
+    atomic<ulong> nfailures(0);
+    vector<thread> threads;
+    for(ulong i = 0; i < nthreads; i++)
+    {
+        threads.push_back(thread([&peak, &nfailures, i]()
+        {
+            for(ulong j = 0; j < nmanagers; j++)
+            {
+                KiwiPortAudioDeviceManager device;
+                if((i + j) % 4 == 0)
+                {
+                    device.start();
+                    device.stop();
+                }
+                vector<ulong> samplerates;
+                device.getAvailableSampleRates(samplerates);
+                if(samplerates.empty())
+                {
+                    nfailures++;
+                }
+                const ulong count = KiwiPortAudioDeviceManager::getNumberOfManagers();
+                ulong current = peak.load();
+                while(count > current && !peak.compare_exchange_weak(current, count))
+                {
+                    ;
+                }
+            }
+        }));
+    }
+    for(auto& thread : threads)
+    {
+        thread.join();
+    }
+    
+    const ulong remaining = KiwiPortAudioDeviceManager::getNumberOfManagers();
+    cout << "Peak of " << peak.load() << " managers, " << remaining << " remaining" << endl;
+    if(nfailures.load())
+    {
+        cout << "FAILED: " << nfailures.load() << " managers saw no sample rate" << endl;
+    }
+    if(remaining)
+    {
+        cout << "FAILED: the managers aren't all released" << endl;
+    }
+    return nfailures.load() || remaining ? 1 : 0;
+}